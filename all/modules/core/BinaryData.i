@@ -7,6 +7,7 @@
 
 %{
 #include "core/BinaryData.h"
+#include "components/Exceptions.h"
 #include <memory>
 %}
 
@@ -29,6 +30,8 @@
 #endif
 %attribute(carto::BinaryData, std::size_t, Size, size)
 %ignore carto::BinaryData::BinaryData(std::vector<unsigned char>);
+%ignore carto::BinaryData::BinaryData(const std::shared_ptr<const void>&, const unsigned char*, std::size_t);
+%std_exceptions(carto::BinaryData::BinaryData(const std::shared_ptr<BinaryData>&, std::size_t, std::size_t))
 %ignore carto::BinaryData::empty;
 %ignore carto::BinaryData::getDataPtr;
 %ignore carto::BinaryData::operator==;
@@ -0,0 +1,14 @@
+#ifndef _LONGLONGVECTOR_I
+#define _LONGLONGVECTOR_I
+
+#pragma SWIG nowarn=302
+
+%module LongLongVector
+
+%include <std_vector.i>
+
+!value_type(std::vector<long long>, core.LongLongVector)
+
+!value_template(std::vector<long long>, core.LongLongVector)
+
+#endif
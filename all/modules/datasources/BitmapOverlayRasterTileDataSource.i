@@ -25,7 +25,9 @@
 
 !polymorphic_shared_ptr(carto::BitmapOverlayRasterTileDataSource, datasources.BitmapOverlayRasterTileDataSource)
 
+%attributestring(carto::BitmapOverlayRasterTileDataSource, std::shared_ptr<carto::Bitmap>, Bitmap, getBitmap, setBitmap)
 %std_exceptions(carto::BitmapOverlayRasterTileDataSource::BitmapOverlayRasterTileDataSource)
+%std_exceptions(carto::BitmapOverlayRasterTileDataSource::setBitmap)
 
 %feature("director") carto::BitmapOverlayRasterTileDataSource;
 
@@ -20,6 +20,8 @@
 
 !attributestring_polymorphic(carto::CacheTileDataSource, datasources.TileDataSource, DataSource, getDataSource)
 %attribute(carto::CacheTileDataSource, std::size_t, Capacity, getCapacity, setCapacity)
+%attribute(carto::CacheTileDataSource, long long, StaleTileGracePeriod, getStaleTileGracePeriod, setStaleTileGracePeriod)
+%attribute(carto::CacheTileDataSource, long long, StaleHitCount, getStaleHitCount)
 %std_exceptions(carto::CacheTileDataSource::CacheTileDataSource)
 
 %feature("director") carto::CacheTileDataSource;
@@ -0,0 +1,28 @@
+#ifndef _COALESCINGTILEDATASOURCE_I
+#define _COALESCINGTILEDATASOURCE_I
+
+%module(directors="1") CoalescingTileDataSource
+
+!proxy_imports(carto::CoalescingTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.TileDataSource, datasources.components.TileData)
+
+%{
+#include "datasources/CoalescingTileDataSource.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <std_string.i>
+%include <cartoswig.i>
+
+%import "datasources/TileDataSource.i"
+
+!polymorphic_shared_ptr(carto::CoalescingTileDataSource, datasources.CoalescingTileDataSource)
+
+%std_exceptions(carto::CoalescingTileDataSource::CoalescingTileDataSource)
+
+%feature("director") carto::CoalescingTileDataSource;
+
+%include "datasources/CoalescingTileDataSource.h"
+
+#endif
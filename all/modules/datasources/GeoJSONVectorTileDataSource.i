@@ -3,7 +3,7 @@
 
 %module(directors="1") GeoJSONVectorTileDataSource
 
-!proxy_imports(carto::GeoJSONVectorTileDataSource, core.MapTile, core.MapBounds, core.Variant, datasources.TileDataSource, datasources.components.TileData, geometry.FeatureCollection, projections.Projection)
+!proxy_imports(carto::GeoJSONVectorTileDataSource, core.MapTile, core.MapBounds, core.Variant, core.LongLongVector, datasources.TileDataSource, datasources.components.TileData, geometry.FeatureCollection, projections.Projection)
 
 %{
 #include "datasources/GeoJSONVectorTileDataSource.h"
@@ -16,6 +16,7 @@
 %include <cartoswig.i>
 
 %import "core/MapTile.i"
+%import "core/LongLongVector.i"
 %import "core/Variant.i"
 %import "geometry/FeatureCollection.i"
 %import "datasources/TileDataSource.i"
@@ -29,6 +30,9 @@
 %std_io_exceptions(carto::GeoJSONVectorTileDataSource::createLayer)
 %std_io_exceptions(carto::GeoJSONVectorTileDataSource::setLayerGeoJSON)
 %std_io_exceptions(carto::GeoJSONVectorTileDataSource::setLayerFeatureCollection)
+%std_io_exceptions(carto::GeoJSONVectorTileDataSource::addFeatures)
+%std_io_exceptions(carto::GeoJSONVectorTileDataSource::updateFeatures)
+%std_io_exceptions(carto::GeoJSONVectorTileDataSource::removeFeatures)
 
 %feature("director") carto::GeoJSONVectorTileDataSource;
 
@@ -20,6 +20,9 @@
 !polymorphic_shared_ptr(carto::MergedMBVTTileDataSource, datasources.MergedMBVTTileDataSource)
 
 %std_exceptions(carto::MergedMBVTTileDataSource::MergedMBVTTileDataSource)
+%attribute(carto::MergedMBVTTileDataSource, bool, ConcurrentLoading, isConcurrentLoading, setConcurrentLoading)
+%attribute(carto::MergedMBVTTileDataSource, double, DataSource1LoadLatency, getDataSource1LoadLatency)
+%attribute(carto::MergedMBVTTileDataSource, double, DataSource2LoadLatency, getDataSource2LoadLatency)
 
 %feature("director") carto::MergedMBVTTileDataSource;
 
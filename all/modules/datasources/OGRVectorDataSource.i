@@ -37,6 +37,7 @@
 %std_exceptions(carto::OGRVectorDataSource::OGRVectorDataSource)
 %std_exceptions(carto::OGRVectorDataSource::add)
 %std_exceptions(carto::OGRVectorDataSource::remove)
+%ignore carto::OGRVectorDataSource::streamElements;
 
 %include "datasources/OGRVectorDataSource.h"
 
@@ -20,6 +20,9 @@
 !polymorphic_shared_ptr(carto::OrderedTileDataSource, datasources.OrderedTileDataSource)
 
 %std_exceptions(carto::OrderedTileDataSource::OrderedTileDataSource)
+%attribute(carto::OrderedTileDataSource, bool, ConcurrentLoading, isConcurrentLoading, setConcurrentLoading)
+%attribute(carto::OrderedTileDataSource, double, DataSource1LoadLatency, getDataSource1LoadLatency)
+%attribute(carto::OrderedTileDataSource, double, DataSource2LoadLatency, getDataSource2LoadLatency)
 
 %feature("director") carto::OrderedTileDataSource;
 
@@ -0,0 +1,34 @@
+#ifndef _SHARDEDMEMORYCACHETILEDATASOURCE_I
+#define _SHARDEDMEMORYCACHETILEDATASOURCE_I
+
+%module(directors="1") ShardedMemoryCacheTileDataSource
+
+!proxy_imports(carto::ShardedMemoryCacheTileDataSource, core.MapTile, core.MapBounds, core.StringMap, datasources.CacheTileDataSource, datasources.components.TileData)
+
+%{
+#include "datasources/ShardedMemoryCacheTileDataSource.h"
+#include "components/Exceptions.h"
+#include <memory>
+%}
+
+%include <std_shared_ptr.i>
+%include <std_string.i>
+%include <cartoswig.i>
+
+%import "datasources/CacheTileDataSource.i"
+
+!polymorphic_shared_ptr(carto::ShardedMemoryCacheTileDataSource, datasources.ShardedMemoryCacheTileDataSource)
+
+%std_exceptions(carto::ShardedMemoryCacheTileDataSource::ShardedMemoryCacheTileDataSource)
+
+%attribute(carto::ShardedMemoryCacheTileDataSource, std::size_t, CompressedCapacity, getCompressedCapacity, setCompressedCapacity)
+%attribute(carto::ShardedMemoryCacheTileDataSource, long long, HitCount, getHitCount)
+%attribute(carto::ShardedMemoryCacheTileDataSource, long long, MissCount, getMissCount)
+%attribute(carto::ShardedMemoryCacheTileDataSource, long long, CompressedHitCount, getCompressedHitCount)
+%attribute(carto::ShardedMemoryCacheTileDataSource, long long, EvictionCount, getEvictionCount)
+
+%feature("director") carto::ShardedMemoryCacheTileDataSource;
+
+%include "datasources/ShardedMemoryCacheTileDataSource.h"
+
+#endif
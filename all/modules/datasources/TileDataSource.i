@@ -34,6 +34,9 @@
 %ignore carto::TileDataSource::OnChangeListener;
 %ignore carto::TileDataSource::registerOnChangeListener;
 %ignore carto::TileDataSource::unregisterOnChangeListener;
+%ignore carto::TileDataSource::isBatchLoadingSupported;
+%ignore carto::TileDataSource::loadTiles;
+%ignore carto::TileDataSource::revalidateTile;
 
 %feature("director") carto::TileDataSource;
 %feature("nodirector") carto::TileDataSource::buildTagValues;
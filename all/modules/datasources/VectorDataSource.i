@@ -34,6 +34,7 @@
 %ignore carto::VectorDataSource::registerOnChangeListener;
 %ignore carto::VectorDataSource::unregisterOnChangeListener;
 %ignore carto::VectorDataSource::getElementDataSource;
+%ignore carto::VectorDataSource::streamElements;
 
 %feature("nodirector") carto::VectorDataSource::notifyElementAdded;
 %feature("nodirector") carto::VectorDataSource::notifyElementChanged;
@@ -31,12 +31,15 @@
 %attribute(carto::TileLayer, float, ZoomLevelBias, getZoomLevelBias, setZoomLevelBias)
 %attribute(carto::TileLayer, int, MaxOverzoomLevel, getMaxOverzoomLevel, setMaxOverzoomLevel)
 %attribute(carto::TileLayer, int, MaxUnderzoomLevel, getMaxUnderzoomLevel, setMaxUnderzoomLevel)
+%attribute(carto::TileLayer, double, TileLoadLatency, getTileLoadLatency)
+%attribute(carto::TileLayer, double, TileBuildLatency, getTileBuildLatency)
 !attributestring_polymorphic(carto::TileLayer, datasources.TileDataSource, DataSource, getDataSource)
 !attributestring_polymorphic(carto::TileLayer, datasources.TileDataSource, UTFGridDataSource, getUTFGridDataSource, setUTFGridDataSource)
 !attributestring_polymorphic(carto::TileLayer, layers.TileLoadListener, TileLoadListener, getTileLoadListener, setTileLoadListener)
 !attributestring_polymorphic(carto::TileLayer, layers.UTFGridEventListener, UTFGridEventListener, getUTFGridEventListener, setUTFGridEventListener)
 %std_exceptions(carto::TileLayer::TileLayer)
 %ignore carto::TileLayer::FetchTaskBase;
+%ignore carto::TileLayer::FetchTileBatch;
 %ignore carto::TileLayer::FetchingTiles;
 %ignore carto::TileLayer::DataSourceListener;
 %ignore carto::TileLayer::UTFGridTile;
@@ -44,6 +44,7 @@ using std::uint64_t;
 %ignore carto::PackageManager::unregisterOnChangeListener;
 %ignore carto::PackageManager::getSchema;
 %ignore carto::PackageManager::accessLocalPackages;
+%ignore carto::PackageManager::readLocalPackages;
 !standard_equals(carto::PackageManager);
 
 %include "packagemanager/PackageManager.h"
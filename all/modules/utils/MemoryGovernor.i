@@ -0,0 +1,22 @@
+#ifndef _MEMORYGOVERNOR_I
+#define _MEMORYGOVERNOR_I
+
+%module MemoryGovernor
+
+%{
+#include "utils/MemoryGovernor.h"
+%}
+
+%include <std_string.i>
+%include <cartoswig.i>
+
+!enum(carto::MemoryTrimLevel::MemoryTrimLevel)
+%staticattribute(carto::MemoryGovernor, std::size_t, MemoryBudget, GetMemoryBudget, SetMemoryBudget)
+%ignore carto::MemoryGovernor::CacheHandle;
+%ignore carto::MemoryGovernor::RebalanceIfNeeded;
+%ignore carto::MemoryGovernor::RegisterCache;
+%ignore carto::MemoryGovernor::UnregisterCache;
+
+%include "utils/MemoryGovernor.h"
+
+#endif
@@ -2,54 +2,58 @@
 #include "utils/Log.h"
 #include "utils/ThreadUtils.h"
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 
 namespace carto {
 
     CancelableThreadPool::CancelableThreadPool() :
         _poolSize(0),
-        _taskCount(0),
         _stop(false),
-        _taskRecords(),
+        _taskQueues(std::make_shared<const TaskQueueList>()),
+        _nextTaskQueue(0),
+        _pendingTaskCount(0),
+        _idleWorkerCount(0),
         _workers(),
         _threads(),
         _condition(),
         _mutex()
     {
     }
-    
+
     CancelableThreadPool::~CancelableThreadPool() {
     }
-        
+
     void CancelableThreadPool::deinit() {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _stop = true;
         }
-        
+
         cancelAll();
-        
+
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _condition.notify_all();
         }
-        
+
         for (std::thread& thread : _threads) {
             thread.detach();
         }
-        
+
         _workers.clear();
         _threads.clear();
     }
-    
+
     int CancelableThreadPool::getPoolSize() const {
         std::lock_guard<std::mutex> lock(_mutex);
         return _poolSize;
     }
-    
+
     void CancelableThreadPool::setPoolSize(int poolSize) {
         std::lock_guard<std::mutex> lock(_mutex);
-        
+
         if (_stop) {
             return;
         }
@@ -57,87 +61,175 @@ namespace carto {
         // Note: won't have an immediate effect
         _poolSize = poolSize;
     }
-    
+
     void CancelableThreadPool::execute(std::shared_ptr<CancelableTask> task) {
         execute(task, DEFAULT_PRIORITY);
     }
-    
+
     void CancelableThreadPool::execute(std::shared_ptr<CancelableTask> task, int priority) {
         if (!task->isCanceled()) {
             std::lock_guard<std::mutex> lock(_mutex);
-            
+
             if (_stop) {
                 return;
             }
-    
-            // Push task to queue, increase global task count
-            _taskRecords.push(TaskRecord(task, priority, _taskCount));
-            _taskCount++;
 
-            // Check if we need to create a new worker.
+            // The minimum value is reserved for marking empty queues and idle workers
+            priority = std::max(priority, std::numeric_limits<int>::min() + 1);
+
+            // Check if we need to create a new worker. If all workers are busy with lower priority tasks, create a temporary worker for this priority.
+            // The number of temporary workers is limited, as callers may use fine-grained priorities where almost every task has a distinct priority.
+            int minPriority = std::numeric_limits<int>::min();
             bool createWorker = static_cast<int>(_threads.size()) < _poolSize;
-            if (!createWorker) {
-                bool foundIdleWorker = false;
-                for (std::shared_ptr<TaskWorker>& worker : _workers) {
-                    if (worker->_priority == std::numeric_limits<int>::min()) {
-                        worker->_priority = priority;
-                        foundIdleWorker = true;
+            if (!createWorker && static_cast<int>(_threads.size()) < _poolSize + MAX_TEMPORARY_WORKERS) {
+                createWorker = true;
+                for (const std::shared_ptr<TaskWorker>& worker : _workers) {
+                    int runningPriority = worker->_runningPriority.load();
+                    if (worker->_minPriority.load() <= priority && (runningPriority == std::numeric_limits<int>::min() || runningPriority >= priority)) {
+                        createWorker = false;
                         break;
                     }
                 }
-                if (!foundIdleWorker) {
-                    createWorker = true;
-                    for (std::shared_ptr<TaskWorker>& worker : _workers) {
-                        if (worker->_priority == priority) {
-                            createWorker = false;
-                            break;
-                        }
-                    }
+                if (createWorker) {
+                    minPriority = priority;
                 }
             }
+
+            // Push the task to the queue of the new worker or distribute tasks between existing queues.
+            // Pending count is increased before pushing, so that workers never go to sleep while a task is being added.
+            std::shared_ptr<TaskQueue> taskQueue;
+            if (createWorker) {
+                taskQueue = acquireTaskQueue();
+            } else {
+                std::shared_ptr<const TaskQueueList> taskQueues = std::atomic_load(&_taskQueues);
+                taskQueue = taskQueues->at(_nextTaskQueue++ % taskQueues->size());
+            }
+            _pendingTaskCount++;
+            taskQueue->push(task, priority);
+
             if (createWorker) {
                 Log::Debugf("CancelableThreadPool: Adding worker to the pool (size %d)", (int)_workers.size());
-                _workers.push_back(std::make_shared<TaskWorker>(shared_from_this(), priority));
+                _workers.push_back(std::make_shared<TaskWorker>(shared_from_this(), taskQueue, minPriority));
                 _threads.push_back(std::thread(&TaskWorker::operator(), _workers.back()));
+            } else if (_idleWorkerCount.load() > 0) {
+                // Wake up a single worker, any worker can take the task by stealing it
+                _condition.notify_one();
+            }
+        }
+    }
+
+    bool CancelableThreadPool::reprioritize(const std::shared_ptr<CancelableTask>& task, int priority) {
+        priority = std::max(priority, std::numeric_limits<int>::min() + 1);
+
+        std::shared_ptr<const TaskQueueList> taskQueues = std::atomic_load(&_taskQueues);
+        for (const std::shared_ptr<TaskQueue>& taskQueue : *taskQueues) {
+            if (taskQueue->reprioritize(task, priority)) {
+                return true;
             }
-    
-            // If there are any waiting threads, notify all of them as not all workers may be able to process the task
-            _condition.notify_all();
         }
+        return false;
     }
-    
+
     void CancelableThreadPool::cancelAll() {
-        std::lock_guard<std::mutex> lock(_mutex);
-        
-        std::size_t taskRecordsSize = _taskRecords.size();
-        for (std::size_t i = 0; i < taskRecordsSize; i++) {
-            const std::shared_ptr<CancelableTask>& task = _taskRecords.top()._task;
-            task->cancel();
-            _taskRecords.pop();
-        }
-    }
-    
-    CancelableThreadPool::TaskRecord::TaskRecord(std::shared_ptr<CancelableTask> task, int priority, long long sequence) :
-        _task(task),
-        _priority(priority),
-        _sequence(sequence)
+        std::shared_ptr<const TaskQueueList> taskQueues = std::atomic_load(&_taskQueues);
+        for (const std::shared_ptr<TaskQueue>& taskQueue : *taskQueues) {
+            int canceledCount = taskQueue->cancelAll();
+            _pendingTaskCount -= canceledCount;
+        }
+    }
+
+    CancelableThreadPool::TaskQueue::TaskQueue() :
+        _buckets(),
+        _taskIndex(),
+        _topPriority(std::numeric_limits<int>::min()),
+        _owned(true),
+        _mutex()
     {
     }
-    
-    bool CancelableThreadPool::TaskRecord::operator <(const TaskRecord& taskRecord) const {
-        // Tasks are sorted according to their priority and then their sequence
-        if (_priority != taskRecord._priority) {
-            return _priority < taskRecord._priority;
+
+    void CancelableThreadPool::TaskQueue::push(const std::shared_ptr<CancelableTask>& task, int priority) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        TaskList& tasks = _buckets[priority];
+        _taskIndex[task.get()] = std::make_pair(priority, tasks.insert(tasks.end(), task));
+        if (priority > _topPriority.load()) {
+            _topPriority.store(priority);
         }
-        return _sequence > taskRecord._sequence;
     }
-    
-    CancelableThreadPool::TaskWorker::TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, int priority) :
+
+    bool CancelableThreadPool::TaskQueue::pop(std::shared_ptr<CancelableTask>& task, int& priority, int minPriority) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_buckets.empty()) {
+            return false;
+        }
+
+        // Tasks with the same priority are processed in FIFO order
+        auto it = std::prev(_buckets.end());
+        if (it->first < minPriority) {
+            return false;
+        }
+        priority = it->first;
+        task = it->second.front();
+        auto indexIt = _taskIndex.find(task.get());
+        if (indexIt != _taskIndex.end() && indexIt->second.second == it->second.begin()) {
+            _taskIndex.erase(indexIt);
+        }
+        it->second.pop_front();
+        if (it->second.empty()) {
+            _buckets.erase(it);
+        }
+        _topPriority.store(_buckets.empty() ? std::numeric_limits<int>::min() : _buckets.rbegin()->first);
+        return true;
+    }
+
+    bool CancelableThreadPool::TaskQueue::reprioritize(const std::shared_ptr<CancelableTask>& task, int priority) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto indexIt = _taskIndex.find(task.get());
+        if (indexIt == _taskIndex.end()) {
+            return false;
+        }
+
+        int oldPriority = indexIt->second.first;
+        if (oldPriority != priority) {
+            // Move the task to the end of the new bucket, as if it was added with the new priority
+            auto it = _buckets.find(oldPriority);
+            TaskList& tasks = _buckets[priority];
+            tasks.splice(tasks.end(), it->second, indexIt->second.second);
+            if (it->second.empty()) {
+                _buckets.erase(it);
+            }
+            indexIt->second.first = priority;
+            _topPriority.store(_buckets.rbegin()->first);
+        }
+        return true;
+    }
+
+    int CancelableThreadPool::TaskQueue::cancelAll() {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        int canceledCount = 0;
+        for (auto it = _buckets.begin(); it != _buckets.end(); it++) {
+            for (const std::shared_ptr<CancelableTask>& task : it->second) {
+                task->cancel();
+                canceledCount++;
+            }
+        }
+        _buckets.clear();
+        _taskIndex.clear();
+        _topPriority.store(std::numeric_limits<int>::min());
+        return canceledCount;
+    }
+
+    CancelableThreadPool::TaskWorker::TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, const std::shared_ptr<TaskQueue>& taskQueue, int minPriority) :
         _threadPool(threadPool),
-        _priority(priority)
+        _taskQueue(taskQueue),
+        _minPriority(minPriority),
+        _runningPriority(std::numeric_limits<int>::min())
     {
     }
-        
+
     void CancelableThreadPool::TaskWorker::operator ()() {
         ThreadUtils::SetThreadPriority(ThreadPriority::MINIMUM);
         while (true) {
@@ -146,68 +238,51 @@ namespace carto {
                 return;
             }
 
-            // If there are no tasks, wait until notified or exit thread if interrupted
-            {
-                std::unique_lock<std::mutex> lock(threadPool->_mutex);
-                if (threadPool->_stop) {
-                    return;
-                }
-                
-                if (threadPool->_taskRecords.size() == 0) {
-                    threadPool->_condition.wait(lock);
-                }
+            // Request another task, execute it if it's not null. Otherwise wait until notified or exit thread if interrupted.
+            std::shared_ptr<CancelableTask> task;
+            if (threadPool->getNextTask(*this, task)) {
+                task->operator ()();
+                _runningPriority.store(std::numeric_limits<int>::min());
+            } else if (!threadPool->waitForTask(*this)) {
+                return;
             }
-    
-            // Request another task, execute it if it's not null
-            while (true) {
-                std::shared_ptr<CancelableTask> task;
-                int priority = DEFAULT_PRIORITY;
-                {
-                    std::lock_guard<std::mutex> lock(threadPool->_mutex);
-                    if (threadPool->_stop) {
-                        return;
-                    }
-                    priority = _priority;
-                }
-                
-                if (threadPool->getNextTask(task, priority)) {
-                    task->operator ()();
-                } else {
-                    if (threadPool->shouldTerminateWorker(*this)) {
-                        return;
-                    }
+        }
+    }
 
-                    // Mark worker as inactive
-                    std::lock_guard<std::mutex> lock(threadPool->_mutex);
-                    _priority = std::numeric_limits<int>::min();
-                    break;
+    bool CancelableThreadPool::getNextTask(TaskWorker& worker, std::shared_ptr<CancelableTask>& task) {
+        int minPriority = worker._minPriority.load();
+        while (_pendingTaskCount.load() > 0) {
+            // Find the queue with the highest priority task. Prefer own queue, steal from other queues only if they contain higher priority tasks.
+            std::shared_ptr<const TaskQueueList> taskQueues = std::atomic_load(&_taskQueues);
+            TaskQueue* bestTaskQueue = worker._taskQueue.get();
+            int bestPriority = bestTaskQueue->_topPriority.load();
+            for (const std::shared_ptr<TaskQueue>& taskQueue : *taskQueues) {
+                int priority = taskQueue->_topPriority.load();
+                if (priority > bestPriority) {
+                    bestTaskQueue = taskQueue.get();
+                    bestPriority = priority;
                 }
-
-                // Check for interruption
-                std::this_thread::yield();
             }
-        }
-    }
-    
-    bool CancelableThreadPool::getNextTask(std::shared_ptr<CancelableTask>& task, int priority) {
-        std::lock_guard<std::mutex> lock(_mutex);
-    
-        // Return the next highest priority task from the task queue. Assuming it matches the requested priority.
-        if (_taskRecords.size() > 0) {
-            if (_taskRecords.top()._priority >= priority) {
-                task = _taskRecords.top()._task;
-                _taskRecords.pop();
+            if (bestPriority == std::numeric_limits<int>::min() || bestPriority < minPriority) {
+                return false;
+            }
+
+            // The queue may have been modified after the scan, in that case simply retry
+            int priority = 0;
+            if (bestTaskQueue->pop(task, priority, minPriority)) {
+                _pendingTaskCount--;
+                worker._runningPriority.store(priority);
                 return true;
             }
         }
         return false;
     }
-    
-    bool CancelableThreadPool::shouldTerminateWorker(TaskWorker& worker) {
-        std::lock_guard<std::mutex> lock(_mutex);
-        
+
+    bool CancelableThreadPool::waitForTask(TaskWorker& worker) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
         if (_stop) {
-            return true;
+            return false;
         }
 
         // If there are too many threads, remove this worker and it's thread
@@ -216,19 +291,53 @@ namespace carto {
             // Find the index of the finished worker, it's thread will have the same index in _threads vector
             for (std::size_t index = 0; index < _workers.size(); index++) {
                 if (_workers[index].get() == &worker) {
-                    // Remove thread and worker
+                    // Remove thread and worker. Release the task queue, remaining tasks will be stolen by other workers.
                     Log::Debugf("CancelableThreadPool: Removing worker from the pool (size %d)", (int)index);
+                    worker._taskQueue->_owned = false;
                     _workers.erase(_workers.begin() + index);
                     _threads.at(index).detach();
                     _threads.erase(_threads.begin() + index);
                     break;
                 }
             }
+            if (_pendingTaskCount.load() > 0 && _idleWorkerCount.load() > 0) {
+                _condition.notify_one();
+            }
+            return false;
+        }
+
+        // Temporary worker that is kept becomes a regular worker
+        worker._minPriority.store(std::numeric_limits<int>::min());
+
+        // Tasks are added while holding the mutex, so checking the pending count here can not miss a notification
+        if (_pendingTaskCount.load() > 0) {
             return true;
         }
-        return false;
+
+        _idleWorkerCount++;
+        _condition.wait(lock);
+        _idleWorkerCount--;
+        return !_stop;
+    }
+
+    std::shared_ptr<CancelableThreadPool::TaskQueue> CancelableThreadPool::acquireTaskQueue() {
+        std::shared_ptr<const TaskQueueList> taskQueues = std::atomic_load(&_taskQueues);
+        for (const std::shared_ptr<TaskQueue>& taskQueue : *taskQueues) {
+            if (!taskQueue->_owned) {
+                taskQueue->_owned = true;
+                return taskQueue;
+            }
+        }
+
+        // No free queues, create a new one and publish the updated queue list
+        auto taskQueue = std::make_shared<TaskQueue>();
+        auto newTaskQueues = std::make_shared<TaskQueueList>(*taskQueues);
+        newTaskQueues->push_back(taskQueue);
+        std::atomic_store(&_taskQueues, std::shared_ptr<const TaskQueueList>(newTaskQueues));
+        return taskQueue;
     }
 
     const int CancelableThreadPool::DEFAULT_PRIORITY = 0;
-    
+    const int CancelableThreadPool::MAX_TEMPORARY_WORKERS = 2;
+
 }
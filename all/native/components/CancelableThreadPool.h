@@ -10,65 +10,94 @@
 #include "components/CancelableTask.h"
 #include "components/ThreadWorker.h"
 
+#include <atomic>
 #include <condition_variable>
+#include <list>
+#include <map>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace carto {
 
+    /**
+     * Thread pool for cancelable tasks. Each worker owns a task queue with per-priority buckets.
+     * Workers take the highest priority task available, either from their own queue or by
+     * stealing from the queues of other workers, so the common path does not touch the pool mutex.
+     */
     class CancelableThreadPool : public std::enable_shared_from_this<CancelableThreadPool> {
     public:
         CancelableThreadPool();
         virtual ~CancelableThreadPool();
         void deinit();
-    
+
         int getPoolSize() const;
         void setPoolSize(int threadCount);
-    
+
         void execute(std::shared_ptr<CancelableTask>);
         void execute(std::shared_ptr<CancelableTask>, int priority);
-    
+
+        bool reprioritize(const std::shared_ptr<CancelableTask>& task, int priority);
+
         void cancelAll();
-        
+
     private:
-        struct TaskRecord {
-            TaskRecord(std::shared_ptr<CancelableTask> task, int priority, long long sequence);
-    
-            bool operator <(const TaskRecord& taskRecord) const;
-    
-            std::shared_ptr<CancelableTask> _task;
-            int _priority;
-            long long _sequence;
+        struct TaskQueue {
+            TaskQueue();
+
+            void push(const std::shared_ptr<CancelableTask>& task, int priority);
+            bool pop(std::shared_ptr<CancelableTask>& task, int& priority, int minPriority);
+            bool reprioritize(const std::shared_ptr<CancelableTask>& task, int priority);
+            int cancelAll();
+
+            typedef std::list<std::shared_ptr<CancelableTask> > TaskList;
+
+            std::map<int, TaskList> _buckets; // guarded by _mutex
+            std::unordered_map<const CancelableTask*, std::pair<int, TaskList::iterator> > _taskIndex; // bucket and position of each queued task, guarded by _mutex
+            std::atomic<int> _topPriority; // highest priority in the queue, std::numeric_limits<int>::min() when empty
+            bool _owned; // true if the queue is assigned to a worker, guarded by the pool _mutex
+            std::mutex _mutex;
         };
-    
+
+        typedef std::vector<std::shared_ptr<TaskQueue> > TaskQueueList;
+
         struct TaskWorker : public ThreadWorker {
-            TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, int priority);
-    
+            TaskWorker(const std::shared_ptr<CancelableThreadPool>& threadPool, const std::shared_ptr<TaskQueue>& taskQueue, int minPriority);
+
             void operator()();
-    
+
             std::weak_ptr<CancelableThreadPool> _threadPool;
-            int _priority; // mutable, guarded by _threadPool->_mutex
+            std::shared_ptr<TaskQueue> _taskQueue;
+            std::atomic<int> _minPriority; // the worker accepts only tasks with at least this priority
+            std::atomic<int> _runningPriority; // priority of the task being executed, std::numeric_limits<int>::min() when idle
         };
-    
-        bool getNextTask(std::shared_ptr<CancelableTask>& task, int priority);
-    
-        bool shouldTerminateWorker(TaskWorker& worker);
-    
+
+        bool getNextTask(TaskWorker& worker, std::shared_ptr<CancelableTask>& task);
+
+        bool waitForTask(TaskWorker& worker);
+
+        std::shared_ptr<TaskQueue> acquireTaskQueue();
+
         static const int DEFAULT_PRIORITY;
-    
+        static const int MAX_TEMPORARY_WORKERS;
+
         int _poolSize;
-        long long _taskCount;
         bool _stop;
-    
-        std::priority_queue<TaskRecord> _taskRecords;
+
+        std::shared_ptr<const TaskQueueList> _taskQueues; // copy-on-write, accessed atomically
+        std::atomic<unsigned int> _nextTaskQueue;
+        std::atomic<int> _pendingTaskCount;
+        std::atomic<int> _idleWorkerCount;
+
         std::vector<std::shared_ptr<TaskWorker> > _workers;
         std::vector<std::thread> _threads;
-    
+
         std::condition_variable _condition;
         mutable std::mutex _mutex;
     };
-    
+
 }
 
 #endif
@@ -1,46 +1,96 @@
 #include "BinaryData.h"
+#include "components/Exceptions.h"
 
 #include <algorithm>
+#include <atomic>
 #include <sstream>
 
 namespace carto {
 
     BinaryData::BinaryData() :
+        _owner(),
+        _data(nullptr),
+        _size(0),
         _dataPtr(std::make_shared<std::vector<unsigned char> >())
     {
+        _owner = _dataPtr;
+        _data = _dataPtr->data();
     }
 
     BinaryData::BinaryData(std::vector<unsigned char> data) :
+        _owner(),
+        _data(nullptr),
+        _size(data.size()),
         _dataPtr(std::make_shared<std::vector<unsigned char> >(std::move(data)))
     {
+        _owner = _dataPtr;
+        _data = _dataPtr->data();
     }
     
     BinaryData::BinaryData(const unsigned char* data, std::size_t size) :
+        _owner(),
+        _data(nullptr),
+        _size(size),
         _dataPtr(std::make_shared<std::vector<unsigned char> >(data, data + size))
+    {
+        _owner = _dataPtr;
+        _data = _dataPtr->data();
+    }
+
+    BinaryData::BinaryData(const std::shared_ptr<BinaryData>& data, std::size_t offset, std::size_t size) :
+        _owner(),
+        _data(nullptr),
+        _size(size),
+        _dataPtr()
+    {
+        if (!data) {
+            throw NullArgumentException("Null data");
+        }
+        if (offset > data->_size || size > data->_size - offset) {
+            throw OutOfRangeException("Slice outside of data");
+        }
+
+        _owner = data->_owner;
+        _data = data->_data + offset;
+        if (offset == 0 && size == data->_size) {
+            _dataPtr = std::atomic_load(&data->_dataPtr);
+        }
+    }
+
+    BinaryData::BinaryData(const std::shared_ptr<const void>& owner, const unsigned char* viewPtr, std::size_t viewSize) :
+        _owner(owner),
+        _data(viewPtr),
+        _size(viewSize),
+        _dataPtr()
     {
     }
     
     bool BinaryData::empty() const {
-        return _dataPtr->empty();
+        return _size == 0;
     }
 
     std::size_t BinaryData::size() const {
-        return _dataPtr->size();
+        return _size;
     }
 
     const unsigned char* BinaryData::data() const {
-        return _dataPtr->data();
+        return _data;
     }
 
     std::shared_ptr<std::vector<unsigned char> > BinaryData::getDataPtr() const {
-        return _dataPtr;
+        std::shared_ptr<std::vector<unsigned char> > dataPtr = std::atomic_load(&_dataPtr);
+        if (!dataPtr) {
+            dataPtr = std::make_shared<std::vector<unsigned char> >(_data, _data + _size);
+            std::atomic_store(&_dataPtr, dataPtr);
+        }
+        return dataPtr;
     }
 
     bool BinaryData::operator ==(const BinaryData& data) const {
-        if (_dataPtr->size() != data._dataPtr->size()) {
+        if (_size != data._size) {
             return false;
         }
-        return std::equal(_dataPtr->begin(), _dataPtr->end(), data._dataPtr->begin());
+        return std::equal(_data, _data + _size, data._data);
     }
 
     bool BinaryData::operator !=(const BinaryData& data) const {
@@ -48,12 +98,12 @@ namespace carto {
     }
 
     int BinaryData::hash() const {
-        return static_cast<int>(std::hash<std::string>()(std::string(reinterpret_cast<const char*>(_dataPtr->data()), _dataPtr->size())));
+        return static_cast<int>(std::hash<std::string>()(std::string(reinterpret_cast<const char*>(_data), _size)));
     }
 
     std::string BinaryData::toString() const {
         std::stringstream ss;
-        ss << "BinaryData [size=" << _dataPtr->size() << "]";
+        ss << "BinaryData [size=" << _size << "]";
         return ss.str();
     }
 
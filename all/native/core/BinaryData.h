@@ -16,6 +16,8 @@ namespace carto {
     
     /**
      * A wrapper class for binary data (Blob).
+     * The data is either owned by the object or is an immutable view of a memory region owned by another object
+     * (for example, a memory mapped file or another BinaryData object). Views share the ownership of the region and do not copy it.
      */
     class BinaryData {
     public:
@@ -34,6 +36,21 @@ namespace carto {
          * @param size The size of the data in bytes.
          */
         BinaryData(const unsigned char* dataPtr, std::size_t size);
+        /**
+         * Constructs a BinaryData object that refers to a part of another BinaryData object. The data is not copied.
+         * @param data The data to refer to.
+         * @param offset The offset of the first byte.
+         * @param size The size of the part in bytes.
+         * @throws std::out_of_range If the part is not inside the data.
+         */
+        BinaryData(const std::shared_ptr<BinaryData>& data, std::size_t offset, std::size_t size);
+        /**
+         * Constructs a BinaryData object that refers to a memory region. The data is not copied.
+         * @param owner The object owning the memory region. The region must stay valid and unchanged while the owner exists.
+         * @param viewPtr The pointer to the first byte of the region.
+         * @param viewSize The size of the region in bytes.
+         */
+        BinaryData(const std::shared_ptr<const void>& owner, const unsigned char* viewPtr, std::size_t viewSize);
 
         /**
          * Check if the data is empty (size is 0).
@@ -52,6 +69,7 @@ namespace carto {
         const unsigned char* data() const;
         /**
          * Returns the pointer to data byte vector.
+         * Note: if the object is a view, the data is copied to a new vector when this method is called for the first time.
          * @return The pointer to data byte vector.
          */
         std::shared_ptr<std::vector<unsigned char> > getDataPtr() const;
@@ -82,7 +100,10 @@ namespace carto {
         std::string toString() const;
 
     private:
-        std::shared_ptr<std::vector<unsigned char> > _dataPtr;
+        std::shared_ptr<const void> _owner;
+        const unsigned char* _data;
+        std::size_t _size;
+        mutable std::shared_ptr<std::vector<unsigned char> > _dataPtr; // created on demand for views
     };
 
 }
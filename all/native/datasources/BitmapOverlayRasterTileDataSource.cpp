@@ -2,10 +2,12 @@
 #include "components/Exceptions.h"
 #include "projections/Projection.h"
 #include "projections/EPSG3857.h"
+#include "core/BinaryData.h"
 #include "graphics/Bitmap.h"
 #include "graphics/utils/BitmapFilterTable.h"
 #include "utils/Log.h"
 
+#include <algorithm>
 #include <array>
 
 #include <cglib/mat.h>
@@ -34,7 +36,12 @@ namespace carto {
         _transform(cglib::mat3x3<double>::identity()),
         _invTransform(cglib::mat3x3<double>::identity()),
         _bitmap(),
-        _projection(std::make_shared<EPSG3857>())
+        _projection(std::make_shared<EPSG3857>()),
+        _pyramidLevels(),
+        _pyramidThread(),
+        _pyramidThreadMutex(),
+        _tileCache(TILE_CACHE_SIZE),
+        _mutex()
     {
         if (!bitmap) {
             throw NullArgumentException("Null bitmap");
@@ -122,12 +129,66 @@ namespace carto {
         if (bitmap->getColorFormat() != ColorFormat::COLOR_FORMAT_RGBA) {
             _bitmap = bitmap->getRGBABitmap();
         }
+        _pyramidLevels.push_back(_bitmap);
+
+        startPyramidBuild();
     }
 
     BitmapOverlayRasterTileDataSource::~BitmapOverlayRasterTileDataSource() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bitmap.reset(); // stops the pyramid build
+        }
+        if (_pyramidThread.joinable()) {
+            _pyramidThread.join();
+        }
+    }
+
+    std::shared_ptr<Bitmap> BitmapOverlayRasterTileDataSource::getBitmap() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bitmap;
+    }
+
+    void BitmapOverlayRasterTileDataSource::setBitmap(const std::shared_ptr<Bitmap>& bitmap) {
+        if (!bitmap) {
+            throw NullArgumentException("Null bitmap");
+        }
+
+        std::shared_ptr<Bitmap> rgbaBitmap = bitmap;
+        if (bitmap->getColorFormat() != ColorFormat::COLOR_FORMAT_RGBA) {
+            rgbaBitmap = bitmap->getRGBABitmap();
+        }
+
+        std::lock_guard<std::mutex> threadLock(_pyramidThreadMutex);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (bitmap == _bitmap || (rgbaBitmap->getWidth() == _bitmap->getWidth() && rgbaBitmap->getHeight() == _bitmap->getHeight() && rgbaBitmap->getPixelData() == _bitmap->getPixelData())) {
+                return;
+            }
+
+            // Keep the covered area, scale the bitmap coordinates to the new bitmap size
+            cglib::vec3<double> scale(static_cast<double>(rgbaBitmap->getWidth()) / _bitmap->getWidth(), static_cast<double>(rgbaBitmap->getHeight()) / _bitmap->getHeight(), 1);
+            _invTransform = cglib::scale3_matrix(scale) * _invTransform;
+            _transform = cglib::inverse(_invTransform);
+
+            _bitmap = rgbaBitmap;
+            _pyramidLevels.clear();
+            _pyramidLevels.push_back(_bitmap);
+            _tileCache.clear();
+        }
+
+        // The previous build stops as the bitmap was replaced
+        if (_pyramidThread.joinable()) {
+            _pyramidThread.join();
+        }
+        startPyramidBuild();
+
+        notifyTilesChanged(false);
     }
 
     MapBounds BitmapOverlayRasterTileDataSource::getDataExtent() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
         if (!_bitmap) {
             return MapBounds(MapPos(0, 0), MapPos(0, 0));
         }
@@ -144,8 +205,23 @@ namespace carto {
     }
 
     std::shared_ptr<TileData> BitmapOverlayRasterTileDataSource::loadTile(const MapTile& mapTile) {
-        if (!_bitmap) {
-            return std::shared_ptr<TileData>();
+        std::shared_ptr<Bitmap> sourceBitmap;
+        std::vector<std::shared_ptr<Bitmap> > pyramidLevels;
+        cglib::mat3x3<double> sourceInvTransform;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_bitmap) {
+                return std::shared_ptr<TileData>();
+            }
+
+            std::shared_ptr<TileData> tileData;
+            if (_tileCache.read(mapTile.getTileId(), tileData)) {
+                return tileData;
+            }
+
+            sourceBitmap = _bitmap;
+            pyramidLevels = _pyramidLevels;
+            sourceInvTransform = _invTransform;
         }
 
         // Calculate tile bounds
@@ -156,18 +232,29 @@ namespace carto {
         cglib::vec2<double> tileP0(projP0(0) - _origin(0) + scaleX * mapTile.getX(), projP0(1) - _origin(1) + scaleY * mapTile.getY());
 
         // Calculate transform for tile pixel -> source pixel
-        cglib::mat3x3<double> invTransform = _invTransform * cglib::translate3_matrix(cglib::vec3<double>(tileP0(0), tileP0(1), 1)) * cglib::scale3_matrix(cglib::vec3<double>(scaleX / _tileSize, scaleY / _tileSize, 1));
+        cglib::mat3x3<double> invTransform = sourceInvTransform * cglib::translate3_matrix(cglib::vec3<double>(tileP0(0), tileP0(1), 1)) * cglib::scale3_matrix(cglib::vec3<double>(scaleX / _tileSize, scaleY / _tileSize, 1));
 
         // Find tile area in raster space
         int minU, minV, maxU, maxV;
-        if (!BitmapFilterTable::calculateFilterBounds(ProjectiveTransform(invTransform), _tileSize, _tileSize, _bitmap->getWidth(), _bitmap->getHeight(), minU, minV, maxU, maxV, MAX_FILTER_WIDTH)) {
+        if (!BitmapFilterTable::calculateFilterBounds(ProjectiveTransform(invTransform), _tileSize, _tileSize, sourceBitmap->getWidth(), sourceBitmap->getHeight(), minU, minV, maxU, maxV, MAX_FILTER_WIDTH)) {
             Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s outside of bitmap", mapTile.toString().c_str());
             return std::shared_ptr<TileData>();
         }
 
+        // Select the smallest pyramid level that still has at least one pixel per tile pixel
+        double scale = std::min(maxU - minU, maxV - minV) / static_cast<double>(_tileSize);
+        int level = 0;
+        while (level + 1 < static_cast<int>(pyramidLevels.size()) && scale >= (2 << level)) {
+            level++;
+        }
+        std::shared_ptr<Bitmap> bitmap = pyramidLevels[level];
+        if (level > 0) {
+            invTransform = cglib::scale3_matrix(cglib::vec3<double>(static_cast<double>(bitmap->getWidth()) / sourceBitmap->getWidth(), static_cast<double>(bitmap->getHeight()) / sourceBitmap->getHeight(), 1)) * invTransform;
+        }
+
         // Calculate filter table
-        Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s inside the raster dataset", mapTile.toString().c_str());
-        BitmapFilterTable filterTable(0, 0, _bitmap->getWidth(), _bitmap->getHeight());
+        Log::Infof("BitmapOverlayRasterTileDataSource: Tile %s inside the raster dataset, pyramid level %d", mapTile.toString().c_str(), level);
+        BitmapFilterTable filterTable(0, 0, bitmap->getWidth(), bitmap->getHeight());
         filterTable.calculateFilterTable(ProjectiveTransform(invTransform), _tileSize, _tileSize, FILTER_SCALE, MAX_FILTER_WIDTH);
         
         std::size_t sampleIndex = 0;
@@ -182,7 +269,7 @@ namespace carto {
             float color[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
             for (int j = 0; j < count; j++) {
                 const BitmapFilterTable::Sample& sample = samples[sampleIndex++];
-                const unsigned char* sampleData = &_bitmap->getPixelData()[(sample.v * _bitmap->getWidth() + sample.u) * 4];
+                const unsigned char* sampleData = &bitmap->getPixelData()[(sample.v * bitmap->getWidth() + sample.u) * 4];
                 for (int c = 0; c < 4; c++) {
                     color[c] += sampleData[c] * sample.weight;
                 }
@@ -193,10 +280,67 @@ namespace carto {
         }
 
         // Build bitmap, "compress" (serialize) to internal format
-        Bitmap bitmap(data.data(), _tileSize, _tileSize, ColorFormat::COLOR_FORMAT_RGBA, 4 * _tileSize);
-        return std::make_shared<TileData>(bitmap.compressToInternal());
+        Bitmap tileBitmap(data.data(), _tileSize, _tileSize, ColorFormat::COLOR_FORMAT_RGBA, 4 * _tileSize);
+        auto tileData = std::make_shared<TileData>(tileBitmap.compressToInternal());
+
+        // Cache the tile, unless the bitmap was replaced while generating it
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_bitmap == sourceBitmap) {
+                _tileCache.put(mapTile.getTileId(), tileData, tileData->getData() ? tileData->getData()->size() : 0);
+            }
+        }
+        return tileData;
+    }
+
+    void BitmapOverlayRasterTileDataSource::startPyramidBuild() {
+        std::shared_ptr<Bitmap> bitmap;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            bitmap = _bitmap;
+        }
+        _pyramidThread = std::thread(&BitmapOverlayRasterTileDataSource::buildPyramid, this, bitmap);
+    }
+
+    void BitmapOverlayRasterTileDataSource::buildPyramid(const std::shared_ptr<Bitmap>& bitmap) {
+        // Levels are published one by one, so tiles can use the levels that are already built
+        std::shared_ptr<Bitmap> level = bitmap;
+        while (level->getWidth() > 1 || level->getHeight() > 1) {
+            level = DownsampleBitmap(*level);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_bitmap != bitmap) {
+                return;
+            }
+            _pyramidLevels.push_back(level);
+        }
+    }
+
+    std::shared_ptr<Bitmap> BitmapOverlayRasterTileDataSource::DownsampleBitmap(const Bitmap& bitmap) {
+        unsigned int width = bitmap.getWidth();
+        unsigned int height = bitmap.getHeight();
+        unsigned int levelWidth = (width + 1) / 2;
+        unsigned int levelHeight = (height + 1) / 2;
+
+        // Average 2x2 blocks, the last row/column is repeated for odd sizes
+        const std::vector<unsigned char>& pixelData = bitmap.getPixelData();
+        std::vector<unsigned char> levelData(levelWidth * levelHeight * 4);
+        for (unsigned int y = 0; y < levelHeight; y++) {
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, height - 1);
+            for (unsigned int x = 0; x < levelWidth; x++) {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, width - 1);
+                for (int c = 0; c < 4; c++) {
+                    unsigned int sum = pixelData[(y0 * width + x0) * 4 + c] + pixelData[(y0 * width + x1) * 4 + c] + pixelData[(y1 * width + x0) * 4 + c] + pixelData[(y1 * width + x1) * 4 + c];
+                    levelData[(y * levelWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return std::make_shared<Bitmap>(levelData.data(), levelWidth, levelHeight, ColorFormat::COLOR_FORMAT_RGBA, 4 * levelWidth);
     }
 
     const float BitmapOverlayRasterTileDataSource::FILTER_SCALE = 1.5f;
     const int BitmapOverlayRasterTileDataSource::MAX_FILTER_WIDTH = 16;
+    const std::size_t BitmapOverlayRasterTileDataSource::TILE_CACHE_SIZE = 8 * 1024 * 1024;
 }
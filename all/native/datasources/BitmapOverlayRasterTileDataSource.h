@@ -11,8 +11,14 @@
 #include "core/ScreenPos.h"
 #include "datasources/TileDataSource.h"
 
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <cglib/mat.h>
 
+#include <stdext/timed_lru_cache.h>
+
 namespace carto {
     class Bitmap;
     class Projection;
@@ -20,6 +26,7 @@ namespace carto {
     /**
      * Tile data source that uses given bitmap with two, three or four control points define a raster overlay.
      * Note: if two points are given, conformal transformation is calculated. If three points are given, affine transformation is calculated. In case of four points, perspective transformation is used.
+     * A mip pyramid of the bitmap is built in a background thread, tiles are generated from the closest pyramid level.
      */
     class BitmapOverlayRasterTileDataSource : public TileDataSource {
     public:
@@ -36,13 +43,32 @@ namespace carto {
         BitmapOverlayRasterTileDataSource(int minZoom, int maxZoom, const std::shared_ptr<Bitmap>& bitmap, const std::shared_ptr<Projection>& projection, const std::vector<MapPos>& mapPoses, const std::vector<ScreenPos>& bitmapPoses);
         virtual ~BitmapOverlayRasterTileDataSource();
 
+        /**
+         * Returns the overlay bitmap.
+         * @return The overlay bitmap.
+         */
+        std::shared_ptr<Bitmap> getBitmap() const;
+        /**
+         * Sets the overlay bitmap. The new bitmap covers the same area as the previous bitmap, control points are scaled if the bitmap size is different.
+         * If the bitmap is the same as the current bitmap, the existing pyramid and tiles are kept.
+         * @param bitmap The new overlay bitmap.
+         * @throws std::invalid_argument If the bitmap is null.
+         */
+        void setBitmap(const std::shared_ptr<Bitmap>& bitmap);
+
         virtual MapBounds getDataExtent() const;
 
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
         
     private:
+        void startPyramidBuild();
+        void buildPyramid(const std::shared_ptr<Bitmap>& bitmap);
+
+        static std::shared_ptr<Bitmap> DownsampleBitmap(const Bitmap& bitmap);
+
         static const float FILTER_SCALE;
         static const int MAX_FILTER_WIDTH;
+        static const std::size_t TILE_CACHE_SIZE;
 
         int _tileSize;
 
@@ -51,6 +77,13 @@ namespace carto {
         cglib::mat3x3<double> _invTransform;
         std::shared_ptr<Bitmap> _bitmap;
         std::shared_ptr<Projection> _projection;
+
+        std::vector<std::shared_ptr<Bitmap> > _pyramidLevels; // levels built so far, level 0 is _bitmap
+        std::thread _pyramidThread;
+        std::mutex _pyramidThreadMutex;
+        cache::timed_lru_cache<long long, std::shared_ptr<TileData> > _tileCache;
+
+        mutable std::mutex _mutex;
     };
 }
 
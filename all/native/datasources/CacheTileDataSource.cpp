@@ -1,15 +1,27 @@
 #include "CacheTileDataSource.h"
 #include "core/MapTile.h"
+#include "components/CancelableThreadPool.h"
 #include "components/Exceptions.h"
+#include "projections/Projection.h"
+#include "utils/Const.h"
+#include "utils/TileUtils.h"
 #include "utils/Log.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace carto {
     
     CacheTileDataSource::CacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource) :
         TileDataSource(),
-        _dataSource(dataSource)
+        _dataSource(dataSource),
+        _dataSourceListener(),
+        _staleTileGracePeriod(0),
+        _staleHitCount(0),
+        _refreshTiles(),
+        _refreshTaskScheduled(false),
+        _refreshMutex()
     {
         if (!dataSource) {
             throw NullArgumentException("Null dataSource");
@@ -20,6 +32,7 @@ namespace carto {
     }
     
     CacheTileDataSource::~CacheTileDataSource() {
+        // Pending refresh tasks in the shared pool only hold weak references and become no-ops
         _dataSource->unregisterOnChangeListener(_dataSourceListener);
         _dataSourceListener.reset();
     }
@@ -36,14 +49,169 @@ namespace carto {
         return _dataSource->getDataExtent();
     }
 
+    bool CacheTileDataSource::isBatchLoadingSupported() const {
+        return _dataSource->isBatchLoadingSupported();
+    }
+
+    std::vector<std::shared_ptr<TileData> > CacheTileDataSource::loadTiles(const std::vector<MapTile>& mapTiles) {
+        // Tiles missing from the cache are loaded from the original data source as a single batch, cached tiles are loaded one by one
+        std::vector<MapTile> missingTiles;
+        if (_dataSource->isBatchLoadingSupported()) {
+            for (const MapTile& mapTile : mapTiles) {
+                if (!isTileCached(mapTile)) {
+                    missingTiles.push_back(mapTile);
+                }
+            }
+        }
+        if (missingTiles.size() < 2) {
+            return TileDataSource::loadTiles(mapTiles);
+        }
+
+        std::vector<std::shared_ptr<TileData> > missingTileDatas = _dataSource->loadTiles(missingTiles);
+        missingTileDatas.resize(missingTiles.size());
+
+        std::vector<std::shared_ptr<TileData> > tileDatas;
+        tileDatas.reserve(mapTiles.size());
+        std::size_t missingIndex = 0;
+        for (const MapTile& mapTile : mapTiles) {
+            if (missingIndex < missingTiles.size() && missingTiles[missingIndex] == mapTile) {
+                const std::shared_ptr<TileData>& tileData = missingTileDatas[missingIndex++];
+                if (tileData) {
+                    storeLoadedTile(mapTile, tileData);
+                }
+                tileDatas.push_back(tileData);
+            } else {
+                tileDatas.push_back(loadTile(mapTile));
+            }
+        }
+        return tileDatas;
+    }
+
     void CacheTileDataSource::notifyTilesChanged(bool removeTiles) {
         clear();
         TileDataSource::notifyTilesChanged(removeTiles);
     }
 
+    void CacheTileDataSource::notifyTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        // Only the cached tiles intersecting the bounds are dropped, the whole cache is cleared only if the bounds cover too many tiles
+        if (!removeCachedTiles(bounds)) {
+            clear();
+        }
+        TileDataSource::notifyTilesChanged(removeTiles, bounds);
+    }
+
     std::shared_ptr<TileDataSource> CacheTileDataSource::getDataSource() const {
         return _dataSource.get();
     }
+
+    long long CacheTileDataSource::getStaleTileGracePeriod() const {
+        return _staleTileGracePeriod.load();
+    }
+
+    void CacheTileDataSource::setStaleTileGracePeriod(long long gracePeriod) {
+        _staleTileGracePeriod.store(gracePeriod);
+    }
+
+    long long CacheTileDataSource::getStaleHitCount() const {
+        return _staleHitCount.load();
+    }
+
+    std::shared_ptr<TileData> CacheTileDataSource::useStaleTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData, long long staleAge) {
+        if (!tileData || staleAge < 0 || staleAge > _staleTileGracePeriod.load()) {
+            return std::shared_ptr<TileData>();
+        }
+        _staleHitCount++;
+
+        // Queue the tile for refreshing, a single task refreshes all queued tiles
+        bool scheduleTask = false;
+        {
+            std::lock_guard<std::mutex> lock(_refreshMutex);
+            if (_refreshTiles.insert(mapTile).second && !_refreshTaskScheduled) {
+                _refreshTaskScheduled = true;
+                scheduleTask = true;
+            }
+        }
+        if (scheduleTask) {
+            auto task = std::make_shared<RefreshTask>(std::static_pointer_cast<CacheTileDataSource>(shared_from_this()));
+            GetRefreshThreadPool()->execute(task);
+        }
+
+        // Return a copy with a short expiration time, so that the tile is not immediately reloaded while the refresh is pending
+        auto staleTileData = std::make_shared<TileData>(tileData->getData());
+        staleTileData->setMaxAge(STALE_TILE_MAX_AGE);
+        staleTileData->setReplaceWithParent(tileData->isReplaceWithParent());
+        staleTileData->setETag(tileData->getETag());
+        staleTileData->setLastModified(tileData->getLastModified());
+        return staleTileData;
+    }
+
+    bool CacheTileDataSource::refreshTile(const MapTile& mapTile) {
+        return false;
+    }
+
+    void CacheTileDataSource::refreshTiles() {
+        std::vector<MapTile> refreshedTiles;
+        while (true) {
+            MapTile mapTile;
+            {
+                std::lock_guard<std::mutex> lock(_refreshMutex);
+                if (_refreshTiles.empty()) {
+                    _refreshTaskScheduled = false;
+                    break;
+                }
+                mapTile = *_refreshTiles.begin();
+                _refreshTiles.erase(_refreshTiles.begin());
+            }
+
+            try {
+                if (refreshTile(mapTile)) {
+                    refreshedTiles.push_back(mapTile);
+                }
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("CacheTileDataSource::refreshTiles: Exception while refreshing tile: %s", ex.what());
+            }
+        }
+
+        // Notify listeners about the refreshed tiles only, without clearing the cache as the tiles are already stored in it
+        for (const MapTile& mapTile : refreshedTiles) {
+            TileDataSource::notifyTilesChanged(false, TileUtils::CalculateMapTileBounds(mapTile, _dataSource->getProjection()));
+        }
+    }
+
+    bool CacheTileDataSource::removeCachedTiles(const MapBounds& bounds) {
+        std::shared_ptr<Projection> proj = _dataSource->getProjection();
+        std::vector<MapTile> mapTiles;
+        for (int zoom = std::max(0, _dataSource->getMinZoom()); zoom <= std::min(Const::MAX_SUPPORTED_ZOOM_LEVEL, _dataSource->getMaxZoom()); zoom++) {
+            // Expand the bounds by the tile buffer, changed features just outside of the tile may still be included in it
+            MapVec buffer(proj->getBounds().getDelta().getX() / (1 << zoom) * CHANGED_TILE_BUFFER, proj->getBounds().getDelta().getY() / (1 << zoom) * CHANGED_TILE_BUFFER);
+            MapTile minTile = TileUtils::CalculateClippedMapTile(bounds.getMin() - buffer, zoom, proj);
+            MapTile maxTile = TileUtils::CalculateClippedMapTile(bounds.getMax() + buffer, zoom, proj);
+            long long tileCount = static_cast<long long>(maxTile.getX() - minTile.getX() + 1) * (maxTile.getY() - minTile.getY() + 1);
+            if (static_cast<long long>(mapTiles.size()) + tileCount > MAX_REMOVED_TILES) {
+                return false;
+            }
+            for (int y = minTile.getY(); y <= maxTile.getY(); y++) {
+                for (int x = minTile.getX(); x <= maxTile.getX(); x++) {
+                    mapTiles.push_back(MapTile(x, y, zoom, 0).getFlipped());
+                }
+            }
+        }
+
+        for (const MapTile& mapTile : mapTiles) {
+            removeCachedTile(mapTile);
+        }
+        return true;
+    }
+
+    std::shared_ptr<CancelableThreadPool> CacheTileDataSource::GetRefreshThreadPool() {
+        static std::shared_ptr<CancelableThreadPool> threadPool = []() {
+            auto threadPool = std::make_shared<CancelableThreadPool>();
+            threadPool->setPoolSize(REFRESH_THREAD_POOL_SIZE);
+            return threadPool;
+        }();
+        return threadPool;
+    }
     
     CacheTileDataSource::DataSourceListener::DataSourceListener(CacheTileDataSource& cacheDataSource) :
         _cacheDataSource(cacheDataSource)
@@ -54,4 +222,27 @@ namespace carto {
         _cacheDataSource.notifyTilesChanged(removeTiles);
     }
 
+    void CacheTileDataSource::DataSourceListener::onTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        _cacheDataSource.notifyTilesChanged(removeTiles, bounds);
+    }
+
+    CacheTileDataSource::RefreshTask::RefreshTask(const std::shared_ptr<CacheTileDataSource>& dataSource) :
+        _dataSource(dataSource)
+    {
+    }
+
+    void CacheTileDataSource::RefreshTask::run() {
+        if (auto dataSource = _dataSource.lock()) {
+            dataSource->refreshTiles();
+        }
+    }
+
+    const long long CacheTileDataSource::STALE_TILE_MAX_AGE = 5000;
+
+    const double CacheTileDataSource::CHANGED_TILE_BUFFER = 0.125;
+
+    const int CacheTileDataSource::MAX_REMOVED_TILES = 4096;
+
+    const int CacheTileDataSource::REFRESH_THREAD_POOL_SIZE = 1;
+
 }
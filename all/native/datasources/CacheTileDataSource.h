@@ -8,9 +8,15 @@
 #define _CARTO_CACHETILEDATASOURCE_H_
 
 #include "datasources/TileDataSource.h"
+#include "components/CancelableTask.h"
 #include "components/DirectorPtr.h"
 
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
 namespace carto {
+    class CancelableThreadPool;
     
     /**
      * A tile data source that loads tiles from another tile data source and caches them.
@@ -24,7 +30,11 @@ namespace carto {
         
         virtual MapBounds getDataExtent() const;
 
+        virtual bool isBatchLoadingSupported() const;
+        virtual std::vector<std::shared_ptr<TileData> > loadTiles(const std::vector<MapTile>& mapTiles);
+
         virtual void notifyTilesChanged(bool removeTiles);
+        virtual void notifyTilesChanged(bool removeTiles, const MapBounds& bounds);
 
         /**
          * Returns the original data source that the cache uses.
@@ -48,23 +58,79 @@ namespace carto {
          */
         virtual void setCapacity(std::size_t capacityInBytes) = 0;
 
+        /**
+         * Returns the grace period for expired tiles.
+         * @return The grace period for expired tiles in milliseconds.
+         */
+        long long getStaleTileGracePeriod() const;
+        /**
+         * Sets the grace period for expired tiles. Tiles that have expired less than the specified time ago
+         * are returned from the cache immediately, while the tiles are refreshed from the original data source
+         * in the background. Once refreshed tiles are loaded, the data source is marked as changed.
+         * The default is 0, meaning that expired tiles are always loaded from the original data source before returning.
+         * @param gracePeriod The grace period for expired tiles in milliseconds.
+         */
+        void setStaleTileGracePeriod(long long gracePeriod);
+
+        /**
+         * Returns the number of expired tiles returned from the cache within the grace period.
+         * @return The number of stale tile hits.
+         */
+        long long getStaleHitCount() const;
+
     protected:
         class DataSourceListener : public TileDataSource::OnChangeListener {
         public:
             explicit DataSourceListener(CacheTileDataSource& cacheDataSource);
             
             virtual void onTilesChanged(bool removeTiles);
+            virtual void onTilesChanged(bool removeTiles, const MapBounds& bounds);
             
         private:
             CacheTileDataSource& _cacheDataSource;
         };
         
+        class RefreshTask : public CancelableTask {
+        public:
+            explicit RefreshTask(const std::shared_ptr<CacheTileDataSource>& dataSource);
+
+            virtual void run();
+
+        private:
+            std::weak_ptr<CacheTileDataSource> _dataSource;
+        };
+        
         CacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource);
 
+        std::shared_ptr<TileData> useStaleTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData, long long staleAge);
+
+        virtual bool refreshTile(const MapTile& mapTile);
+
+        virtual bool isTileCached(const MapTile& mapTile) = 0;
+        virtual void storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData) = 0;
+        virtual void removeCachedTile(const MapTile& mapTile) = 0;
+
         const DirectorPtr<TileDataSource> _dataSource;
         
     private:
+        void refreshTiles();
+        bool removeCachedTiles(const MapBounds& bounds);
+
+        static std::shared_ptr<CancelableThreadPool> GetRefreshThreadPool();
+
+        static const long long STALE_TILE_MAX_AGE;
+        static const double CHANGED_TILE_BUFFER;
+        static const int MAX_REMOVED_TILES;
+        static const int REFRESH_THREAD_POOL_SIZE;
+
         std::shared_ptr<DataSourceListener> _dataSourceListener;
+
+        std::atomic<long long> _staleTileGracePeriod;
+        std::atomic<long long> _staleHitCount;
+
+        std::unordered_set<MapTile> _refreshTiles;
+        bool _refreshTaskScheduled;
+        std::mutex _refreshMutex;
     };
     
 }
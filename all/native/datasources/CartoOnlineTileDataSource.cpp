@@ -32,6 +32,7 @@ namespace carto {
         _mutex()
     {
         _maxZoom = DEFAULT_MAX_ZOOM;
+        _httpClient.setLimitHostRequests(true);
     }
     
     CartoOnlineTileDataSource::~CartoOnlineTileDataSource() {
@@ -0,0 +1,185 @@
+#include "CoalescingTileDataSource.h"
+#include "core/MapTile.h"
+#include "components/Exceptions.h"
+
+#include <memory>
+
+namespace carto {
+
+    CoalescingTileDataSource::CoalescingTileDataSource(const std::shared_ptr<TileDataSource>& dataSource) :
+        TileDataSource(),
+        _dataSource(dataSource),
+        _pendingLoads(),
+        _loadCount(0),
+        _coalescedLoadCount(0),
+        _mutex()
+    {
+        if (!dataSource) {
+            throw NullArgumentException("Null dataSource");
+        }
+
+        _dataSourceListener = std::make_shared<DataSourceListener>(*this);
+        _dataSource->registerOnChangeListener(_dataSourceListener);
+    }
+
+    CoalescingTileDataSource::~CoalescingTileDataSource() {
+        _dataSource->unregisterOnChangeListener(_dataSourceListener);
+        _dataSourceListener.reset();
+    }
+
+    int CoalescingTileDataSource::getMinZoom() const {
+        return _dataSource->getMinZoom();
+    }
+
+    int CoalescingTileDataSource::getMaxZoom() const {
+        return _dataSource->getMaxZoom();
+    }
+
+    MapBounds CoalescingTileDataSource::getDataExtent() const {
+        return _dataSource->getDataExtent();
+    }
+
+    std::shared_ptr<TileData> CoalescingTileDataSource::loadTile(const MapTile& mapTile) {
+        std::promise<std::shared_ptr<TileData> > promise;
+        std::shared_ptr<TileDataFuture> future;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            auto it = _pendingLoads.find(mapTile);
+            if (it != _pendingLoads.end()) {
+                // Tile is already being loaded, wait for the result outside of the lock
+                future = it->second;
+                lock.unlock();
+
+                _coalescedLoadCount++;
+                return future->get();
+            }
+
+            future = std::make_shared<TileDataFuture>(promise.get_future().share());
+            _pendingLoads[mapTile] = future;
+        }
+
+        _loadCount++;
+        std::shared_ptr<TileData> tileData;
+        try {
+            tileData = _dataSource->loadTile(mapTile);
+            promise.set_value(tileData);
+        }
+        catch (...) {
+            promise.set_exception(std::current_exception());
+            removePendingLoad(mapTile, future);
+            throw;
+        }
+        removePendingLoad(mapTile, future);
+        return tileData;
+    }
+
+    bool CoalescingTileDataSource::isBatchLoadingSupported() const {
+        return _dataSource->isBatchLoadingSupported();
+    }
+
+    std::vector<std::shared_ptr<TileData> > CoalescingTileDataSource::loadTiles(const std::vector<MapTile>& mapTiles) {
+        // Tiles that are already being loaded are waited for, the remaining tiles are loaded as a single batch
+        std::vector<std::shared_ptr<TileDataFuture> > futures(mapTiles.size());
+        std::vector<std::promise<std::shared_ptr<TileData> > > promises;
+        std::vector<MapTile> batchTiles;
+        std::vector<std::size_t> batchIndices;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            promises.reserve(mapTiles.size());
+            for (std::size_t i = 0; i < mapTiles.size(); i++) {
+                auto it = _pendingLoads.find(mapTiles[i]);
+                if (it != _pendingLoads.end()) {
+                    futures[i] = it->second;
+                    _coalescedLoadCount++;
+                    continue;
+                }
+
+                promises.emplace_back();
+                futures[i] = std::make_shared<TileDataFuture>(promises.back().get_future().share());
+                _pendingLoads[mapTiles[i]] = futures[i];
+                batchTiles.push_back(mapTiles[i]);
+                batchIndices.push_back(i);
+            }
+        }
+
+        if (!batchTiles.empty()) {
+            _loadCount += batchTiles.size();
+            std::vector<std::shared_ptr<TileData> > batchTileDatas;
+            try {
+                batchTileDatas = _dataSource->loadTiles(batchTiles);
+            }
+            catch (...) {
+                for (std::size_t j = 0; j < batchTiles.size(); j++) {
+                    promises[j].set_exception(std::current_exception());
+                    removePendingLoad(batchTiles[j], futures[batchIndices[j]]);
+                }
+                throw;
+            }
+            batchTileDatas.resize(batchTiles.size());
+            for (std::size_t j = 0; j < batchTiles.size(); j++) {
+                promises[j].set_value(batchTileDatas[j]);
+                removePendingLoad(batchTiles[j], futures[batchIndices[j]]);
+            }
+        }
+
+        std::vector<std::shared_ptr<TileData> > tileDatas;
+        tileDatas.reserve(mapTiles.size());
+        for (const std::shared_ptr<TileDataFuture>& future : futures) {
+            tileDatas.push_back(future->get());
+        }
+        return tileDatas;
+    }
+
+    void CoalescingTileDataSource::notifyTilesChanged(bool removeTiles) {
+        {
+            // Requests made after this point should not receive the results of the pending loads
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pendingLoads.clear();
+        }
+        TileDataSource::notifyTilesChanged(removeTiles);
+    }
+
+    void CoalescingTileDataSource::notifyTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pendingLoads.clear();
+        }
+        TileDataSource::notifyTilesChanged(removeTiles, bounds);
+    }
+
+    std::shared_ptr<TileDataSource> CoalescingTileDataSource::getDataSource() const {
+        return _dataSource.get();
+    }
+
+    long long CoalescingTileDataSource::getLoadCount() const {
+        return _loadCount.load();
+    }
+
+    long long CoalescingTileDataSource::getCoalescedLoadCount() const {
+        return _coalescedLoadCount.load();
+    }
+
+    void CoalescingTileDataSource::removePendingLoad(const MapTile& mapTile, const std::shared_ptr<TileDataFuture>& future) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _pendingLoads.find(mapTile);
+        if (it != _pendingLoads.end() && it->second == future) {
+            _pendingLoads.erase(it);
+        }
+    }
+
+    CoalescingTileDataSource::DataSourceListener::DataSourceListener(CoalescingTileDataSource& coalescingDataSource) :
+        _coalescingDataSource(coalescingDataSource)
+    {
+    }
+
+    void CoalescingTileDataSource::DataSourceListener::onTilesChanged(bool removeTiles) {
+        _coalescingDataSource.notifyTilesChanged(removeTiles);
+    }
+
+    void CoalescingTileDataSource::DataSourceListener::onTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        _coalescingDataSource.notifyTilesChanged(removeTiles, bounds);
+    }
+
+}
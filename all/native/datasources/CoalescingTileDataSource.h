@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_COALESCINGTILEDATASOURCE_H_
+#define _CARTO_COALESCINGTILEDATASOURCE_H_
+
+#include "datasources/TileDataSource.h"
+#include "components/DirectorPtr.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace carto {
+
+    /**
+     * A tile data source that merges concurrent requests for the same tile.
+     * If a tile is requested while the same tile is already being loaded from the original data source,
+     * the request waits for the pending load and shares its result instead of loading the tile again.
+     * This is useful when multiple layers use the same data source or when preloading and visible tile requests overlap.
+     * Note: all coalesced requests receive the same TileData instance, so the returned tile data must not be modified.
+     */
+    class CoalescingTileDataSource : public TileDataSource {
+    public:
+        /**
+         * Constructs a CoalescingTileDataSource object from tile data source.
+         * @param dataSource The original datasource.
+         */
+        explicit CoalescingTileDataSource(const std::shared_ptr<TileDataSource>& dataSource);
+        virtual ~CoalescingTileDataSource();
+
+        virtual int getMinZoom() const;
+        virtual int getMaxZoom() const;
+
+        virtual MapBounds getDataExtent() const;
+
+        virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+        virtual bool isBatchLoadingSupported() const;
+        virtual std::vector<std::shared_ptr<TileData> > loadTiles(const std::vector<MapTile>& mapTiles);
+
+        virtual void notifyTilesChanged(bool removeTiles);
+        virtual void notifyTilesChanged(bool removeTiles, const MapBounds& bounds);
+
+        /**
+         * Returns the original data source.
+         * @return The original data source.
+         */
+        std::shared_ptr<TileDataSource> getDataSource() const;
+
+        /**
+         * Returns the number of tile loads delegated to the original data source.
+         * @return The number of tile loads delegated to the original data source.
+         */
+        long long getLoadCount() const;
+        /**
+         * Returns the number of tile requests that were served by sharing the result of another pending load.
+         * @return The number of deduplicated tile requests.
+         */
+        long long getCoalescedLoadCount() const;
+
+    protected:
+        class DataSourceListener : public TileDataSource::OnChangeListener {
+        public:
+            explicit DataSourceListener(CoalescingTileDataSource& coalescingDataSource);
+
+            virtual void onTilesChanged(bool removeTiles);
+            virtual void onTilesChanged(bool removeTiles, const MapBounds& bounds);
+
+        private:
+            CoalescingTileDataSource& _coalescingDataSource;
+        };
+
+        const DirectorPtr<TileDataSource> _dataSource;
+
+    private:
+        typedef std::shared_future<std::shared_ptr<TileData> > TileDataFuture;
+
+        void removePendingLoad(const MapTile& mapTile, const std::shared_ptr<TileDataFuture>& future);
+
+        std::unordered_map<MapTile, std::shared_ptr<TileDataFuture> > _pendingLoads;
+        std::atomic<long long> _loadCount;
+        std::atomic<long long> _coalescedLoadCount;
+        mutable std::mutex _mutex;
+
+        std::shared_ptr<DataSourceListener> _dataSourceListener;
+    };
+
+}
+
+#endif
@@ -19,6 +19,8 @@
 #include "assets/gdal/projop_wparm_csv.h"
 #include "assets/gdal/unit_of_measure_csv.h"
 
+#include <algorithm>
+
 #include <boost/lexical_cast.hpp>
 
 #include <gdal_priv.h>
@@ -90,6 +92,8 @@ namespace carto {
 
     GDALRasterTileDataSource::GDALRasterTileDataSource(int minZoom, int maxZoom, const std::string& fileName) :
         TileDataSource(minZoom, maxZoom),
+        _fileName(fileName),
+        _poDataset(nullptr),
         _width(0),
         _height(0),
         _tileSize(256),
@@ -97,12 +101,18 @@ namespace carto {
         _transform(cglib::mat3x3<double>::identity()),
         _invTransform(cglib::mat3x3<double>::identity()),
         _projection(std::make_shared<EPSG3857>()),
+        _datasetPool(),
+        _datasetCount(1),
+        _maxDatasetCount(MAX_DATASET_HANDLES),
+        _buildingOverviews(false),
+        _datasetCondition(),
         _mutex()
     {
         _poDataset = (GDALDataset*)GDALOpen(fileName.c_str(), GA_ReadOnly);
         if (!_poDataset) {
             throw FileException("Failed to open file", fileName);
         }
+        _datasetPool.push_back(_poDataset);
 
         _width = _poDataset->GetRasterXSize();
         _height = _poDataset->GetRasterYSize();
@@ -119,6 +129,8 @@ namespace carto {
     
     GDALRasterTileDataSource::GDALRasterTileDataSource(int minZoom, int maxZoom, const std::string& fileName, const std::string& srs) :
         TileDataSource(minZoom, maxZoom),
+        _fileName(fileName),
+        _poDataset(nullptr),
         _width(0),
         _height(0),
         _tileSize(256),
@@ -126,12 +138,18 @@ namespace carto {
         _transform(cglib::mat3x3<double>::identity()),
         _invTransform(cglib::mat3x3<double>::identity()),
         _projection(std::make_shared<EPSG3857>()),
+        _datasetPool(),
+        _datasetCount(1),
+        _maxDatasetCount(MAX_DATASET_HANDLES),
+        _buildingOverviews(false),
+        _datasetCondition(),
         _mutex()
     {
         _poDataset = (GDALDataset*)GDALOpen(fileName.c_str(), GA_ReadOnly);
         if (!_poDataset) {
             throw FileException("Failed to open file", fileName);
         }
+        _datasetPool.push_back(_poDataset);
         
         _width = _poDataset->GetRasterXSize();
         _height = _poDataset->GetRasterYSize();
@@ -159,9 +177,71 @@ namespace carto {
     }
     
     GDALRasterTileDataSource::~GDALRasterTileDataSource() {
-        if (_poDataset) {
-            delete _poDataset;
+        for (GDALDataset* poDataset : _datasetPool) {
+            delete poDataset;
+        }
+    }
+
+    bool GDALRasterTileDataSource::hasOverviews() const {
+        if (!_poDataset) {
+            return false;
+        }
+
+        std::shared_ptr<GDALDataset> poDataset(acquireDataset(), [this](GDALDataset* poDataset) { releaseDataset(poDataset); });
+        GDALRasterBand* poRasterBand = poDataset->GetRasterCount() > 0 ? poDataset->GetRasterBand(1) : nullptr;
+        return poRasterBand && poRasterBand->GetOverviewCount() > 0;
+    }
+
+    bool GDALRasterTileDataSource::buildOverviews() {
+        if (!_poDataset) {
+            return false;
+        }
+        if (hasOverviews()) {
+            return true;
+        }
+
+        // Build power-of-two levels until the whole raster fits into a single tile
+        std::vector<int> factors;
+        for (int factor = 2; std::max(_width, _height) / (factor / 2) > _tileSize; factor *= 2) {
+            factors.push_back(factor);
         }
+        if (factors.empty()) {
+            return true;
+        }
+
+        // Wait until all handles are released. Secondary handles are closed, as they would not see the new overviews
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _datasetCondition.wait(lock, [this]() { return !_buildingOverviews; });
+            _buildingOverviews = true;
+            _datasetCondition.wait(lock, [this]() { return static_cast<int>(_datasetPool.size()) == _datasetCount; });
+            for (GDALDataset* poDataset : _datasetPool) {
+                if (poDataset != _poDataset) {
+                    delete poDataset;
+                }
+            }
+            _datasetPool.clear();
+            _datasetCount = 1;
+        }
+
+        Log::Infof("GDALRasterTileDataSource: Building %d overview levels for %s", static_cast<int>(factors.size()), _fileName.c_str());
+        CPLErr err = _poDataset->BuildOverviews("AVERAGE", static_cast<int>(factors.size()), factors.data(), 0, nullptr, nullptr, nullptr);
+        if (err != CE_None) {
+            Log::Errorf("GDALRasterTileDataSource::buildOverviews: Failed to build overviews, error code %d", (int)err);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _datasetPool.push_back(_poDataset);
+            _buildingOverviews = false;
+        }
+        _datasetCondition.notify_all();
+
+        if (err != CE_None) {
+            return false;
+        }
+        notifyTilesChanged(false);
+        return true;
     }
 
     std::shared_ptr<TileData> GDALRasterTileDataSource::loadTile(const MapTile& mapTile) {
@@ -186,6 +266,20 @@ namespace carto {
             return std::shared_ptr<TileData>();
         }
 
+        std::shared_ptr<GDALDataset> poDataset(acquireDataset(), [this](GDALDataset* poDataset) { releaseDataset(poDataset); });
+
+        // Select the overview with the lowest resolution that still has at least one pixel per tile pixel
+        int levelWidth = _width;
+        int levelHeight = _height;
+        double scale = std::min(maxU - minU, maxV - minV) / static_cast<double>(_tileSize);
+        int overviewIndex = SelectOverview(poDataset.get(), scale, levelWidth, levelHeight);
+        if (overviewIndex >= 0) {
+            invTransform = cglib::scale3_matrix(cglib::vec3<double>(static_cast<double>(levelWidth) / _width, static_cast<double>(levelHeight) / _height, 1)) * invTransform;
+            if (!BitmapFilterTable::calculateFilterBounds(AffineTransform(invTransform), _tileSize, _tileSize, levelWidth, levelHeight, minU, minV, maxU, maxV, MAX_FILTER_WIDTH)) {
+                return std::shared_ptr<TileData>();
+            }
+        }
+
         // Adjust downsampling factors. Downsampling allows to keep memory usage in control while degrading quality
         int downsampleU = 0;
         for (; downsampleU < 32; downsampleU++) {
@@ -203,8 +297,8 @@ namespace carto {
         // Clip bounds, calculate downsampled bounds
         minU = std::max(minU, 0);
         minV = std::max(minV, 0);
-        maxU = std::min(maxU, _width);
-        maxV = std::min(maxV, _height);
+        maxU = std::min(maxU, levelWidth);
+        maxV = std::min(maxV, levelHeight);
 
         int minUds = minU >> downsampleU;
         int minVds = minV >> downsampleV;
@@ -215,17 +309,15 @@ namespace carto {
         cglib::mat3x3<double> invTransformDS = cglib::scale3_matrix(cglib::vec3<double>(1.0 / (1 << downsampleU), 1.0 / (1 << downsampleV), 1)) * invTransform;
 
         // Calculate filter table
-        Log::Infof("GDALRasterTileDataSource: Tile %s inside the raster dataset, extent %d,%d ... %d,%d, downsampling %d,%d", mapTile.toString().c_str(), minU, minV, maxU, maxV, downsampleU, downsampleV);
+        Log::Infof("GDALRasterTileDataSource: Tile %s inside the raster dataset, overview %d, extent %d,%d ... %d,%d, downsampling %d,%d", mapTile.toString().c_str(), overviewIndex, minU, minV, maxU, maxV, downsampleU, downsampleV);
         BitmapFilterTable filterTable(minUds, minVds, maxUds, maxVds);
         filterTable.calculateFilterTable(AffineTransform(invTransformDS), _tileSize, _tileSize, FILTER_SCALE, MAX_FILTER_WIDTH);
 
         // Read tile data by band
-        std::lock_guard<std::mutex> lock(_mutex);
-
         std::vector<unsigned char> data(_tileSize * _tileSize * 4);
         std::vector<unsigned char> bandData((maxUds - minUds) * (maxVds - minVds));
-        for (int n = 1; n <= _poDataset->GetRasterCount(); n++) {
-            GDALRasterBand* poRasterBand = _poDataset->GetRasterBand(n);
+        for (int n = 1; n <= poDataset->GetRasterCount(); n++) {
+            GDALRasterBand* poRasterBand = poDataset->GetRasterBand(n);
             if (!poRasterBand) {
                 Log::Warnf("GDALRasterTileDataSource: Failed to read band %d", n);
                 continue;
@@ -257,7 +349,13 @@ namespace carto {
                 continue;
             }
 
-            poRasterBand->RasterIO(GF_Read, minU, minV, maxU - minU, maxV - minV, (void *)&bandData[0], maxUds - minUds, maxVds - minVds, GDT_Byte, 0, 0);
+            GDALRasterBand* poSourceBand = overviewIndex >= 0 ? poRasterBand->GetOverview(overviewIndex) : poRasterBand;
+            if (!poSourceBand) {
+                Log::Warnf("GDALRasterTileDataSource: Failed to read overview %d of band %d", overviewIndex, n);
+                continue;
+            }
+
+            poSourceBand->RasterIO(GF_Read, minU, minV, maxU - minU, maxV - minV, (void *)&bandData[0], maxUds - minUds, maxVds - minVds, GDT_Byte, 0, 0);
 
             std::size_t sampleIndex = 0;
             const std::vector<BitmapFilterTable::Sample>& samples = filterTable.getSamples();
@@ -315,6 +413,64 @@ namespace carto {
         return bounds;
     }
 
+    GDALDataset* GDALRasterTileDataSource::acquireDataset() const {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            if (!_buildingOverviews) {
+                if (!_datasetPool.empty()) {
+                    GDALDataset* poDataset = _datasetPool.back();
+                    _datasetPool.pop_back();
+                    return poDataset;
+                }
+                if (_datasetCount < _maxDatasetCount) {
+                    _datasetCount++;
+                    lock.unlock();
+                    GDALDataset* poDataset = (GDALDataset*)GDALOpen(_fileName.c_str(), GA_ReadOnly);
+                    if (poDataset) {
+                        return poDataset;
+                    }
+                    Log::Errorf("GDALRasterTileDataSource: Failed to open additional handle for file %s", _fileName.c_str());
+                    lock.lock();
+                    _maxDatasetCount = --_datasetCount;
+                    continue;
+                }
+            }
+            _datasetCondition.wait(lock);
+        }
+    }
+
+    void GDALRasterTileDataSource::releaseDataset(GDALDataset* poDataset) const {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _datasetPool.push_back(poDataset);
+        }
+        _datasetCondition.notify_all();
+    }
+
+    int GDALRasterTileDataSource::SelectOverview(GDALDataset* poDataset, double scale, int& levelWidth, int& levelHeight) {
+        GDALRasterBand* poRasterBand = poDataset->GetRasterCount() > 0 ? poDataset->GetRasterBand(1) : nullptr;
+        if (!poRasterBand) {
+            return -1;
+        }
+
+        int overviewIndex = -1;
+        int width = poDataset->GetRasterXSize();
+        int height = poDataset->GetRasterYSize();
+        for (int i = 0; i < poRasterBand->GetOverviewCount(); i++) {
+            GDALRasterBand* poOverview = poRasterBand->GetOverview(i);
+            if (!poOverview || poOverview->GetXSize() <= 0 || poOverview->GetYSize() <= 0) {
+                continue;
+            }
+            double overviewScale = std::max(static_cast<double>(width) / poOverview->GetXSize(), static_cast<double>(height) / poOverview->GetYSize());
+            if (overviewScale <= scale && poOverview->GetXSize() < levelWidth) {
+                overviewIndex = i;
+                levelWidth = poOverview->GetXSize();
+                levelHeight = poOverview->GetYSize();
+            }
+        }
+        return overviewIndex;
+    }
+
     void GDALRasterTileDataSource::initializeTransform(const std::shared_ptr<OGRSpatialReference>& poDatasetSpatialRef) {
         std::shared_ptr<OGRSpatialReference> poEPSG3857SpatialRef = std::make_shared<OGRSpatialReference>();
         if (poEPSG3857SpatialRef->importFromEPSG(3857) != OGRERR_NONE) {
@@ -378,6 +534,7 @@ namespace carto {
     const float GDALRasterTileDataSource::FILTER_SCALE = 1.5f;
     const int GDALRasterTileDataSource::MAX_FILTER_WIDTH = 16;
     const int GDALRasterTileDataSource::MAX_DOWNSAMPLE_FACTOR = 8;
+    const int GDALRasterTileDataSource::MAX_DATASET_HANDLES = 4;
 }
 
 #endif
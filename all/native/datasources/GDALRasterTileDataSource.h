@@ -11,6 +11,11 @@
 
 #include "datasources/TileDataSource.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include <cglib/vec.h>
 #include <cglib/mat.h>
 
@@ -23,6 +28,8 @@ namespace carto {
     /**
      * High-level raster tile data source that supports various GDAL data formats.
      * For example, GeoTiff files can be used using this data source.
+     * Tiles are read using a small pool of dataset handles, so multiple tiles can be loaded concurrently.
+     * If the file contains overviews, the overview closest to the tile resolution is used.
      */
     class GDALRasterTileDataSource : public TileDataSource {
     public:
@@ -45,6 +52,19 @@ namespace carto {
         GDALRasterTileDataSource(int minZoom, int maxZoom, const std::string& fileName, const std::string& srs);
         virtual ~GDALRasterTileDataSource();
 
+        /**
+         * Returns true if the data file contains overviews (reduced resolution versions of the raster).
+         * @return True if the data file contains overviews.
+         */
+        bool hasOverviews() const;
+        /**
+         * Builds overviews for the data file, if the file does not contain overviews yet.
+         * The overviews are stored in a separate .ovr file next to the data file, so the directory must be writable.
+         * This is a slow operation for large files, tile loading is blocked until it is finished.
+         * @return True if the overviews exist or were successfully built, false otherwise.
+         */
+        bool buildOverviews();
+
         virtual MapBounds getDataExtent() const;
 
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
@@ -52,10 +72,17 @@ namespace carto {
     private:
         void initializeTransform(const std::shared_ptr<OGRSpatialReference>& poDatasetSpatialRef);
 
+        GDALDataset* acquireDataset() const;
+        void releaseDataset(GDALDataset* poDataset) const;
+
+        static int SelectOverview(GDALDataset* poDataset, double scale, int& levelWidth, int& levelHeight);
+
         static const float FILTER_SCALE;
         static const int MAX_FILTER_WIDTH;
         static const int MAX_DOWNSAMPLE_FACTOR;
+        static const int MAX_DATASET_HANDLES;
 
+        std::string _fileName;
         GDALDataset* _poDataset;
         int _width;
         int _height;
@@ -65,6 +92,11 @@ namespace carto {
         cglib::mat3x3<double> _invTransform;
         std::shared_ptr<Projection> _projection;
 
+        mutable std::vector<GDALDataset*> _datasetPool; // free dataset handles, _poDataset is the first handle
+        mutable int _datasetCount;
+        mutable int _maxDatasetCount;
+        bool _buildingOverviews;
+        mutable std::condition_variable _datasetCondition;
         mutable std::mutex _mutex;
     };
 }
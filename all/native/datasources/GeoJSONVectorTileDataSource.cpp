@@ -48,11 +48,35 @@ namespace {
 
 namespace carto {
 
+    struct GeoJSONVectorTileDataSource::LayerFeature {
+        enum Type { POINTS, LINES, POLYGONS };
+
+        Type type = POINTS;
+        mbvtbuilder::MBVTTileBuilder::MultiPoint points;
+        mbvtbuilder::MBVTTileBuilder::MultiLineString lines;
+        mbvtbuilder::MBVTTileBuilder::MultiPolygon polygons;
+        picojson::value properties;
+        MapBounds bounds; // in data source projection
+    };
+
+    struct GeoJSONVectorTileDataSource::LayerContents {
+        std::shared_ptr<const picojson::value> geoJSON; // contents set using setLayerGeoJSON
+        std::vector<std::shared_ptr<const LayerFeature> > features; // contents set using setLayerFeatureCollection
+        std::map<long long, std::shared_ptr<const LayerFeature> > featureMap; // features added using addFeatures
+    };
+
     GeoJSONVectorTileDataSource::GeoJSONVectorTileDataSource(int minZoom, int maxZoom) :
         TileDataSource(minZoom, maxZoom),
         _tileBuilder(std::make_unique<mbvtbuilder::MBVTTileBuilder>(minZoom, maxZoom)),
+        _layerContents(),
+        _tileBuilderSnapshot(),
+        _idleTileBuilders(),
+        _activeTileBuilderCount(0),
+        _tileBuilderCondition(),
+        _tileBuilderMutex(),
         _mutex()
     {
+        publishTileBuilderSnapshot();
     }
     
     GeoJSONVectorTileDataSource::~GeoJSONVectorTileDataSource() {
@@ -67,6 +91,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _tileBuilder->setSimplifyTolerance(tolerance);
+            publishTileBuilderSnapshot();
         }
         notifyTilesChanged(false);
     }
@@ -79,6 +104,7 @@ namespace carto {
     void GeoJSONVectorTileDataSource::setDefaultLayerBuffer(float buffer) {
         std::lock_guard<std::mutex> lock(_mutex);
         _tileBuilder->setDefaultLayerBuffer(buffer);
+        publishTileBuilderSnapshot();
     }
 
     int GeoJSONVectorTileDataSource::createLayer(const std::string& name) {
@@ -86,6 +112,7 @@ namespace carto {
         try {
             std::lock_guard<std::mutex> lock(_mutex);
             layerIndex = _tileBuilder->createLayer(name);
+            publishTileBuilderSnapshot();
         }
         catch (const std::exception& ex) {
             Log::Errorf("GeoJSONVectorTileDataSource::createLayer: Failed to create layer: %s", ex.what());
@@ -97,9 +124,11 @@ namespace carto {
 
     void GeoJSONVectorTileDataSource::setLayerGeoJSON(int layerIndex, const Variant& geoJSON) {
         try {
+            auto layerContents = std::make_shared<LayerContents>();
+            layerContents->geoJSON = std::make_shared<picojson::value>(geoJSON.toPicoJSON());
+
             std::lock_guard<std::mutex> lock(_mutex);
-            _tileBuilder->clearLayer(layerIndex);
-            _tileBuilder->importGeoJSONFeatureCollection(layerIndex, geoJSON.toPicoJSON());
+            replaceLayerContents(layerIndex, layerContents);
         }
         catch (const std::exception& ex) {
             Log::Errorf("GeoJSONVectorTileDataSource::setLayerGeoJSON: Failed to update layer: %s", ex.what());
@@ -114,59 +143,155 @@ namespace carto {
         }
 
         try {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _tileBuilder->clearLayer(layerIndex);
+            auto layerContents = std::make_shared<LayerContents>();
+            layerContents->features.reserve(featureCollection->getFeatureCount());
             for (int n = 0; n < featureCollection->getFeatureCount(); n++) {
-                const std::shared_ptr<Feature>& feature = featureCollection->getFeature(n);
-                const std::shared_ptr<Geometry>& geometry = feature->getGeometry();
-                picojson::value properties = feature->getProperties().toPicoJSON();
-
-                if (auto point = std::dynamic_pointer_cast<PointGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiPoint points = { convertPoint(projection, point->getPos()) };
-                    _tileBuilder->addMultiPoint(layerIndex, std::move(points), std::move(properties));
-                } else if (auto line = std::dynamic_pointer_cast<LineGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiLineString lines = { convertPoints(projection, line->getPoses()) };
-                    _tileBuilder->addMultiLineString(layerIndex, std::move(lines), std::move(properties));
-                } else if (auto polygon = std::dynamic_pointer_cast<PolygonGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiPolygon polygons = { convertPointsList(projection, polygon->getRings()) };
-                    _tileBuilder->addMultiPolygon(layerIndex, std::move(polygons), std::move(properties));
-                } else if (auto multiPoint = std::dynamic_pointer_cast<MultiPointGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiPoint points;
-                    points.reserve(multiPoint->getGeometryCount());
-                    for (int i = 0; i < multiPoint->getGeometryCount(); i++) {
-                        points.push_back(convertPoint(projection, multiPoint->getGeometry(i)->getPos()));
+                layerContents->features.push_back(createLayerFeature(projection, featureCollection->getFeature(n)));
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            replaceLayerContents(layerIndex, layerContents);
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("GeoJSONVectorTileDataSource::setLayerFeatureCollection: Failed to update layer: %s", ex.what());
+            throw GenericException("Failed to set layer contents", ex.what());
+        }
+        notifyTilesChanged(false);
+    }
+
+    void GeoJSONVectorTileDataSource::addFeatures(int layerIndex, const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) {
+        if (!featureCollection) {
+            throw NullArgumentException("Null featureCollection");
+        }
+
+        MapBounds changedBounds;
+        try {
+            std::vector<std::shared_ptr<const LayerFeature> > layerFeatures = createLayerFeatures(featureIds, projection, featureCollection);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _layerContents.find(layerIndex);
+            if (it == _layerContents.end()) {
+                auto layerContents = std::make_shared<LayerContents>();
+                for (std::size_t i = 0; i < featureIds.size(); i++) {
+                    if (!layerContents->featureMap.emplace(featureIds[i], layerFeatures[i]).second) {
+                        throw InvalidArgumentException("Feature with given id already exists");
                     }
-                    _tileBuilder->addMultiPoint(layerIndex, std::move(points), std::move(properties));
-                } else if (auto multiLine = std::dynamic_pointer_cast<MultiLineGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiLineString lines;
-                    lines.reserve(multiLine->getGeometryCount());
-                    for (int i = 0; i < multiLine->getGeometryCount(); i++) {
-                        lines.push_back(convertPoints(projection, multiLine->getGeometry(i)->getPoses()));
+                    changedBounds.expandToContain(layerFeatures[i]->bounds);
+                }
+                replaceLayerContents(layerIndex, layerContents);
+            } else {
+                // Existing features are kept in the builder, only the new features are added to it
+                LayerContents& layerContents = *it->second;
+                std::vector<long long> addedFeatureIds;
+                bool builderChanged = false;
+                try {
+                    for (std::size_t i = 0; i < featureIds.size(); i++) {
+                        if (!layerContents.featureMap.emplace(featureIds[i], layerFeatures[i]).second) {
+                            throw InvalidArgumentException("Feature with given id already exists");
+                        }
+                        addedFeatureIds.push_back(featureIds[i]);
+                        changedBounds.expandToContain(layerFeatures[i]->bounds);
                     }
-                    _tileBuilder->addMultiLineString(layerIndex, std::move(lines), std::move(properties));
-                } else if (auto multiPolygon = std::dynamic_pointer_cast<MultiPolygonGeometry>(geometry)) {
-                    mbvtbuilder::MBVTTileBuilder::MultiPolygon polygons;
-                    polygons.reserve(multiPolygon->getGeometryCount());
-                    for (int i = 0; i < multiPolygon->getGeometryCount(); i++) {
-                        polygons.push_back(convertPointsList(projection, multiPolygon->getGeometry(i)->getRings()));
+
+                    builderChanged = true;
+                    for (const std::shared_ptr<const LayerFeature>& layerFeature : layerFeatures) {
+                        addLayerFeature(layerIndex, *layerFeature);
                     }
-                    _tileBuilder->addMultiPolygon(layerIndex, std::move(polygons), std::move(properties));
-                } else {
-                    throw InvalidArgumentException("Unsupported geometry type in feature collection");
+                    publishTileBuilderSnapshot();
+                }
+                catch (const std::exception&) {
+                    for (long long featureId : addedFeatureIds) {
+                        layerContents.featureMap.erase(featureId);
+                    }
+                    if (builderChanged) {
+                        restoreLayer(layerIndex);
+                    }
+                    throw;
                 }
             }
         }
         catch (const std::exception& ex) {
-            Log::Errorf("GeoJSONVectorTileDataSource::setLayerGeoJSON: Failed to update layer: %s", ex.what());
-            throw GenericException("Failed to set layer contents", ex.what());
+            Log::Errorf("GeoJSONVectorTileDataSource::addFeatures: Failed to update layer: %s", ex.what());
+            throw GenericException("Failed to add features", ex.what());
         }
-        notifyTilesChanged(false);
+        if (!featureIds.empty()) {
+            notifyTilesChanged(false, changedBounds);
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::updateFeatures(int layerIndex, const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) {
+        if (!featureCollection) {
+            throw NullArgumentException("Null featureCollection");
+        }
+
+        MapBounds changedBounds;
+        try {
+            std::vector<std::shared_ptr<const LayerFeature> > layerFeatures = createLayerFeatures(featureIds, projection, featureCollection);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _layerContents.find(layerIndex);
+            if (it == _layerContents.end()) {
+                throw InvalidArgumentException("Layer does not exist");
+            }
+            auto newLayerContents = std::make_shared<LayerContents>(*it->second);
+            for (std::size_t i = 0; i < featureIds.size(); i++) {
+                auto featureIt = newLayerContents->featureMap.find(featureIds[i]);
+                if (featureIt == newLayerContents->featureMap.end()) {
+                    throw InvalidArgumentException("Feature with given id does not exist");
+                }
+                changedBounds.expandToContain(featureIt->second->bounds);
+                changedBounds.expandToContain(layerFeatures[i]->bounds);
+                featureIt->second = layerFeatures[i];
+            }
+
+            replaceLayerContents(layerIndex, newLayerContents);
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("GeoJSONVectorTileDataSource::updateFeatures: Failed to update layer: %s", ex.what());
+            throw GenericException("Failed to update features", ex.what());
+        }
+        if (!featureIds.empty()) {
+            notifyTilesChanged(false, changedBounds);
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::removeFeatures(int layerIndex, const std::vector<long long>& featureIds) {
+        MapBounds changedBounds;
+        bool changed = false;
+        try {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _layerContents.find(layerIndex);
+            if (it == _layerContents.end()) {
+                return;
+            }
+            auto newLayerContents = std::make_shared<LayerContents>(*it->second);
+            for (long long featureId : featureIds) {
+                auto featureIt = newLayerContents->featureMap.find(featureId);
+                if (featureIt != newLayerContents->featureMap.end()) {
+                    changedBounds.expandToContain(featureIt->second->bounds);
+                    newLayerContents->featureMap.erase(featureIt);
+                    changed = true;
+                }
+            }
+            if (!changed) {
+                return;
+            }
+
+            replaceLayerContents(layerIndex, newLayerContents);
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("GeoJSONVectorTileDataSource::removeFeatures: Failed to update layer: %s", ex.what());
+            throw GenericException("Failed to remove features", ex.what());
+        }
+        notifyTilesChanged(false, changedBounds);
     }
     
     void GeoJSONVectorTileDataSource::deleteLayer(int layerIndex) {
         try {
             std::lock_guard<std::mutex> lock(_mutex);
             _tileBuilder->deleteLayer(layerIndex);
+            _layerContents.erase(layerIndex);
+            publishTileBuilderSnapshot();
         }
         catch (const std::exception& ex) {
             Log::Errorf("GeoJSONVectorTileDataSource::deleteLayer: Failed to delete layer: %s", ex.what());
@@ -187,18 +312,192 @@ namespace carto {
     }
     
     std::shared_ptr<TileData> GeoJSONVectorTileDataSource::loadTile(const MapTile& mapTile) {
-        std::lock_guard<std::mutex> lock(_mutex);
         Log::Infof("GeoJSONVectorTileDataSource::loadTile: Loading %s", mapTile.toString().c_str());
+
+        // Build the tile using a private copy of the published snapshot, so that builds do not share builder state and are not blocked by updates
+        std::shared_ptr<const mbvtbuilder::MBVTTileBuilder> tileBuilderSnapshot;
+        std::unique_ptr<mbvtbuilder::MBVTTileBuilder> tileBuilder;
+        std::shared_ptr<TileData> tileData;
+        bool built = false;
         try {
+            tileBuilder = acquireTileBuilder(tileBuilderSnapshot);
             protobuf::encoded_message encodedTile;
-            _tileBuilder->buildTile(mapTile.getZoom(), mapTile.getX(), mapTile.getY(), encodedTile);
+            tileBuilder->buildTile(mapTile.getZoom(), mapTile.getX(), mapTile.getY(), encodedTile);
+            built = true;
             auto data = std::make_shared<BinaryData>(reinterpret_cast<const unsigned char*>(encodedTile.data().data()), encodedTile.data().size());
-            return std::make_shared<TileData>(data);
+            tileData = std::make_shared<TileData>(data);
         }
         catch (const std::exception& ex) {
             Log::Errorf("GeoJSONVectorTileDataSource::loadTile: Failed to build tile: %s", ex.what());
-            return std::shared_ptr<TileData>();
+        }
+        if (tileBuilder) {
+            // Builders that failed are not reused
+            releaseTileBuilder(built ? std::move(tileBuilder) : std::unique_ptr<mbvtbuilder::MBVTTileBuilder>(), tileBuilderSnapshot);
+        }
+        return tileData;
+    }
+
+    std::shared_ptr<const GeoJSONVectorTileDataSource::LayerFeature> GeoJSONVectorTileDataSource::createLayerFeature(const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature) const {
+        const std::shared_ptr<Geometry>& geometry = feature->getGeometry();
+
+        auto layerFeature = std::make_shared<LayerFeature>();
+        layerFeature->properties = feature->getProperties().toPicoJSON();
+        if (auto point = std::dynamic_pointer_cast<PointGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::POINTS;
+            layerFeature->points = { convertPoint(projection, point->getPos()) };
+        } else if (auto line = std::dynamic_pointer_cast<LineGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::LINES;
+            layerFeature->lines = { convertPoints(projection, line->getPoses()) };
+        } else if (auto polygon = std::dynamic_pointer_cast<PolygonGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::POLYGONS;
+            layerFeature->polygons = { convertPointsList(projection, polygon->getRings()) };
+        } else if (auto multiPoint = std::dynamic_pointer_cast<MultiPointGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::POINTS;
+            layerFeature->points.reserve(multiPoint->getGeometryCount());
+            for (int i = 0; i < multiPoint->getGeometryCount(); i++) {
+                layerFeature->points.push_back(convertPoint(projection, multiPoint->getGeometry(i)->getPos()));
+            }
+        } else if (auto multiLine = std::dynamic_pointer_cast<MultiLineGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::LINES;
+            layerFeature->lines.reserve(multiLine->getGeometryCount());
+            for (int i = 0; i < multiLine->getGeometryCount(); i++) {
+                layerFeature->lines.push_back(convertPoints(projection, multiLine->getGeometry(i)->getPoses()));
+            }
+        } else if (auto multiPolygon = std::dynamic_pointer_cast<MultiPolygonGeometry>(geometry)) {
+            layerFeature->type = LayerFeature::POLYGONS;
+            layerFeature->polygons.reserve(multiPolygon->getGeometryCount());
+            for (int i = 0; i < multiPolygon->getGeometryCount(); i++) {
+                layerFeature->polygons.push_back(convertPointsList(projection, multiPolygon->getGeometry(i)->getRings()));
+            }
+        } else {
+            throw InvalidArgumentException("Unsupported geometry type in feature collection");
+        }
+
+        // Calculate the bounds in the data source projection, used for notifying about changed tiles
+        const MapBounds& geometryBounds = geometry->getBounds();
+        for (const MapPos& mapPos : { geometryBounds.getMin(), MapPos(geometryBounds.getMin().getX(), geometryBounds.getMax().getY()), MapPos(geometryBounds.getMax().getX(), geometryBounds.getMin().getY()), geometryBounds.getMax() }) {
+            MapPos wgs84Pos = projection ? projection->toWgs84(mapPos) : mapPos;
+            layerFeature->bounds.expandToContain(getProjection()->fromWgs84(wgs84Pos));
+        }
+        return layerFeature;
+    }
+
+    std::vector<std::shared_ptr<const GeoJSONVectorTileDataSource::LayerFeature> > GeoJSONVectorTileDataSource::createLayerFeatures(const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) const {
+        if (static_cast<int>(featureIds.size()) != featureCollection->getFeatureCount()) {
+            throw InvalidArgumentException("Feature id count does not match feature count");
+        }
+
+        std::vector<std::shared_ptr<const LayerFeature> > layerFeatures;
+        layerFeatures.reserve(featureCollection->getFeatureCount());
+        for (int n = 0; n < featureCollection->getFeatureCount(); n++) {
+            layerFeatures.push_back(createLayerFeature(projection, featureCollection->getFeature(n)));
+        }
+        return layerFeatures;
+    }
+
+    void GeoJSONVectorTileDataSource::addLayerFeature(int layerIndex, const LayerFeature& layerFeature) {
+        // Geometry is copied, as the builder takes ownership of it and the converted feature is needed for later rebuilds
+        switch (layerFeature.type) {
+        case LayerFeature::POINTS:
+            _tileBuilder->addMultiPoint(layerIndex, mbvtbuilder::MBVTTileBuilder::MultiPoint(layerFeature.points), picojson::value(layerFeature.properties));
+            break;
+        case LayerFeature::LINES:
+            _tileBuilder->addMultiLineString(layerIndex, mbvtbuilder::MBVTTileBuilder::MultiLineString(layerFeature.lines), picojson::value(layerFeature.properties));
+            break;
+        case LayerFeature::POLYGONS:
+            _tileBuilder->addMultiPolygon(layerIndex, mbvtbuilder::MBVTTileBuilder::MultiPolygon(layerFeature.polygons), picojson::value(layerFeature.properties));
+            break;
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::rebuildLayer(int layerIndex, const LayerContents& layerContents) {
+        // The builder does not support removing individual features, so updated and removed features require filling the layer again from already converted contents
+        _tileBuilder->clearLayer(layerIndex);
+        if (layerContents.geoJSON) {
+            _tileBuilder->importGeoJSONFeatureCollection(layerIndex, *layerContents.geoJSON);
+        }
+        for (const std::shared_ptr<const LayerFeature>& layerFeature : layerContents.features) {
+            addLayerFeature(layerIndex, *layerFeature);
+        }
+        for (auto it = layerContents.featureMap.begin(); it != layerContents.featureMap.end(); it++) {
+            addLayerFeature(layerIndex, *it->second);
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::restoreLayer(int layerIndex) {
+        // Rebuild the layer from the last applied contents, so that a failed update does not leave it partially updated
+        try {
+            auto it = _layerContents.find(layerIndex);
+            if (it != _layerContents.end()) {
+                rebuildLayer(layerIndex, *it->second);
+            } else {
+                _tileBuilder->clearLayer(layerIndex);
+            }
+            publishTileBuilderSnapshot();
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("GeoJSONVectorTileDataSource::restoreLayer: Failed to restore layer: %s", ex.what());
         }
     }
+
+    void GeoJSONVectorTileDataSource::replaceLayerContents(int layerIndex, const std::shared_ptr<LayerContents>& layerContents) {
+        try {
+            rebuildLayer(layerIndex, *layerContents);
+        }
+        catch (const std::exception&) {
+            restoreLayer(layerIndex);
+            throw;
+        }
+        _layerContents[layerIndex] = layerContents;
+        publishTileBuilderSnapshot();
+    }
+
+    std::unique_ptr<mbvtbuilder::MBVTTileBuilder> GeoJSONVectorTileDataSource::acquireTileBuilder(std::shared_ptr<const mbvtbuilder::MBVTTileBuilder>& tileBuilderSnapshot) {
+        {
+            std::unique_lock<std::mutex> lock(_tileBuilderMutex);
+            _tileBuilderCondition.wait(lock, [this]() {
+                return !_idleTileBuilders.empty() || _activeTileBuilderCount < MAX_TILE_BUILDERS;
+            });
+            _activeTileBuilderCount++;
+            tileBuilderSnapshot = _tileBuilderSnapshot;
+
+            if (!_idleTileBuilders.empty()) {
+                std::unique_ptr<mbvtbuilder::MBVTTileBuilder> tileBuilder = std::move(_idleTileBuilders.back());
+                _idleTileBuilders.pop_back();
+                return tileBuilder;
+            }
+        }
+
+        // The snapshot is never modified, so it can be copied without locking
+        try {
+            return std::make_unique<mbvtbuilder::MBVTTileBuilder>(*tileBuilderSnapshot);
+        }
+        catch (...) {
+            releaseTileBuilder(std::unique_ptr<mbvtbuilder::MBVTTileBuilder>(), tileBuilderSnapshot);
+            throw;
+        }
+    }
+
+    void GeoJSONVectorTileDataSource::releaseTileBuilder(std::unique_ptr<mbvtbuilder::MBVTTileBuilder> tileBuilder, const std::shared_ptr<const mbvtbuilder::MBVTTileBuilder>& tileBuilderSnapshot) {
+        {
+            std::lock_guard<std::mutex> lock(_tileBuilderMutex);
+            _activeTileBuilderCount--;
+            if (tileBuilder && tileBuilderSnapshot == _tileBuilderSnapshot) {
+                _idleTileBuilders.push_back(std::move(tileBuilder));
+            }
+        }
+        _tileBuilderCondition.notify_one();
+    }
+
+    void GeoJSONVectorTileDataSource::publishTileBuilderSnapshot() {
+        // The snapshot is copied on the updating thread. Builders copied from older snapshots are dropped once they are released.
+        auto tileBuilderSnapshot = std::make_shared<const mbvtbuilder::MBVTTileBuilder>(*_tileBuilder);
+
+        std::lock_guard<std::mutex> lock(_tileBuilderMutex);
+        _tileBuilderSnapshot = tileBuilderSnapshot;
+        _idleTileBuilders.clear();
+    }
+
+    const int GeoJSONVectorTileDataSource::MAX_TILE_BUILDERS = 4;
     
 }
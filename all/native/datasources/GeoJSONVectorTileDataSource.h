@@ -10,9 +10,12 @@
 #include "core/Variant.h"
 #include "datasources/TileDataSource.h"
 
+#include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace carto {
     namespace mbvtbuilder {
@@ -20,10 +23,12 @@ namespace carto {
     }
 
     class Projection;
+    class Feature;
     class FeatureCollection;
     
     /**
      * A tile data source that builds vector tiles from GeoJSON inputs.
+     * Each tile build uses a private copy of the layer contents published after the last update, so tiles can be built from multiple threads concurrently.
      */
     class GeoJSONVectorTileDataSource : public TileDataSource {
     public:
@@ -83,6 +88,35 @@ namespace carto {
          */
         void setLayerFeatureCollection(int layerIndex, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection);
 
+        /**
+         * Adds features to the specified layer. The features are keyed by ids, so that they can be later updated or removed individually.
+         * Only the tiles covered by the added features are reloaded.
+         * @param layerIndex The index of the layer. A layer with empty name will be created if it does not exist yet.
+         * @param featureIds The ids of the features, one for each feature in featureCollection. The ids must not be used by existing features of the layer.
+         * @param projection Projection for the features in featureCollection. Can be null if the coordinates are based on WGS84.
+         * @param featureCollection The features to add.
+         * @throws std::runtime_error If an error occured during updating the layer.
+         */
+        void addFeatures(int layerIndex, const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection);
+        /**
+         * Replaces existing features of the specified layer. Only the tiles covered by the old or the new features are reloaded.
+         * Note: the layer is rebuilt from all of its features, so the cost of this call is proportional to the size of the layer, not to the number of updated features.
+         * @param layerIndex The index of the layer.
+         * @param featureIds The ids of the features to replace, one for each feature in featureCollection.
+         * @param projection Projection for the features in featureCollection. Can be null if the coordinates are based on WGS84.
+         * @param featureCollection The new features.
+         * @throws std::runtime_error If an error occured during updating the layer, for example if a feature with given id does not exist.
+         */
+        void updateFeatures(int layerIndex, const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection);
+        /**
+         * Removes features from the specified layer. Only the tiles covered by the removed features are reloaded.
+         * Note: the layer is rebuilt from all of its remaining features, so the cost of this call is proportional to the size of the layer, not to the number of removed features.
+         * @param layerIndex The index of the layer.
+         * @param featureIds The ids of the features to remove. Ids of non-existing features are ignored.
+         * @throws std::runtime_error If an error occured during updating the layer.
+         */
+        void removeFeatures(int layerIndex, const std::vector<long long>& featureIds);
+
         /**
          * Deletes an existing layer.
          * @param layerIndex The index of layer to delete.
@@ -94,7 +128,29 @@ namespace carto {
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
     
     private:
-        std::unique_ptr<mbvtbuilder::MBVTTileBuilder> _tileBuilder;
+        struct LayerFeature;
+        struct LayerContents;
+
+        std::shared_ptr<const LayerFeature> createLayerFeature(const std::shared_ptr<Projection>& projection, const std::shared_ptr<Feature>& feature) const;
+        std::vector<std::shared_ptr<const LayerFeature> > createLayerFeatures(const std::vector<long long>& featureIds, const std::shared_ptr<Projection>& projection, const std::shared_ptr<FeatureCollection>& featureCollection) const;
+        void addLayerFeature(int layerIndex, const LayerFeature& layerFeature);
+        void rebuildLayer(int layerIndex, const LayerContents& layerContents);
+        void restoreLayer(int layerIndex);
+        void replaceLayerContents(int layerIndex, const std::shared_ptr<LayerContents>& layerContents);
+
+        std::unique_ptr<mbvtbuilder::MBVTTileBuilder> acquireTileBuilder(std::shared_ptr<const mbvtbuilder::MBVTTileBuilder>& tileBuilderSnapshot);
+        void releaseTileBuilder(std::unique_ptr<mbvtbuilder::MBVTTileBuilder> tileBuilder, const std::shared_ptr<const mbvtbuilder::MBVTTileBuilder>& tileBuilderSnapshot);
+        void publishTileBuilderSnapshot();
+
+        static const int MAX_TILE_BUILDERS;
+
+        std::unique_ptr<mbvtbuilder::MBVTTileBuilder> _tileBuilder; // master copy, only used for updates and creating snapshots
+        std::map<int, std::shared_ptr<LayerContents> > _layerContents; // converted layer contents, used for rebuilding layers after feature updates
+        std::shared_ptr<const mbvtbuilder::MBVTTileBuilder> _tileBuilderSnapshot; // snapshot of the master copy published after each update, only used for copying, guarded by _tileBuilderMutex
+        std::vector<std::unique_ptr<mbvtbuilder::MBVTTileBuilder> > _idleTileBuilders; // private builders copied from the current snapshot, guarded by _tileBuilderMutex
+        int _activeTileBuilderCount;
+        std::condition_variable _tileBuilderCondition;
+        std::mutex _tileBuilderMutex;
         mutable std::mutex _mutex;
     };
     
@@ -18,6 +18,7 @@ namespace carto {
         _randomGenerator(),
         _mutex()
     {
+        _httpClient.setLimitHostRequests(true);
     }
     
     HTTPTileDataSource::~HTTPTileDataSource() {
@@ -100,6 +101,14 @@ namespace carto {
     }
     
     std::shared_ptr<TileData> HTTPTileDataSource::loadTile(const MapTile& mapTile) {
+        return fetchTile(mapTile, std::shared_ptr<TileData>());
+    }
+
+    std::shared_ptr<TileData> HTTPTileDataSource::revalidateTile(const MapTile& mapTile, const std::shared_ptr<TileData>& cachedTileData) {
+        return fetchTile(mapTile, cachedTileData);
+    }
+
+    std::shared_ptr<TileData> HTTPTileDataSource::fetchTile(const MapTile& mapTile, const std::shared_ptr<TileData>& cachedTileData) {
         std::string baseURL;
         std::map<std::string, std::string> headers;
         bool maxAgeHeaderCheck;
@@ -115,20 +124,54 @@ namespace carto {
             return std::shared_ptr<TileData>();
         }
 
+        // If cached data is available, make a conditional request using the validators of the cached data
+        bool conditional = false;
+        if (cachedTileData && cachedTileData->getData()) {
+            std::string etag = cachedTileData->getETag();
+            if (!etag.empty()) {
+                headers["If-None-Match"] = etag;
+                conditional = true;
+            }
+            std::string lastModified = cachedTileData->getLastModified();
+            if (!lastModified.empty()) {
+                headers["If-Modified-Since"] = lastModified;
+                conditional = true;
+            }
+        }
+
         Log::Infof("HTTPTileDataSource::loadTile: Loading %s", url.c_str());
         std::map<std::string, std::string> responseHeaders;
         std::shared_ptr<BinaryData> responseData;
+        std::shared_ptr<TileData> tileData;
         try {
-            if (_httpClient.get(url, headers, responseHeaders, responseData) != 0) {
+            int result = _httpClient.get(url, headers, responseHeaders, responseData);
+            if (result == 304 && conditional) {
+                Log::Infof("HTTPTileDataSource::loadTile: Tile not modified %s", url.c_str());
+                tileData = std::make_shared<TileData>(cachedTileData->getData());
+                tileData->setNotModified(true);
+                tileData->setETag(cachedTileData->getETag());
+                tileData->setLastModified(cachedTileData->getLastModified());
+            } else if (result != 0) {
                 Log::Errorf("HTTPTileDataSource::loadTile: Failed to load %s", url.c_str());
                 return std::shared_ptr<TileData>();
+            } else {
+                tileData = std::make_shared<TileData>(responseData);
             }
         }
         catch (const std::exception& ex) {
             Log::Errorf("HTTPTileDataSource::loadTile: Exception while loading tile %d/%d/%d: %s", mapTile.getZoom(), mapTile.getX(), mapTile.getY(), ex.what());
             return std::shared_ptr<TileData>();
         }
-        auto tileData = std::make_shared<TileData>(responseData);
+
+        // Keep validators for later revalidation, 304 responses may contain updated values
+        std::string etag = NetworkUtils::GetHTTPHeader(responseHeaders, "ETag");
+        if (!etag.empty()) {
+            tileData->setETag(etag);
+        }
+        std::string lastModified = NetworkUtils::GetHTTPHeader(responseHeaders, "Last-Modified");
+        if (!lastModified.empty()) {
+            tileData->setLastModified(lastModified);
+        }
         if (maxAgeHeaderCheck) {
             int maxAge = NetworkUtils::GetMaxAgeHTTPHeader(responseHeaders);
             if (maxAge >= 0) {
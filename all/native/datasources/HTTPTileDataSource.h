@@ -107,9 +107,13 @@ namespace carto {
         void setHTTPHeaders(const std::map<std::string, std::string>& headers);
     
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+        virtual std::shared_ptr<TileData> revalidateTile(const MapTile& mapTile, const std::shared_ptr<TileData>& cachedTileData);
     
     protected:
         virtual std::string buildTileURL(const std::string& baseURL, const MapTile& tile) const;
+
+        std::shared_ptr<TileData> fetchTile(const MapTile& mapTile, const std::shared_ptr<TileData>& cachedTileData);
     
         std::string _baseURL;
         std::vector<std::string> _subdomains;
@@ -8,6 +8,8 @@
 #include "utils/Const.h"
 #include "utils/Log.h"
 
+#include <limits>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -18,7 +20,10 @@ namespace carto {
     MBTilesTileDataSource::MBTilesTileDataSource(const std::string& path) :
         TileDataSource(),
         _scheme(MBTilesScheme::MBTILES_SCHEME_TMS),
+        _path(path),
         _database(OpenDatabase(path)),
+        _idleReadConnections(),
+        _readConnectionMutex(),
         _cachedMinZoom(),
         _cachedMaxZoom(),
         _cachedDataExtent(),
@@ -29,7 +34,10 @@ namespace carto {
     MBTilesTileDataSource::MBTilesTileDataSource(int minZoom, int maxZoom, const std::string& path) :
         TileDataSource(minZoom, maxZoom),
         _scheme(MBTilesScheme::MBTILES_SCHEME_TMS),
+        _path(path),
         _database(OpenDatabase(path)),
+        _idleReadConnections(),
+        _readConnectionMutex(),
         _cachedMinZoom(minZoom),
         _cachedMaxZoom(maxZoom),
         _cachedDataExtent(),
@@ -40,7 +48,10 @@ namespace carto {
     MBTilesTileDataSource::MBTilesTileDataSource(int minZoom, int maxZoom, const std::string& path, MBTilesScheme::MBTilesScheme scheme) :
         TileDataSource(minZoom, maxZoom),
         _scheme(scheme),
+        _path(path),
         _database(OpenDatabase(path)),
+        _idleReadConnections(),
+        _readConnectionMutex(),
         _cachedMinZoom(minZoom),
         _cachedMaxZoom(maxZoom),
         _cachedDataExtent(),
@@ -128,44 +139,103 @@ namespace carto {
     }
     
     std::shared_ptr<TileData> MBTilesTileDataSource::loadTile(const MapTile& mapTile) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
         Log::Infof("MBTilesTileDataSource::loadTile: Loading %s", mapTile.toString().c_str());
-        if (!_database) {
+        std::unique_ptr<sqlite3pp::database> database = acquireReadConnection();
+        if (!database) {
             Log::Errorf("MBTilesTileDataSource::loadTile: Failed to load %s: Couldn't connect to the database", mapTile.toString().c_str());
             return std::shared_ptr<TileData>();
         }
         
+        std::shared_ptr<BinaryData> data;
         try {
             // Make the query and check for database error
-            sqlite3pp::query query(*_database, "SELECT tile_data FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
+            sqlite3pp::query query(*database, "SELECT tile_data FROM tiles WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
             query.bind(":zoom", mapTile.getZoom());
             query.bind(":x", mapTile.getX());
             query.bind(":y", _scheme == MBTilesScheme::MBTILES_SCHEME_XYZ ? mapTile.getY() : (1 << (mapTile.getZoom())) - 1 - mapTile.getY());
             
             auto it = query.begin();
-            if (it == query.end()) {
-                std::shared_ptr<TileData> tileData = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
-                if (mapTile.getZoom() > getMinZoom()) {
-                    Log::Infof("MBTilesTileDataSource::loadTile: Tile data doesn't exist in the database, redirecting to parent");
-                    tileData->setReplaceWithParent(true);
-                } else {
-                    Log::Infof("MBTilesTileDataSource::loadTile: Tile data doesn't exist in the database");
-                    return std::shared_ptr<TileData>();
-                }
-                return tileData;
+            if (it != query.end()) {
+                std::size_t dataSize = (*it).column_bytes(0);
+                const unsigned char* dataPtr = static_cast<const unsigned char*>((*it).get<const void*>(0));
+                data = std::make_shared<BinaryData>(dataPtr, dataSize);
             }
-            
-            std::size_t dataSize = (*it).column_bytes(0);
-            const unsigned char* dataPtr = static_cast<const unsigned char*>((*it).get<const void*>(0));
-            auto data = std::make_shared<BinaryData>(dataPtr, dataSize);
             query.finish();
-    
-            return std::make_shared<TileData>(data);
         }
         catch (const std::exception& ex) {
             Log::Errorf("MBTilesTileDataSource::loadTile: Failed to query tile data from the database: %s", ex.what());
             return std::shared_ptr<TileData>();
         }
+        releaseReadConnection(std::move(database));
+
+        if (!data) {
+            return createMissingTileData(mapTile);
+        }
+        return std::make_shared<TileData>(data);
+    }
+
+    bool MBTilesTileDataSource::isBatchLoadingSupported() const {
+        return true;
+    }
+
+    std::vector<std::shared_ptr<TileData> > MBTilesTileDataSource::loadTiles(const std::vector<MapTile>& mapTiles) {
+        Log::Infof("MBTilesTileDataSource::loadTiles: Loading %d tiles", static_cast<int>(mapTiles.size()));
+        std::unique_ptr<sqlite3pp::database> database = acquireReadConnection();
+        if (!database) {
+            Log::Error("MBTilesTileDataSource::loadTiles: Failed to load tiles: Couldn't connect to the database");
+            return std::vector<std::shared_ptr<TileData> >(mapTiles.size());
+        }
+
+        // Group the tiles by zoom level and tile row, so that each row can be read using a single range query
+        std::map<std::pair<int, int>, std::vector<std::size_t> > tileRows;
+        for (std::size_t i = 0; i < mapTiles.size(); i++) {
+            const MapTile& mapTile = mapTiles[i];
+            int y = _scheme == MBTilesScheme::MBTILES_SCHEME_XYZ ? mapTile.getY() : (1 << (mapTile.getZoom())) - 1 - mapTile.getY();
+            tileRows[std::make_pair(mapTile.getZoom(), y)].push_back(i);
+        }
+
+        std::vector<std::shared_ptr<TileData> > tileDatas(mapTiles.size());
+        std::vector<bool> tilesFound(mapTiles.size(), false);
+        try {
+            sqlite3pp::query query(*database, "SELECT tile_column, tile_data FROM tiles WHERE zoom_level=:zoom AND tile_row=:y AND tile_column>=:x0 AND tile_column<=:x1");
+            for (auto rowIt = tileRows.begin(); rowIt != tileRows.end(); rowIt++) {
+                int x0 = std::numeric_limits<int>::max(), x1 = std::numeric_limits<int>::min();
+                for (std::size_t index : rowIt->second) {
+                    x0 = std::min(x0, mapTiles[index].getX());
+                    x1 = std::max(x1, mapTiles[index].getX());
+                }
+
+                query.reset();
+                query.bind(":zoom", rowIt->first.first);
+                query.bind(":y", rowIt->first.second);
+                query.bind(":x0", x0);
+                query.bind(":x1", x1);
+                for (auto it = query.begin(); it != query.end(); it++) {
+                    int x = (*it).get<int>(0);
+                    for (std::size_t index : rowIt->second) {
+                        if (mapTiles[index].getX() == x && !tilesFound[index]) {
+                            std::size_t dataSize = (*it).column_bytes(1);
+                            const unsigned char* dataPtr = static_cast<const unsigned char*>((*it).get<const void*>(1));
+                            tileDatas[index] = std::make_shared<TileData>(std::make_shared<BinaryData>(dataPtr, dataSize));
+                            tilesFound[index] = true;
+                        }
+                    }
+                }
+            }
+            query.finish();
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("MBTilesTileDataSource::loadTiles: Failed to query tile data from the database: %s", ex.what());
+            return std::vector<std::shared_ptr<TileData> >(mapTiles.size());
+        }
+        releaseReadConnection(std::move(database));
+
+        for (std::size_t i = 0; i < mapTiles.size(); i++) {
+            if (!tilesFound[i]) {
+                tileDatas[i] = createMissingTileData(mapTiles[i]);
+            }
+        }
+        return tileDatas;
     }
 
     std::unique_ptr<sqlite3pp::database> MBTilesTileDataSource::OpenDatabase(const std::string& path) {
@@ -177,6 +247,49 @@ namespace carto {
         return database;
     }
 
+    std::unique_ptr<sqlite3pp::database> MBTilesTileDataSource::OpenReadConnection(const std::string& path) {
+        // Read connections are never shared between threads, so sqlite internal locking can be disabled
+        auto database = std::make_unique<sqlite3pp::database>();
+        if (database->connect_v2(path.c_str(), SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX) != SQLITE_OK) {
+            Log::Errorf("MBTilesTileDataSource: Failed to open read connection to %s", path.c_str());
+            return std::unique_ptr<sqlite3pp::database>();
+        }
+        database->execute("PRAGMA temp_store=MEMORY");
+        database->executef("PRAGMA mmap_size=%lld", READ_CONNECTION_MMAP_SIZE);
+        return database;
+    }
+
+    std::unique_ptr<sqlite3pp::database> MBTilesTileDataSource::acquireReadConnection() {
+        {
+            std::lock_guard<std::mutex> lock(_readConnectionMutex);
+            if (!_idleReadConnections.empty()) {
+                std::unique_ptr<sqlite3pp::database> database = std::move(_idleReadConnections.back());
+                _idleReadConnections.pop_back();
+                return database;
+            }
+        }
+        return OpenReadConnection(_path);
+    }
+
+    void MBTilesTileDataSource::releaseReadConnection(std::unique_ptr<sqlite3pp::database> database) {
+        std::lock_guard<std::mutex> lock(_readConnectionMutex);
+        if (static_cast<int>(_idleReadConnections.size()) < MAX_IDLE_READ_CONNECTIONS) {
+            _idleReadConnections.push_back(std::move(database));
+        }
+    }
+
+    std::shared_ptr<TileData> MBTilesTileDataSource::createMissingTileData(const MapTile& mapTile) const {
+        std::shared_ptr<TileData> tileData = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
+        if (mapTile.getZoom() > getMinZoom()) {
+            Log::Infof("MBTilesTileDataSource: Tile data doesn't exist in the database, redirecting to parent");
+            tileData->setReplaceWithParent(true);
+        } else {
+            Log::Infof("MBTilesTileDataSource: Tile data doesn't exist in the database");
+            return std::shared_ptr<TileData>();
+        }
+        return tileData;
+    }
+
     bool MBTilesTileDataSource::loadZoomLevels(int& minZoom, int& maxZoom) const {
         // First try to use metadata table for min/maxzoom values
         bool foundMinZoom = false, foundMaxZoom = false;
@@ -286,6 +399,9 @@ namespace carto {
         return true;
     }
 
+    const int MBTilesTileDataSource::MAX_IDLE_READ_CONNECTIONS = 8;
+    const long long MBTilesTileDataSource::READ_CONNECTION_MMAP_SIZE = 256LL * 1024 * 1024;
+
 }
 
 #endif
@@ -13,7 +13,10 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace sqlite3pp {
     class database;
@@ -43,6 +46,7 @@ namespace carto {
      * The database must contain table "tiles" with the following fields:
      * "zoom_level" (tile zoom level), "tile_column" (tile x coordinate),
      * "tile_row" (tile y coordinate), "tile_data" (compressed tile image).
+     * Tiles are read using a pool of read-only connections, so tiles can be loaded from multiple threads concurrently.
      */
     class MBTilesTileDataSource : public TileDataSource {
     public:
@@ -89,15 +93,30 @@ namespace carto {
         virtual MapBounds getDataExtent() const;
 
         virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+        virtual bool isBatchLoadingSupported() const;
+        virtual std::vector<std::shared_ptr<TileData> > loadTiles(const std::vector<MapTile>& mapTiles);
     
     private:
         static std::unique_ptr<sqlite3pp::database> OpenDatabase(const std::string& path);
+        static std::unique_ptr<sqlite3pp::database> OpenReadConnection(const std::string& path);
+
+        std::unique_ptr<sqlite3pp::database> acquireReadConnection();
+        void releaseReadConnection(std::unique_ptr<sqlite3pp::database> database);
+
+        std::shared_ptr<TileData> createMissingTileData(const MapTile& mapTile) const;
 
         bool loadZoomLevels(int& minZoom, int& maxZoom) const;
         bool loadDataExtent(MapBounds& mapBounds) const;
 
+        static const int MAX_IDLE_READ_CONNECTIONS;
+        static const long long READ_CONNECTION_MMAP_SIZE;
+
         MBTilesScheme::MBTilesScheme _scheme;
+        std::string _path;
         std::unique_ptr<sqlite3pp::database> _database;
+        std::vector<std::unique_ptr<sqlite3pp::database> > _idleReadConnections;
+        std::mutex _readConnectionMutex;
         mutable std::optional<int> _cachedMinZoom;
         mutable std::optional<int> _cachedMaxZoom;
         mutable std::optional<MapBounds> _cachedDataExtent;
@@ -22,6 +22,7 @@ namespace carto {
         _mutex()
     {
         _maxZoom = DEFAULT_MAX_ZOOM;
+        _httpClient.setLimitHostRequests(true);
     }
     
     MapTilerOnlineTileDataSource::~MapTilerOnlineTileDataSource() {
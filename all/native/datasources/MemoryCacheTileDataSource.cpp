@@ -10,11 +10,22 @@ namespace carto {
     MemoryCacheTileDataSource::MemoryCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource) :
         CacheTileDataSource(dataSource),
         _cache(DEFAULT_CAPACITY),
-        _mutex()
+        _mutex(),
+        _memoryGovernorHandle()
     {
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("MemoryCacheTileDataSource", MemoryTrimLevel::MEMORY_TRIM_LEVEL_MODERATE, DEFAULT_CAPACITY,
+            [this](std::size_t capacityInBytes) {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _cache.resize(capacityInBytes);
+            },
+            [this]() {
+                clear();
+            }
+        );
     }
     
     MemoryCacheTileDataSource::~MemoryCacheTileDataSource() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
     }
     
     std::shared_ptr<TileData> MemoryCacheTileDataSource::loadTile(const MapTile& mapTile) {
@@ -25,10 +36,16 @@ namespace carto {
         std::shared_ptr<TileData> tileData;
         if (_cache.read(mapTile.getTileId(), tileData)) {
             if (tileData->getMaxAge() != 0) {
+                _memoryGovernorHandle->addHit();
                 return tileData;
             }
+            if (std::shared_ptr<TileData> staleTileData = useStaleTile(mapTile, tileData, tileData->getStaleAge())) {
+                _memoryGovernorHandle->addHit();
+                return staleTileData;
+            }
             _cache.remove(mapTile.getTileId());
         }
+        _memoryGovernorHandle->addMiss();
         
         lock.unlock();
         tileData = _dataSource->loadTile(mapTile);
@@ -45,19 +62,47 @@ namespace carto {
         return tileData;
     }
     
+    bool MemoryCacheTileDataSource::refreshTile(const MapTile& mapTile) {
+        std::shared_ptr<TileData> tileData = _dataSource->loadTile(mapTile);
+        if (!tileData || tileData->getMaxAge() == 0 || !tileData->getData() || tileData->isReplaceWithParent()) {
+            return false;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _cache.put(mapTile.getTileId(), tileData, tileData->getData()->size() + 16);
+        return true;
+    }
+
+    bool MemoryCacheTileDataSource::isTileCached(const MapTile& mapTile) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        return _cache.exists(mapTile.getTileId());
+    }
+
+    void MemoryCacheTileDataSource::storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData) {
+        _memoryGovernorHandle->addMiss();
+        if (tileData->getMaxAge() != 0 && tileData->getData() && !tileData->isReplaceWithParent()) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _cache.put(mapTile.getTileId(), tileData, tileData->getData()->size() + 16);
+        }
+    }
+
+    void MemoryCacheTileDataSource::removeCachedTile(const MapTile& mapTile) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _cache.remove(mapTile.getTileId());
+    }
+
     void MemoryCacheTileDataSource::clear() {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         _cache.clear();
     }
     
     std::size_t MemoryCacheTileDataSource::getCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _cache.capacity();
+        return _memoryGovernorHandle->getCapacity();
     }
     
     void MemoryCacheTileDataSource::setCapacity(std::size_t capacityInBytes) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _cache.resize(capacityInBytes);
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
     }
 
     const unsigned int MemoryCacheTileDataSource::DEFAULT_CAPACITY = 6 * 1024 * 1024;
@@ -8,6 +8,7 @@
 #define _CARTO_MEMORYCACHETILEDATASOURCE_H_
 
 #include "datasources/CacheTileDataSource.h"
+#include "utils/MemoryGovernor.h"
 
 #include <stdext/timed_lru_cache.h>
 
@@ -38,8 +39,16 @@ namespace carto {
     protected:
         static const unsigned int DEFAULT_CAPACITY;
 
+        virtual bool refreshTile(const MapTile& mapTile);
+
+        virtual bool isTileCached(const MapTile& mapTile);
+        virtual void storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData);
+        virtual void removeCachedTile(const MapTile& mapTile);
+
         cache::timed_lru_cache<long long, std::shared_ptr<TileData> > _cache;
         mutable std::recursive_mutex _mutex;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
     };
     
 }
@@ -5,15 +5,146 @@
 #include "utils/Log.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <string>
 
 #include <stdext/zlib.h>
 
+namespace {
+
+    // Tile message field containing layers, layer message field containing layer name
+    const std::uint32_t MVT_TILE_LAYERS_FIELD = 3;
+    const std::uint32_t MVT_LAYER_NAME_FIELD = 1;
+
+    const int PROTOBUF_WIRETYPE_VARINT = 0;
+    const int PROTOBUF_WIRETYPE_FIXED64 = 1;
+    const int PROTOBUF_WIRETYPE_LENGTH_DELIMITED = 2;
+    const int PROTOBUF_WIRETYPE_FIXED32 = 5;
+
+    struct ProtobufField {
+        std::uint32_t number;
+        const unsigned char* begin; // start of the field, including the key
+        const unsigned char* end;
+        const unsigned char* payloadBegin; // contents of length-delimited fields
+        const unsigned char* payloadEnd;
+    };
+
+    bool readVarint(const unsigned char*& ptr, const unsigned char* end, std::uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (ptr == end) {
+                return false;
+            }
+            unsigned char byte = *ptr++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readField(const unsigned char*& ptr, const unsigned char* end, ProtobufField& field) {
+        field.begin = ptr;
+        std::uint64_t key = 0;
+        if (!readVarint(ptr, end, key)) {
+            return false;
+        }
+        field.number = static_cast<std::uint32_t>(key >> 3);
+        field.payloadBegin = field.payloadEnd = nullptr;
+        switch (static_cast<int>(key & 7)) {
+        case PROTOBUF_WIRETYPE_VARINT: {
+                std::uint64_t value = 0;
+                if (!readVarint(ptr, end, value)) {
+                    return false;
+                }
+            }
+            break;
+        case PROTOBUF_WIRETYPE_FIXED64:
+            if (end - ptr < 8) {
+                return false;
+            }
+            ptr += 8;
+            break;
+        case PROTOBUF_WIRETYPE_LENGTH_DELIMITED: {
+                std::uint64_t length = 0;
+                if (!readVarint(ptr, end, length) || length > static_cast<std::uint64_t>(end - ptr)) {
+                    return false;
+                }
+                field.payloadBegin = ptr;
+                ptr += length;
+                field.payloadEnd = ptr;
+            }
+            break;
+        case PROTOBUF_WIRETYPE_FIXED32:
+            if (end - ptr < 4) {
+                return false;
+            }
+            ptr += 4;
+            break;
+        default:
+            return false;
+        }
+        field.end = ptr;
+        return true;
+    }
+
+    bool readLayerName(const ProtobufField& layerField, const unsigned char*& name, std::size_t& nameSize) {
+        // Only the field headers of the layer are scanned, features are skipped without decoding
+        const unsigned char* ptr = layerField.payloadBegin;
+        while (ptr != layerField.payloadEnd) {
+            ProtobufField field;
+            if (!readField(ptr, layerField.payloadEnd, field)) {
+                return false;
+            }
+            if (field.number == MVT_LAYER_NAME_FIELD && field.payloadBegin) {
+                name = field.payloadBegin;
+                nameSize = field.payloadEnd - field.payloadBegin;
+                return true;
+            }
+        }
+        name = nullptr;
+        nameSize = 0;
+        return true;
+    }
+
+    bool isLayerField(const ProtobufField& field) {
+        return field.number == MVT_TILE_LAYERS_FIELD && field.payloadBegin;
+    }
+
+    bool containsLayer(const std::vector<unsigned char>& tileData, const unsigned char* name, std::size_t nameSize, bool& found) {
+        found = false;
+        const unsigned char* ptr = tileData.data();
+        const unsigned char* end = ptr + tileData.size();
+        while (ptr != end) {
+            ProtobufField field;
+            if (!readField(ptr, end, field)) {
+                return false;
+            }
+            if (isLayerField(field)) {
+                const unsigned char* layerName = nullptr;
+                std::size_t layerNameSize = 0;
+                if (!readLayerName(field, layerName, layerNameSize)) {
+                    return false;
+                }
+                if (layerNameSize == nameSize && std::equal(name, name + nameSize, layerName)) {
+                    found = true;
+                }
+            }
+        }
+        return true;
+    }
+
+}
+
 namespace carto {
     
     MergedMBVTTileDataSource::MergedMBVTTileDataSource(const std::shared_ptr<TileDataSource>& dataSource1, const std::shared_ptr<TileDataSource>& dataSource2) :
         TileDataSource(),
         _dataSource1(dataSource1),
-        _dataSource2(dataSource2)
+        _dataSource2(dataSource2),
+        _dataSourceListener(),
+        _tileLoader(2)
     {
         if (!dataSource1) {
             throw NullArgumentException("Null dataSource1");
@@ -47,17 +178,39 @@ namespace carto {
         return bounds;
     }
     
+    bool MergedMBVTTileDataSource::isConcurrentLoading() const {
+        return _tileLoader.isConcurrent();
+    }
+
+    void MergedMBVTTileDataSource::setConcurrentLoading(bool enabled) {
+        _tileLoader.setConcurrent(enabled);
+    }
+
+    double MergedMBVTTileDataSource::getDataSource1LoadLatency() const {
+        return _tileLoader.getLoadLatency(0);
+    }
+
+    double MergedMBVTTileDataSource::getDataSource2LoadLatency() const {
+        return _tileLoader.getLoadLatency(1);
+    }
+    
     std::shared_ptr<TileData> MergedMBVTTileDataSource::loadTile(const MapTile& mapTile) {
         int zoom = mapTile.getZoom();
-        std::shared_ptr<TileData> result1;
-        std::shared_ptr<TileData> result2;
+        std::vector<std::shared_ptr<TileDataSource> > dataSources(2);
         if (zoom <= _dataSource1->getMaxZoom() && zoom >= _dataSource1->getMinZoom()) {
-            result1 = _dataSource1->loadTile(mapTile);
+            dataSources[0] = _dataSource1.get();
         }
         if (zoom <= _dataSource2->getMaxZoom() && zoom >= _dataSource2->getMinZoom()) {
-            result2 = _dataSource2->loadTile(mapTile);
+            dataSources[1] = _dataSource2.get();
         }
 
+        // Both results are needed for merging, so no result is accepted early
+        std::vector<std::shared_ptr<TileData> > results = _tileLoader.loadTile(dataSources, mapTile, [](const std::shared_ptr<TileData>& tileData) {
+            return false;
+        });
+        std::shared_ptr<TileData> result1 = results[0];
+        std::shared_ptr<TileData> result2 = results[1];
+
         if (result1 && result2) {
             // If either result contains 'replace with parent' then the only option is to pass this result on.
             // Otherwise we would need to do request the parent ourselves, do unpacking, scaling, clipping and packing.
@@ -69,23 +222,18 @@ namespace carto {
             }
             
             // We have data for both sources, we can merge them. Note that we may need to decompress the data first.
-            std::shared_ptr<std::vector<unsigned char>> data1 = result1->getData()->getDataPtr();
-            std::shared_ptr<std::vector<unsigned char>> data2 = result2->getData()->getDataPtr();
-
-            std::vector<unsigned char> mergedData;
-            mergedData.reserve(data1->size() + data2->size());
-
             std::vector<unsigned char> uncompressedData1;
-            if (zlib::inflate_gzip(data1->data(), data1->size(), uncompressedData1)) {
-                mergedData.insert(mergedData.end(), uncompressedData1.begin(), uncompressedData1.end());
-            } else {
-                mergedData.insert(mergedData.end(), data1->begin(), data1->end());
-            }
+            const std::vector<unsigned char>* tileData1 = GetUncompressedData(*result1->getData()->getDataPtr(), uncompressedData1);
             std::vector<unsigned char> uncompressedData2;
-            if (zlib::inflate_gzip(data2->data(), data2->size(), uncompressedData2)) {
-                mergedData.insert(mergedData.end(), uncompressedData2.begin(), uncompressedData2.end());
-            } else {
-                mergedData.insert(mergedData.end(), data2->begin(), data2->end());
+            const std::vector<unsigned char>* tileData2 = GetUncompressedData(*result2->getData()->getDataPtr(), uncompressedData2);
+
+            std::vector<unsigned char> mergedData;
+            if (!SpliceTileLayers(*tileData1, *tileData2, mergedData)) {
+                Log::Warn("MergedMBVTTileDataSource::loadTile: Failed to parse tile layers, concatenating tiles");
+                mergedData.clear();
+                mergedData.reserve(tileData1->size() + tileData2->size());
+                mergedData.insert(mergedData.end(), tileData1->begin(), tileData1->end());
+                mergedData.insert(mergedData.end(), tileData2->begin(), tileData2->end());
             }
 
             auto mergedBinaryData = std::make_shared<BinaryData>(std::move(mergedData));
@@ -96,6 +244,69 @@ namespace carto {
         return result1 ? result1 : result2;
     }
 
+    const std::vector<unsigned char>* MergedMBVTTileDataSource::GetUncompressedData(const std::vector<unsigned char>& data, std::vector<unsigned char>& uncompressedData) {
+        // Check the gzip header before trying to decompress, uncompressed tiles are used without copying
+        if (data.size() >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+            if (zlib::inflate_gzip(data.data(), data.size(), uncompressedData)) {
+                return &uncompressedData;
+            }
+        }
+        return &data;
+    }
+
+    bool MergedMBVTTileDataSource::SpliceTileLayers(const std::vector<unsigned char>& tileData1, const std::vector<unsigned char>& tileData2, std::vector<unsigned char>& mergedData) {
+        // As layers are separate length-delimited fields of the tile message, tiles can be merged by concatenating their layer fields.
+        // Layers of the second tile that have the same name as a layer of the first tile are dropped.
+        // Conflicts are checked without any allocations, in the common case the result is a plain concatenation.
+        bool conflicts = false;
+        const unsigned char* ptr = tileData2.data();
+        const unsigned char* end = ptr + tileData2.size();
+        while (ptr != end) {
+            ProtobufField field;
+            if (!readField(ptr, end, field)) {
+                return false;
+            }
+            if (isLayerField(field)) {
+                const unsigned char* name = nullptr;
+                std::size_t nameSize = 0;
+                bool found = false;
+                if (!readLayerName(field, name, nameSize) || !containsLayer(tileData1, name, nameSize, found)) {
+                    return false;
+                }
+                conflicts = conflicts || found;
+            }
+        }
+
+        mergedData.reserve(tileData1.size() + tileData2.size());
+        mergedData.insert(mergedData.end(), tileData1.begin(), tileData1.end());
+        if (!conflicts) {
+            mergedData.insert(mergedData.end(), tileData2.begin(), tileData2.end());
+            return true;
+        }
+
+        ptr = tileData2.data();
+        while (ptr != end) {
+            ProtobufField field;
+            if (!readField(ptr, end, field)) {
+                return false;
+            }
+            if (isLayerField(field)) {
+                const unsigned char* name = nullptr;
+                std::size_t nameSize = 0;
+                bool found = false;
+                if (!readLayerName(field, name, nameSize) || !containsLayer(tileData1, name, nameSize, found)) {
+                    return false;
+                }
+                if (found) {
+                    Log::Debugf("MergedMBVTTileDataSource::SpliceTileLayers: Dropping duplicate layer %s", std::string(reinterpret_cast<const char*>(name), nameSize).c_str());
+                    continue;
+                }
+            }
+            mergedData.insert(mergedData.end(), field.begin, field.end);
+        }
+        return true;
+    }
+
     MergedMBVTTileDataSource::DataSourceListener::DataSourceListener(MergedMBVTTileDataSource& combinedDataSource) :
         _combinedDataSource(combinedDataSource)
     {
@@ -9,12 +9,14 @@
 
 #include "datasources/TileDataSource.h"
 #include "components/DirectorPtr.h"
+#include "datasources/components/ParallelTileLoader.h"
 
 namespace carto {
     
     /**
      * A tile data source that merges two MBVT/protobuf data sources into one.
-     * It is assumed that the layer ids from the two sources are distinct.
+     * Tiles are merged by combining their layers without decoding the features. If both tiles
+     * contain a layer with the same name, the layer from the first data source is used.
      */
     class MergedMBVTTileDataSource : public TileDataSource {
     public:
@@ -32,6 +34,30 @@ namespace carto {
         virtual MapBounds getDataExtent() const;
         
         virtual std::shared_ptr<TileData> loadTile(const MapTile& tile);
+
+        /**
+         * Returns the concurrent loading mode flag.
+         * @return True if the data sources are queried concurrently.
+         */
+        bool isConcurrentLoading() const;
+        /**
+         * Sets the concurrent loading mode flag. In concurrent mode both data sources are queried in parallel,
+         * so the latencies of the data sources do not add up.
+         * The default is false, meaning that the data sources are queried one after another.
+         * @param enabled True if the data sources should be queried concurrently.
+         */
+        void setConcurrentLoading(bool enabled);
+
+        /**
+         * Returns the average tile load latency of the first data source.
+         * @return The average tile load latency of the first data source in milliseconds.
+         */
+        double getDataSource1LoadLatency() const;
+        /**
+         * Returns the average tile load latency of the second data source.
+         * @return The average tile load latency of the second data source in milliseconds.
+         */
+        double getDataSource2LoadLatency() const;
         
     protected:
         class DataSourceListener : public TileDataSource::OnChangeListener {
@@ -48,7 +74,12 @@ namespace carto {
         const DirectorPtr<TileDataSource> _dataSource2;
         
     private:
+        static const std::vector<unsigned char>* GetUncompressedData(const std::vector<unsigned char>& data, std::vector<unsigned char>& uncompressedData);
+        static bool SpliceTileLayers(const std::vector<unsigned char>& tileData1, const std::vector<unsigned char>& tileData2, std::vector<unsigned char>& mergedData);
+
         std::shared_ptr<DataSourceListener> _dataSourceListener;
+
+        ParallelTileLoader _tileLoader;
     };
     
 }
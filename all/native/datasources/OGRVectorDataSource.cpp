@@ -35,6 +35,8 @@
 #include "styles/GeometryCollectionStyleBuilder.h"
 #include "projections/EPSG3857.h"
 
+#include <cmath>
+
 #include <ogrsf_frmts.h>
 #include <cpl_port.h>
 #include <cpl_config.h>
@@ -102,6 +104,7 @@ namespace carto {
         _geometrySimplifier(),
         _localElementId(-1),
         _localElements(),
+        _featureCache(FEATURE_CACHE_SIZE),
         _dataBase(std::make_shared<OGRVectorDataBase>(fileName, false)),
         _poLayer(),
         _poLayerSpatialRef()
@@ -126,6 +129,7 @@ namespace carto {
         _geometrySimplifier(),
         _localElementId(-1),
         _localElements(),
+        _featureCache(FEATURE_CACHE_SIZE),
         _dataBase(dataBase),
         _poLayer(),
         _poLayerSpatialRef()
@@ -158,6 +162,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_dataBase->_mutex);
             _codePage = codePage;
+            _featureCache.clear();
         }
         notifyElementsChanged();
     }
@@ -171,6 +176,7 @@ namespace carto {
         {
             std::lock_guard<std::mutex> lock(_dataBase->_mutex);
             _geometrySimplifier = simplifier;
+            _featureCache.clear();
         }
         notifyElementsChanged();
     }
@@ -340,6 +346,7 @@ namespace carto {
             if (err != OGRERR_NONE) {
                 Log::Errorf("OGRVectorDataSource::commit: SyncToDisk failed, error code: %d", (int)err);
             }
+            _featureCache.clear();
         }
         notifyElementsChanged();
         return committedElements;
@@ -359,6 +366,7 @@ namespace carto {
                 rolledbackElements.push_back(element);
             }
             _localElements.clear();
+            _featureCache.clear();
         }
         notifyElementsChanged();
         return rolledbackElements;
@@ -427,6 +435,7 @@ namespace carto {
             Log::Errorf("OGRVectorDataSource::createField: Error while creating field %s, error code %d", name.c_str(), (int)err);
             return false;
         }
+        _featureCache.clear();
         return true;
     }
 
@@ -446,6 +455,7 @@ namespace carto {
             Log::Errorf("OGRVectorDataSource::deleteField: Error while deleting field %d, error code %d", index, (int)err);
             return false;
         }
+        _featureCache.clear();
         return true;
     }
 
@@ -484,13 +494,23 @@ namespace carto {
     }
     
     std::shared_ptr<VectorData> OGRVectorDataSource::loadElements(const std::shared_ptr<CullState>& cullState) {
+        return streamElements(cullState, PartialElementsHandler());
+    }
+
+    std::shared_ptr<VectorData> OGRVectorDataSource::streamElements(const std::shared_ptr<CullState>& cullState, const PartialElementsHandler& handler) {
         std::lock_guard<std::mutex> lock(_dataBase->_mutex);
         
         if (!_poLayer) {
             return std::shared_ptr<VectorData>();
         }
 
-        float simplifierScale = cullState->getViewState().estimateWorldPixelMeasure();
+        const ViewState& viewState = cullState->getViewState();
+
+        // Quantize the simplification scale to powers of two, so that simplified geometry can be reused between frames
+        int simplifyLevel = 0;
+        if (_geometrySimplifier) {
+            simplifyLevel = static_cast<int>(std::floor(std::log2(viewState.estimateWorldPixelMeasure())));
+        }
 
         MapBounds bounds;
         for (const MapPos& mapPos : cullState->getProjectionEnvelope(_projection).getConvexHull()) {
@@ -498,10 +518,12 @@ namespace carto {
         }
         _poLayer->SetSpatialFilterRect(bounds.getMin().getX(), bounds.getMin().getY(), bounds.getMax().getX(), bounds.getMax().getY());
 
-        std::vector<std::shared_ptr<VectorElement>> elements;
+        std::vector<std::shared_ptr<VectorElement> > elements;
+        std::vector<std::shared_ptr<VectorElement> > newElements;
         _poLayer->ResetReading();
         while (auto poFeature = std::shared_ptr<OGRFeature>(_poLayer->GetNextFeature(), OGRFeature::DestroyFeature)) {
-            auto elementIt = _localElements.find(poFeature->GetFID());
+            long long id = poFeature->GetFID();
+            auto elementIt = _localElements.find(id);
             if (elementIt != _localElements.end()) {
                 if (elementIt->second) {
                     elements.push_back(elementIt->second);
@@ -509,58 +531,60 @@ namespace carto {
                 continue;
             }
 
-            OGRGeometry* poGeometry = poFeature->GetGeometryRef();
-            if (!poGeometry) {
-                continue;
-            }
+            // Decode the fields and geometry only for features that are not cached
+            std::shared_ptr<CachedFeature> feature;
+            if (!_featureCache.read(id, feature)) {
+                OGRGeometry* poGeometry = poFeature->GetGeometryRef();
+                if (!poGeometry) {
+                    continue;
+                }
 
-            std::map<std::string, Variant> metaData;
-            OGRFeatureDefn *poFDefn = _poLayer->GetLayerDefn();
-            if (poFDefn) {
-                for (int i = 0; i < poFDefn->GetFieldCount(); i++) {
-                    OGRFieldDefn* poFieldDefn = poFeature->GetFieldDefnRef(i);
-                    Variant value;
-                    switch (poFieldDefn->GetType()) {
-                    case OFTInteger:
-                        value = Variant(static_cast<long long>(poFeature->GetFieldAsInteger(i)));
-                        break;
-                    case OFTReal:
-                        value = Variant(poFeature->GetFieldAsDouble(i));
-                        break;
-                    default:
-                        {
-                            const char* strValue = poFeature->GetFieldAsString(i);
-                            if (!strValue) {
-                                continue;
-                            }
-                            char* utf8Value = CPLRecode(strValue, _codePage.c_str(), "UTF-8");
-                            if (utf8Value) {
-                                value = Variant(utf8Value);
-                                CPLFree(utf8Value);
-                            } else {
-                                value = Variant(strValue);
-                            }
-                        }
-                        break;
-                    }
-                    metaData[poFDefn->GetFieldDefn(i)->GetNameRef()] = value;
+                feature = std::make_shared<CachedFeature>();
+                feature->metaData = createMetaData(poFeature.get());
+                feature->geometry = createGeometry(poGeometry);
+                if (!feature->geometry) {
+                    continue;
                 }
+                // WKB uses 2 coordinates per vertex, both the original and simplified geometry use 3
+                std::size_t featureSize = static_cast<std::size_t>(poGeometry->WkbSize()) * 3 + feature->metaData.size() * 64;
+                _featureCache.put(id, feature, featureSize);
             }
-                
-            std::shared_ptr<Geometry> geometry = createGeometry(poGeometry);
-            if (_geometrySimplifier) {
-                if (geometry) {
-                    geometry = _geometrySimplifier->simplify(geometry, _projection, cullState->getViewState().getProjectionSurface(), simplifierScale);
+
+            if (feature->simplifyLevel != simplifyLevel) {
+                feature->simplifiedGeometry = feature->geometry;
+                if (_geometrySimplifier) {
+                    feature->simplifiedGeometry = _geometrySimplifier->simplify(feature->geometry, _projection, viewState.getProjectionSurface(), std::ldexp(1.0f, simplifyLevel));
                 }
+                feature->simplifyLevel = simplifyLevel;
+                feature->element.reset();
+            }
+            if (!feature->simplifiedGeometry) {
+                continue;
             }
-            if (geometry) {
-                std::shared_ptr<VectorElement> vectorElement = createVectorElement(cullState->getViewState(), geometry, metaData);
+
+            // Styles may depend on the view, so the element is recreated only if the selected style changes
+            StyleSelectorContext context(viewState, feature->simplifiedGeometry, feature->metaData);
+            std::shared_ptr<Style> style = _styleSelector->getStyle(context);
+            if (!feature->element || feature->style != style) {
+                std::shared_ptr<VectorElement> vectorElement = createVectorElement(feature->simplifiedGeometry, style);
                 if (vectorElement) {
-                    vectorElement->setId(poFeature->GetFID());
-                    vectorElement->setMetaData(metaData);
+                    vectorElement->setId(id);
+                    vectorElement->setMetaData(feature->metaData);
                     attachElement(vectorElement);
-                    elements.push_back(std::move(vectorElement));
+                    newElements.push_back(vectorElement);
                 }
+                feature->style = style;
+                feature->element = vectorElement;
+            }
+            if (feature->element) {
+                elements.push_back(feature->element);
+            }
+
+            if (handler && newElements.size() >= ELEMENT_CHUNK_SIZE) {
+                if (!handler(newElements)) {
+                    return std::shared_ptr<VectorData>();
+                }
+                newElements.clear();
             }
         }
         
@@ -581,6 +605,42 @@ namespace carto {
         VectorDataSource::notifyElementChanged(element);
     }
     
+    std::map<std::string, Variant> OGRVectorDataSource::createMetaData(OGRFeature* poFeature) const {
+        std::map<std::string, Variant> metaData;
+        OGRFeatureDefn *poFDefn = _poLayer->GetLayerDefn();
+        if (poFDefn) {
+            for (int i = 0; i < poFDefn->GetFieldCount(); i++) {
+                OGRFieldDefn* poFieldDefn = poFeature->GetFieldDefnRef(i);
+                Variant value;
+                switch (poFieldDefn->GetType()) {
+                case OFTInteger:
+                    value = Variant(static_cast<long long>(poFeature->GetFieldAsInteger(i)));
+                    break;
+                case OFTReal:
+                    value = Variant(poFeature->GetFieldAsDouble(i));
+                    break;
+                default:
+                    {
+                        const char* strValue = poFeature->GetFieldAsString(i);
+                        if (!strValue) {
+                            continue;
+                        }
+                        char* utf8Value = CPLRecode(strValue, _codePage.c_str(), "UTF-8");
+                        if (utf8Value) {
+                            value = Variant(utf8Value);
+                            CPLFree(utf8Value);
+                        } else {
+                            value = Variant(strValue);
+                        }
+                    }
+                    break;
+                }
+                metaData[poFDefn->GetFieldDefn(i)->GetNameRef()] = value;
+            }
+        }
+        return metaData;
+    }
+
     std::shared_ptr<Geometry> OGRVectorDataSource::createGeometry(const OGRGeometry* poGeometry) const {
         if (!poGeometry) {
             return std::shared_ptr<Geometry>();
@@ -684,9 +744,7 @@ namespace carto {
         return geometry;
     }
     
-    std::shared_ptr<VectorElement> OGRVectorDataSource::createVectorElement(const ViewState& viewState, const std::shared_ptr<Geometry>& geometry, const std::map<std::string, Variant>& metaData) const {
-        StyleSelectorContext context(viewState, geometry, metaData);
-        std::shared_ptr<Style> style = _styleSelector->getStyle(context);
+    std::shared_ptr<VectorElement> OGRVectorDataSource::createVectorElement(const std::shared_ptr<Geometry>& geometry, const std::shared_ptr<Style>& style) const {
         if (auto polygonStyle = std::dynamic_pointer_cast<PolygonStyle>(style)) {
             if (auto polygonGeometry = std::dynamic_pointer_cast<PolygonGeometry>(geometry)) {
                 return std::make_shared<Polygon>(polygonGeometry, polygonStyle);
@@ -828,6 +886,9 @@ namespace carto {
         return poFeature;
     }
 
+    const std::size_t OGRVectorDataSource::FEATURE_CACHE_SIZE = 16 * 1024 * 1024;
+    const std::size_t OGRVectorDataSource::ELEMENT_CHUNK_SIZE = 256;
+
 }
 
 #endif
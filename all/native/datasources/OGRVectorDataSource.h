@@ -13,9 +13,12 @@
 #include "datasources/VectorDataSource.h"
 #include "datasources/OGRVectorDataBase.h"
 
+#include <limits>
 #include <map>
 #include <vector>
 
+#include <stdext/timed_lru_cache.h>
+
 class OGRGeometry;
 class OGRFeature;
 class OGRLayer;
@@ -25,6 +28,7 @@ class OGRCoordinateTransformation;
 namespace carto {
     class Geometry;
     class GeometrySimplifier;
+    class Style;
     class StyleSelector;
     class ViewState;
     class VectorElement;
@@ -200,27 +204,53 @@ namespace carto {
         virtual MapBounds getDataExtent() const;
         
         virtual std::shared_ptr<VectorData> loadElements(const std::shared_ptr<CullState>& cullState);
+        /**
+         * Loads the elements within the defined envelope, reporting newly converted elements in chunks.
+         * Features that are already in the feature cache are not converted again. Note: the handler is called while the
+         * underlying database is locked.
+         * @param cullState State for describing view parameters and conservative view envelope.
+         * @param handler The handler that receives chunks of newly converted elements. If it returns false, loading is aborted.
+         * @return The vector of all loaded vector elements. Null is returned if loading was aborted.
+         */
+        virtual std::shared_ptr<VectorData> streamElements(const std::shared_ptr<CullState>& cullState, const PartialElementsHandler& handler);
 
     protected:
         virtual void notifyElementChanged(const std::shared_ptr<VectorElement>& element);        
         
     private:
         struct LayerSpatialReference;
+
+        struct CachedFeature {
+            std::map<std::string, Variant> metaData;
+            std::shared_ptr<Geometry> geometry;
+            int simplifyLevel;
+            std::shared_ptr<Geometry> simplifiedGeometry;
+            std::shared_ptr<Style> style;
+            std::shared_ptr<VectorElement> element;
+
+            CachedFeature() : metaData(), geometry(), simplifyLevel(std::numeric_limits<int>::min()), simplifiedGeometry(), style(), element() { }
+        };
+
+        std::map<std::string, Variant> createMetaData(OGRFeature* poFeature) const;
         
         std::shared_ptr<Geometry> createGeometry(const OGRGeometry* poGeometry) const;
         
-        std::shared_ptr<VectorElement> createVectorElement(const ViewState& viewState, const std::shared_ptr<Geometry>& geometry, const std::map<std::string, Variant>& metaData) const;
+        std::shared_ptr<VectorElement> createVectorElement(const std::shared_ptr<Geometry>& geometry, const std::shared_ptr<Style>& style) const;
         
         std::shared_ptr<OGRGeometry> createOGRGeometry(const std::shared_ptr<Geometry>& geometry) const;
 
         std::shared_ptr<OGRFeature> createOGRFeature(const std::shared_ptr<VectorElement>& element) const;
 
+        static const std::size_t FEATURE_CACHE_SIZE;
+        static const std::size_t ELEMENT_CHUNK_SIZE;
+
         std::string _codePage;
         std::shared_ptr<StyleSelector> _styleSelector;
         std::shared_ptr<GeometrySimplifier> _geometrySimplifier;
 
         long long _localElementId;
         std::map<long long, std::shared_ptr<VectorElement> > _localElements;
+        cache::timed_lru_cache<long long, std::shared_ptr<CachedFeature> > _featureCache; // converted features keyed by FID
 
         std::shared_ptr<OGRVectorDataBase> _dataBase;
         OGRLayer* _poLayer;
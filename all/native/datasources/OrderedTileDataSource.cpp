@@ -11,7 +11,9 @@ namespace carto {
     OrderedTileDataSource::OrderedTileDataSource(const std::shared_ptr<TileDataSource>& dataSource1, const std::shared_ptr<TileDataSource>& dataSource2) :
         TileDataSource(),
         _dataSource1(dataSource1),
-        _dataSource2(dataSource2)
+        _dataSource2(dataSource2),
+        _dataSourceListener(),
+        _tileLoader(2)
     {
         if (!dataSource1) {
             throw NullArgumentException("Null dataSource1");
@@ -45,15 +47,29 @@ namespace carto {
         return bounds;
     }
     
+    bool OrderedTileDataSource::isConcurrentLoading() const {
+        return _tileLoader.isConcurrent();
+    }
+
+    void OrderedTileDataSource::setConcurrentLoading(bool enabled) {
+        _tileLoader.setConcurrent(enabled);
+    }
+
+    double OrderedTileDataSource::getDataSource1LoadLatency() const {
+        return _tileLoader.getLoadLatency(0);
+    }
+
+    double OrderedTileDataSource::getDataSource2LoadLatency() const {
+        return _tileLoader.getLoadLatency(1);
+    }
+    
     std::shared_ptr<TileData> OrderedTileDataSource::loadTile(const MapTile& mapTile) {
         std::shared_ptr<TileData> result1, result2;
+        std::vector<std::shared_ptr<TileDataSource> > dataSources(2);
         int zoom = mapTile.getZoom();
         if (zoom >= _dataSource1->getMinZoom()) {
             if (zoom <= _dataSource1->getMaxZoom()) {
-                result1 = _dataSource1->loadTile(mapTile);
-                if (result1 && !result1->isReplaceWithParent()) {
-                    return result1;
-                }
+                dataSources[0] = _dataSource1.get();
             } else {
                 result1 = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
                 result1->setReplaceWithParent(true);
@@ -61,18 +77,99 @@ namespace carto {
         }
         if (zoom >= _dataSource2->getMinZoom()) {
             if (zoom <= _dataSource2->getMaxZoom()) {
-                result2 = _dataSource2->loadTile(mapTile);
-                if (result2 && !result2->isReplaceWithParent()) {
-                    return result2;
-                }
+                dataSources[1] = _dataSource2.get();
             } else {
                 result2 = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
                 result2->setReplaceWithParent(true);
             }
         }
+
+        std::vector<std::shared_ptr<TileData> > results = _tileLoader.loadTile(dataSources, mapTile, [](const std::shared_ptr<TileData>& tileData) {
+            return !tileData->isReplaceWithParent();
+        });
+        if (dataSources[0]) {
+            result1 = results[0];
+        }
+        if (dataSources[1]) {
+            result2 = results[1];
+        }
+
+        if (result1 && !result1->isReplaceWithParent()) {
+            return result1;
+        }
+        if (result2 && !result2->isReplaceWithParent()) {
+            return result2;
+        }
         return result1 ? result1 : result2;
     }
 
+    bool OrderedTileDataSource::isBatchLoadingSupported() const {
+        // In concurrent mode the data sources are queried tile by tile
+        return _dataSource1->isBatchLoadingSupported() && _dataSource2->isBatchLoadingSupported() && !isConcurrentLoading();
+    }
+
+    std::vector<std::shared_ptr<TileData> > OrderedTileDataSource::loadTiles(const std::vector<MapTile>& mapTiles) {
+        if (!isBatchLoadingSupported()) {
+            return TileDataSource::loadTiles(mapTiles);
+        }
+
+        // Load all tiles from the first data source, then the tiles not found there from the second data source, both as a single batch
+        std::vector<std::shared_ptr<TileData> > results1 = LoadDataSourceTiles(_dataSource1.get(), mapTiles);
+        std::vector<std::shared_ptr<TileData> > tileDatas(mapTiles.size());
+        std::vector<MapTile> mapTiles2;
+        std::vector<std::size_t> indices2;
+        for (std::size_t i = 0; i < mapTiles.size(); i++) {
+            if (results1[i] && !results1[i]->isReplaceWithParent()) {
+                tileDatas[i] = results1[i];
+            } else {
+                mapTiles2.push_back(mapTiles[i]);
+                indices2.push_back(i);
+            }
+        }
+        if (mapTiles2.empty()) {
+            return tileDatas;
+        }
+
+        std::vector<std::shared_ptr<TileData> > results2 = LoadDataSourceTiles(_dataSource2.get(), mapTiles2);
+        for (std::size_t j = 0; j < mapTiles2.size(); j++) {
+            std::size_t i = indices2[j];
+            if (results2[j] && !results2[j]->isReplaceWithParent()) {
+                tileDatas[i] = results2[j];
+            } else {
+                tileDatas[i] = results1[i] ? results1[i] : results2[j];
+            }
+        }
+        return tileDatas;
+    }
+
+    std::vector<std::shared_ptr<TileData> > OrderedTileDataSource::LoadDataSourceTiles(const std::shared_ptr<TileDataSource>& dataSource, const std::vector<MapTile>& mapTiles) {
+        // Tiles outside of the zoom range of the data source are not loaded, tiles above the maximum zoom are replaced with parents
+        std::vector<std::shared_ptr<TileData> > tileDatas(mapTiles.size());
+        std::vector<MapTile> batchTiles;
+        std::vector<std::size_t> batchIndices;
+        for (std::size_t i = 0; i < mapTiles.size(); i++) {
+            int zoom = mapTiles[i].getZoom();
+            if (zoom < dataSource->getMinZoom()) {
+                continue;
+            }
+            if (zoom > dataSource->getMaxZoom()) {
+                tileDatas[i] = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
+                tileDatas[i]->setReplaceWithParent(true);
+                continue;
+            }
+            batchTiles.push_back(mapTiles[i]);
+            batchIndices.push_back(i);
+        }
+
+        if (!batchTiles.empty()) {
+            std::vector<std::shared_ptr<TileData> > batchTileDatas = dataSource->loadTiles(batchTiles);
+            for (std::size_t j = 0; j < batchTiles.size() && j < batchTileDatas.size(); j++) {
+                tileDatas[batchIndices[j]] = batchTileDatas[j];
+            }
+        }
+        return tileDatas;
+    }
+
     OrderedTileDataSource::DataSourceListener::DataSourceListener(OrderedTileDataSource& combinedDataSource) :
         _combinedDataSource(combinedDataSource)
     {
@@ -9,6 +9,7 @@
 
 #include "datasources/TileDataSource.h"
 #include "components/DirectorPtr.h"
+#include "datasources/components/ParallelTileLoader.h"
 
 namespace carto {
     
@@ -32,6 +33,34 @@ namespace carto {
         virtual MapBounds getDataExtent() const;
         
         virtual std::shared_ptr<TileData> loadTile(const MapTile& tile);
+
+        virtual bool isBatchLoadingSupported() const;
+        virtual std::vector<std::shared_ptr<TileData> > loadTiles(const std::vector<MapTile>& tiles);
+
+        /**
+         * Returns the concurrent loading mode flag.
+         * @return True if the data sources are queried concurrently.
+         */
+        bool isConcurrentLoading() const;
+        /**
+         * Sets the concurrent loading mode flag. In concurrent mode both data sources are queried in parallel
+         * and the first found tile is returned, so the latencies of the data sources do not add up. Note that in this mode
+         * the tile from the second data source may be used even if the first data source contains the tile.
+         * The default is false, meaning that the data sources are queried one after another.
+         * @param enabled True if the data sources should be queried concurrently.
+         */
+        void setConcurrentLoading(bool enabled);
+
+        /**
+         * Returns the average tile load latency of the first data source.
+         * @return The average tile load latency of the first data source in milliseconds.
+         */
+        double getDataSource1LoadLatency() const;
+        /**
+         * Returns the average tile load latency of the second data source.
+         * @return The average tile load latency of the second data source in milliseconds.
+         */
+        double getDataSource2LoadLatency() const;
         
     protected:
         class DataSourceListener : public TileDataSource::OnChangeListener {
@@ -48,7 +77,11 @@ namespace carto {
         const DirectorPtr<TileDataSource> _dataSource2;
         
     private:
+        static std::vector<std::shared_ptr<TileData> > LoadDataSourceTiles(const std::shared_ptr<TileDataSource>& dataSource, const std::vector<MapTile>& mapTiles);
+
         std::shared_ptr<DataSourceListener> _dataSourceListener;
+
+        ParallelTileLoader _tileLoader;
     };
     
 }
@@ -0,0 +1,316 @@
+#ifdef _CARTO_OFFLINE_SUPPORT
+
+#include "PMTilesTileDataSource.h"
+#include "core/BinaryData.h"
+#include "core/MapTile.h"
+#include "components/Exceptions.h"
+#include "projections/Projection.h"
+#include "utils/MemoryMappedFile.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <stdext/zlib.h>
+
+#include <picojson/picojson.h>
+
+namespace carto {
+
+    PMTilesTileDataSource::PMTilesTileDataSource(const std::string& path) :
+        TileDataSource(),
+        _file(std::make_shared<MemoryMappedFile>(path)),
+        _header(ReadHeader(*_file)),
+        _directoryCache(DIRECTORY_CACHE_SIZE),
+        _mutex()
+    {
+        _minZoom = _header.minZoom;
+        _maxZoom = _header.maxZoom;
+    }
+
+    PMTilesTileDataSource::PMTilesTileDataSource(int minZoom, int maxZoom, const std::string& path) :
+        TileDataSource(minZoom, maxZoom),
+        _file(std::make_shared<MemoryMappedFile>(path)),
+        _header(ReadHeader(*_file)),
+        _directoryCache(DIRECTORY_CACHE_SIZE),
+        _mutex()
+    {
+    }
+
+    PMTilesTileDataSource::~PMTilesTileDataSource() {
+    }
+
+    std::map<std::string, std::string> PMTilesTileDataSource::getMetaData() const {
+        std::vector<unsigned char> metadataJSON;
+        if (!readInternalData(_header.metadataOffset, _header.metadataLength, metadataJSON)) {
+            Log::Error("PMTilesTileDataSource::getMetaData: Failed to read metadata");
+            return std::map<std::string, std::string>();
+        }
+
+        picojson::value metadataDoc;
+        std::string err = picojson::parse(metadataDoc, std::string(metadataJSON.begin(), metadataJSON.end()));
+        if (!err.empty()) {
+            Log::Errorf("PMTilesTileDataSource::getMetaData: Failed to parse metadata: %s", err.c_str());
+            return std::map<std::string, std::string>();
+        }
+        if (!metadataDoc.is<picojson::object>()) {
+            return std::map<std::string, std::string>();
+        }
+
+        std::map<std::string, std::string> metaData;
+        for (const std::pair<const std::string, picojson::value>& keyValue : metadataDoc.get<picojson::object>()) {
+            if (keyValue.second.is<std::string>()) {
+                metaData[keyValue.first] = keyValue.second.get<std::string>();
+            } else {
+                metaData[keyValue.first] = keyValue.second.serialize();
+            }
+        }
+        return metaData;
+    }
+
+    MapBounds PMTilesTileDataSource::getDataExtent() const {
+        if (_header.minLon >= _header.maxLon || _header.minLat >= _header.maxLat) {
+            return TileDataSource::getDataExtent();
+        }
+
+        MapBounds mapBounds;
+        mapBounds.expandToContain(_projection->fromWgs84(MapPos(_header.minLon, _header.minLat)));
+        mapBounds.expandToContain(_projection->fromWgs84(MapPos(_header.maxLon, _header.maxLat)));
+        return mapBounds;
+    }
+
+    std::shared_ptr<TileData> PMTilesTileDataSource::loadTile(const MapTile& mapTile) {
+        Log::Infof("PMTilesTileDataSource::loadTile: Loading %s", mapTile.toString().c_str());
+
+        std::uint64_t tileId = CalculateTileId(mapTile.getZoom(), mapTile.getX(), mapTile.getY());
+        std::uint64_t dirOffset = _header.rootDirOffset;
+        std::uint64_t dirLength = _header.rootDirLength;
+        for (int depth = 0; depth < MAX_DIRECTORY_DEPTH; depth++) {
+            std::shared_ptr<const Directory> directory = getDirectory(dirOffset, dirLength);
+            if (!directory) {
+                Log::Errorf("PMTilesTileDataSource::loadTile: Failed to load %s: Couldn't read archive directory", mapTile.toString().c_str());
+                return std::shared_ptr<TileData>();
+            }
+
+            // Find the last entry with tile id less than or equal to the requested tile id
+            auto it = std::upper_bound(directory->begin(), directory->end(), tileId, [](std::uint64_t id, const Entry& entry) {
+                return id < entry.tileId;
+            });
+            if (it == directory->begin()) {
+                break;
+            }
+            const Entry& entry = *(--it);
+
+            if (entry.runLength == 0) {
+                // Entry points to a leaf directory
+                dirOffset = _header.leafDirsOffset + entry.offset;
+                dirLength = entry.length;
+                continue;
+            }
+            if (tileId - entry.tileId >= entry.runLength) {
+                break;
+            }
+
+            std::uint64_t dataOffset = _header.tileDataOffset + entry.offset;
+            if (dataOffset + entry.length > _file->size()) {
+                Log::Errorf("PMTilesTileDataSource::loadTile: Failed to load %s: Tile data outside of the archive", mapTile.toString().c_str());
+                return std::shared_ptr<TileData>();
+            }
+            // Refer to the mapped archive directly instead of copying the tile
+            auto data = std::make_shared<BinaryData>(_file, _file->data() + dataOffset, static_cast<std::size_t>(entry.length));
+            return std::make_shared<TileData>(data);
+        }
+        return createMissingTileData(mapTile);
+    }
+
+    PMTilesTileDataSource::Header PMTilesTileDataSource::ReadHeader(const MemoryMappedFile& file) {
+        const unsigned char* data = file.data();
+        if (file.size() < 127 || std::memcmp(data, "PMTiles", 7) != 0) {
+            throw FileException("Not a PMTiles archive", file.getPath());
+        }
+        if (data[7] != 3) {
+            throw FileException("Unsupported PMTiles version", file.getPath());
+        }
+
+        Header header;
+        header.rootDirOffset = ReadUInt64(data + 8);
+        header.rootDirLength = ReadUInt64(data + 16);
+        header.metadataOffset = ReadUInt64(data + 24);
+        header.metadataLength = ReadUInt64(data + 32);
+        header.leafDirsOffset = ReadUInt64(data + 40);
+        header.leafDirsLength = ReadUInt64(data + 48);
+        header.tileDataOffset = ReadUInt64(data + 56);
+        header.tileDataLength = ReadUInt64(data + 64);
+        header.internalCompression = data[97];
+        header.tileCompression = data[98];
+        header.minZoom = data[100];
+        header.maxZoom = data[101];
+        header.minLon = static_cast<std::int32_t>(ReadUInt64(data + 102) & 0xffffffff) * 1.0e-7;
+        header.minLat = static_cast<std::int32_t>(ReadUInt64(data + 106) & 0xffffffff) * 1.0e-7;
+        header.maxLon = static_cast<std::int32_t>(ReadUInt64(data + 110) & 0xffffffff) * 1.0e-7;
+        header.maxLat = static_cast<std::int32_t>(ReadUInt64(data + 114) & 0xffffffff) * 1.0e-7;
+
+        // Only uncompressed and gzip-compressed directories are supported
+        if (header.internalCompression != 1 && header.internalCompression != 2) {
+            throw FileException("Unsupported PMTiles directory compression", file.getPath());
+        }
+        if (header.tileCompression > 2) {
+            Log::Warnf("PMTilesTileDataSource: Tiles use unsupported compression %d, decoding may fail", header.tileCompression);
+        }
+        if (header.rootDirOffset + header.rootDirLength > file.size() || header.tileDataOffset + header.tileDataLength > file.size()) {
+            throw FileException("Truncated PMTiles archive", file.getPath());
+        }
+        return header;
+    }
+
+    std::uint64_t PMTilesTileDataSource::ReadUInt64(const unsigned char* ptr) {
+        std::uint64_t value = 0;
+        for (int i = 7; i >= 0; i--) {
+            value = (value << 8) | ptr[i];
+        }
+        return value;
+    }
+
+    bool PMTilesTileDataSource::ReadVarint(const unsigned char*& ptr, const unsigned char* end, std::uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+            unsigned char byte = *ptr++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool PMTilesTileDataSource::ParseDirectory(const std::vector<unsigned char>& data, Directory& directory) {
+        const unsigned char* ptr = data.data();
+        const unsigned char* end = data.data() + data.size();
+
+        std::uint64_t entryCount = 0;
+        if (!ReadVarint(ptr, end, entryCount) || entryCount > data.size()) {
+            return false;
+        }
+        directory.resize(static_cast<std::size_t>(entryCount));
+
+        // Entries are stored column-wise: delta-encoded tile ids, run lengths, lengths and offsets
+        std::uint64_t tileId = 0;
+        for (Entry& entry : directory) {
+            std::uint64_t delta = 0;
+            if (!ReadVarint(ptr, end, delta)) {
+                return false;
+            }
+            tileId += delta;
+            entry.tileId = tileId;
+        }
+        for (Entry& entry : directory) {
+            std::uint64_t runLength = 0;
+            if (!ReadVarint(ptr, end, runLength)) {
+                return false;
+            }
+            entry.runLength = static_cast<std::uint32_t>(runLength);
+        }
+        for (Entry& entry : directory) {
+            std::uint64_t length = 0;
+            if (!ReadVarint(ptr, end, length)) {
+                return false;
+            }
+            entry.length = static_cast<std::uint32_t>(length);
+        }
+        for (std::size_t i = 0; i < directory.size(); i++) {
+            std::uint64_t offset = 0;
+            if (!ReadVarint(ptr, end, offset)) {
+                return false;
+            }
+            // Zero offset means that the data directly follows the previous entry
+            if (offset == 0 && i > 0) {
+                directory[i].offset = directory[i - 1].offset + directory[i - 1].length;
+            } else {
+                directory[i].offset = offset - 1;
+            }
+        }
+        return true;
+    }
+
+    std::uint64_t PMTilesTileDataSource::CalculateTileId(int zoom, int x, int y) {
+        // Tiles of all previous zoom levels come first, tiles of the same zoom level are ordered along Hilbert curve
+        std::uint64_t tileId = ((1ULL << (zoom * 2)) - 1) / 3;
+        std::int64_t n = 1LL << zoom;
+        std::int64_t tx = x, ty = y;
+        for (int a = zoom - 1; a >= 0; a--) {
+            std::int64_t s = 1LL << a;
+            int rx = (tx & s) ? 1 : 0;
+            int ry = (ty & s) ? 1 : 0;
+            tileId += static_cast<std::uint64_t>((3 * rx) ^ ry) << (2 * a);
+            if (ry == 0) {
+                if (rx == 1) {
+                    tx = n - 1 - tx;
+                    ty = n - 1 - ty;
+                }
+                std::swap(tx, ty);
+            }
+        }
+        return tileId;
+    }
+
+    std::shared_ptr<const PMTilesTileDataSource::Directory> PMTilesTileDataSource::getDirectory(std::uint64_t offset, std::uint64_t length) const {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::shared_ptr<const Directory> directory;
+            if (_directoryCache.read(static_cast<long long>(offset), directory)) {
+                return directory;
+            }
+        }
+
+        // Decode the directory without holding the lock, concurrent decoding of the same directory is harmless
+        std::vector<unsigned char> data;
+        if (!readInternalData(offset, length, data)) {
+            return std::shared_ptr<const Directory>();
+        }
+        auto directory = std::make_shared<Directory>();
+        if (!ParseDirectory(data, *directory)) {
+            Log::Errorf("PMTilesTileDataSource: Failed to parse directory at offset %lld", static_cast<long long>(offset));
+            return std::shared_ptr<const Directory>();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _directoryCache.put(static_cast<long long>(offset), directory, directory->size() * sizeof(Entry) + 16);
+        return directory;
+    }
+
+    bool PMTilesTileDataSource::readInternalData(std::uint64_t offset, std::uint64_t length, std::vector<unsigned char>& data) const {
+        if (offset + length > _file->size()) {
+            Log::Errorf("PMTilesTileDataSource: Data at offset %lld outside of the archive", static_cast<long long>(offset));
+            return false;
+        }
+
+        const unsigned char* ptr = _file->data() + offset;
+        if (_header.internalCompression == 2) {
+            if (!zlib::inflate_gzip(ptr, static_cast<std::size_t>(length), data)) {
+                Log::Errorf("PMTilesTileDataSource: Failed to decompress data at offset %lld", static_cast<long long>(offset));
+                return false;
+            }
+        } else {
+            data.assign(ptr, ptr + length);
+        }
+        return true;
+    }
+
+    std::shared_ptr<TileData> PMTilesTileDataSource::createMissingTileData(const MapTile& mapTile) const {
+        std::shared_ptr<TileData> tileData = std::make_shared<TileData>(std::shared_ptr<BinaryData>());
+        if (mapTile.getZoom() > getMinZoom()) {
+            Log::Infof("PMTilesTileDataSource: Tile data doesn't exist in the archive, redirecting to parent");
+            tileData->setReplaceWithParent(true);
+        } else {
+            Log::Infof("PMTilesTileDataSource: Tile data doesn't exist in the archive");
+            return std::shared_ptr<TileData>();
+        }
+        return tileData;
+    }
+
+    const int PMTilesTileDataSource::MAX_DIRECTORY_DEPTH = 4;
+    const std::size_t PMTilesTileDataSource::DIRECTORY_CACHE_SIZE = 8 * 1024 * 1024;
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_PMTILESTILEDATASOURCE_H_
+#define _CARTO_PMTILESTILEDATASOURCE_H_
+
+#ifdef _CARTO_OFFLINE_SUPPORT
+
+#include "datasources/TileDataSource.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stdext/timed_lru_cache.h>
+
+namespace carto {
+    class MemoryMappedFile;
+
+    /**
+     * A tile data source that loads tiles from a local PMTiles (version 3) archive.
+     * The archive is memory mapped, tiles are located using the archive directories
+     * without any database queries. Directories are cached after the first use.
+     * Only uncompressed and gzip-compressed archive directories are supported.
+     */
+    class PMTilesTileDataSource : public TileDataSource {
+    public:
+        /**
+         * Constructs a PMTilesTileDataSource object. Min and max zoom levels are read from the archive header.
+         * @param path The path to the local PMTiles archive.
+         * @throws std::exception If the the file could not be opened or is not a valid PMTiles archive.
+         */
+        explicit PMTilesTileDataSource(const std::string& path);
+
+        /**
+         * Constructs a PMTilesTileDataSource object.
+         * @param minZoom The minimum zoom level supported by this data source.
+         * @param maxZoom The maximum zoom level supported by this data source.
+         * @param path The path to the local PMTiles archive.
+         * @throws std::exception If the the file could not be opened or is not a valid PMTiles archive.
+         */
+        PMTilesTileDataSource(int minZoom, int maxZoom, const std::string& path);
+
+        virtual ~PMTilesTileDataSource();
+
+        /**
+         * Get data source metadata information. The metadata is stored as a JSON object in the archive,
+         * string values are returned as is, other values are returned as serialized JSON.
+         * @return Map containing meta data information (parameter names mapped to parameter values).
+         */
+        std::map<std::string, std::string> getMetaData() const;
+
+        virtual MapBounds getDataExtent() const;
+
+        virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+    private:
+        struct Header {
+            std::uint64_t rootDirOffset;
+            std::uint64_t rootDirLength;
+            std::uint64_t metadataOffset;
+            std::uint64_t metadataLength;
+            std::uint64_t leafDirsOffset;
+            std::uint64_t leafDirsLength;
+            std::uint64_t tileDataOffset;
+            std::uint64_t tileDataLength;
+            int internalCompression;
+            int tileCompression;
+            int minZoom;
+            int maxZoom;
+            double minLon;
+            double minLat;
+            double maxLon;
+            double maxLat;
+        };
+
+        struct Entry {
+            std::uint64_t tileId;
+            std::uint64_t offset;
+            std::uint32_t length;
+            std::uint32_t runLength;
+        };
+
+        typedef std::vector<Entry> Directory;
+
+        static Header ReadHeader(const MemoryMappedFile& file);
+        static std::uint64_t ReadUInt64(const unsigned char* ptr);
+        static bool ReadVarint(const unsigned char*& ptr, const unsigned char* end, std::uint64_t& value);
+        static bool ParseDirectory(const std::vector<unsigned char>& data, Directory& directory);
+
+        static std::uint64_t CalculateTileId(int zoom, int x, int y);
+
+        std::shared_ptr<const Directory> getDirectory(std::uint64_t offset, std::uint64_t length) const;
+        bool readInternalData(std::uint64_t offset, std::uint64_t length, std::vector<unsigned char>& data) const;
+
+        std::shared_ptr<TileData> createMissingTileData(const MapTile& mapTile) const;
+
+        static const int MAX_DIRECTORY_DEPTH;
+        static const std::size_t DIRECTORY_CACHE_SIZE;
+
+        std::shared_ptr<MemoryMappedFile> _file;
+        Header _header;
+
+        mutable cache::timed_lru_cache<long long, std::shared_ptr<const Directory> > _directoryCache;
+        mutable std::mutex _mutex;
+    };
+    
+}
+
+#endif
+
+#endif
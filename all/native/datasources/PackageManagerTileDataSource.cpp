@@ -7,6 +7,7 @@
 #include "utils/Log.h"
 #include "utils/Const.h"
 
+#include <atomic>
 #include <memory>
 
 namespace carto {
@@ -14,7 +15,7 @@ namespace carto {
     PackageManagerTileDataSource::PackageManagerTileDataSource(const std::shared_ptr<PackageManager>& packageManager) :
         TileDataSource(0, Const::MAX_SUPPORTED_ZOOM_LEVEL),
         _packageManager(packageManager),
-        _cachedOpenPackageHandlers(),
+        _packageIndex(),
         _mutex()
     {
         if (!packageManager) {
@@ -39,48 +40,10 @@ namespace carto {
         try {
             MapTile mapTileFlipped = mapTile.getFlipped();
 
+            // Read packages without locking them, tile loads do not block package downloads and other loads
             std::shared_ptr<BinaryData> data;
-            _packageManager->accessLocalPackages([this, mapTileFlipped, &data](const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >& packageHandlerMap) {
-                std::lock_guard<std::mutex> lock(_mutex);
-
-                // Fast path: try already open packages
-                for (auto it = _cachedOpenPackageHandlers.begin(); it != _cachedOpenPackageHandlers.end(); it++) {
-                    const std::shared_ptr<PackageInfo>& packageInfo = it->first;
-                    std::shared_ptr<PackageTileMask> tileMask = packageInfo->getTileMask();
-                    if (tileMask) {
-                        if (tileMask->getTileStatus(mapTileFlipped) == PackageTileStatus::PACKAGE_TILE_STATUS_MISSING) {
-                            continue;
-                        }
-                    }
-
-                    data = it->second->loadTile(mapTileFlipped);
-                    if (data || tileMask) {
-                        std::rotate(_cachedOpenPackageHandlers.begin(), it, it + 1);
-                        return;
-                    }
-                }
-
-                // Slow path: try other packages
-                for (auto it = packageHandlerMap.begin(); it != packageHandlerMap.end(); it++) {
-                    if (auto mapHandler = std::dynamic_pointer_cast<MapPackageHandler>(it->second)) {
-                        const std::shared_ptr<PackageInfo>& packageInfo = it->first;
-                        std::shared_ptr<PackageTileMask> tileMask = packageInfo->getTileMask();
-                        if (tileMask) {
-                            if (tileMask->getTileStatus(mapTileFlipped) == PackageTileStatus::PACKAGE_TILE_STATUS_MISSING) {
-                                continue;
-                            }
-                        }
-
-                        data = mapHandler->loadTile(mapTileFlipped);
-                        if (data || tileMask) {
-                            _cachedOpenPackageHandlers.insert(_cachedOpenPackageHandlers.begin(), std::make_pair(packageInfo, mapHandler));
-                            if (_cachedOpenPackageHandlers.size() > MAX_OPEN_PACKAGES) {
-                                _cachedOpenPackageHandlers.pop_back();
-                            }
-                            return;
-                        }
-                    }
-                }
+            _packageManager->readLocalPackages([this, mapTileFlipped, &data](const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >& packageHandlerMap) {
+                data = LoadPackageTile(*getPackageIndex(packageHandlerMap), mapTileFlipped);
             });
 
             std::shared_ptr<TileData> tileData = std::make_shared<TileData>(data);
@@ -101,16 +64,104 @@ namespace carto {
         return std::shared_ptr<TileData>();
     }
         
+    std::shared_ptr<const PackageManagerTileDataSource::PackageIndex> PackageManagerTileDataSource::getPackageIndex(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >& packageHandlerMap) const {
+        // Package manager returns a new snapshot whenever local packages change
+        auto isValid = [&packageHandlerMap](const std::shared_ptr<const PackageIndex>& packageIndex) {
+            return packageIndex && packageIndex->packageHandlerMap == packageHandlerMap;
+        };
+
+        std::shared_ptr<const PackageIndex> packageIndex = std::atomic_load(&_packageIndex);
+        if (isValid(packageIndex)) {
+            return packageIndex;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        packageIndex = std::atomic_load(&_packageIndex);
+        if (!isValid(packageIndex)) {
+            packageIndex = BuildPackageIndex(packageHandlerMap);
+            std::atomic_store(&_packageIndex, packageIndex);
+        }
+        return packageIndex;
+    }
+
+    std::shared_ptr<BinaryData> PackageManagerTileDataSource::LoadPackageTile(const PackageIndex& packageIndex, const MapTile& mapTile) {
+        // Check only the candidate packages from the index, packages without tile masks are checked last
+        const PackageIndex::Node& node = FindPackageIndexNode(packageIndex, mapTile);
+        for (const std::vector<int>* packageIndices : { &node.packageIndices, &packageIndex.unmaskedPackageIndices }) {
+            for (int index : *packageIndices) {
+                const std::shared_ptr<PackageInfo>& packageInfo = packageIndex.packages[index].first;
+                std::shared_ptr<PackageTileMask> tileMask = packageInfo->getTileMask();
+                if (tileMask) {
+                    if (tileMask->getTileStatus(mapTile) == PackageTileStatus::PACKAGE_TILE_STATUS_MISSING) {
+                        continue;
+                    }
+                }
+
+                std::shared_ptr<BinaryData> data = packageIndex.packages[index].second->loadTile(mapTile);
+                if (data || tileMask) {
+                    return data;
+                }
+            }
+        }
+        return std::shared_ptr<BinaryData>();
+    }
+
+    std::shared_ptr<const PackageManagerTileDataSource::PackageIndex> PackageManagerTileDataSource::BuildPackageIndex(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >& packageHandlerMap) {
+        auto packageIndex = std::make_shared<PackageIndex>();
+        packageIndex->packageHandlerMap = packageHandlerMap;
+        std::vector<int> maskedPackageIndices;
+        for (auto it = packageHandlerMap->begin(); it != packageHandlerMap->end(); it++) {
+            if (auto mapHandler = std::dynamic_pointer_cast<MapPackageHandler>(it->second)) {
+                int index = static_cast<int>(packageIndex->packages.size());
+                packageIndex->packages.emplace_back(it->first, mapHandler);
+                if (it->first->getTileMask()) {
+                    maskedPackageIndices.push_back(index);
+                } else {
+                    packageIndex->unmaskedPackageIndices.push_back(index);
+                }
+            }
+        }
+
+        BuildPackageIndexNode(packageIndex->rootNode, *packageIndex, maskedPackageIndices, MapTile(0, 0, 0, 0));
+        return packageIndex;
+    }
+
+    void PackageManagerTileDataSource::BuildPackageIndexNode(PackageIndex::Node& node, const PackageIndex& packageIndex, const std::vector<int>& packageIndices, const MapTile& tile) {
+        for (int index : packageIndices) {
+            std::shared_ptr<PackageTileMask> tileMask = packageIndex.packages[index].first->getTileMask();
+            if (tileMask->getTileStatus(tile) != PackageTileStatus::PACKAGE_TILE_STATUS_MISSING) {
+                node.packageIndices.push_back(index);
+            }
+        }
+
+        // Subdivide only areas where packages overlap, usually package borders
+        if (node.packageIndices.size() > 1 && tile.getZoom() < MAX_PACKAGE_INDEX_ZOOM) {
+            node.subNodes = std::make_unique<std::array<PackageIndex::Node, 4> >();
+            for (int i = 0; i < 4; i++) {
+                MapTile subTile(tile.getX() * 2 + (i & 1), tile.getY() * 2 + (i >> 1), tile.getZoom() + 1, 0);
+                BuildPackageIndexNode((*node.subNodes)[i], packageIndex, node.packageIndices, subTile);
+            }
+        }
+    }
+
+    const PackageManagerTileDataSource::PackageIndex::Node& PackageManagerTileDataSource::FindPackageIndexNode(const PackageIndex& packageIndex, const MapTile& tile) {
+        const PackageIndex::Node* node = &packageIndex.rootNode;
+        for (int zoom = 1; node->subNodes && zoom <= tile.getZoom(); zoom++) {
+            int shift = tile.getZoom() - zoom;
+            int i = ((tile.getX() >> shift) & 1) + ((tile.getY() >> shift) & 1) * 2;
+            node = &(*node->subNodes)[i];
+        }
+        return *node;
+    }
+        
     PackageManagerTileDataSource::PackageManagerListener::PackageManagerListener(PackageManagerTileDataSource& dataSource) :
         _dataSource(dataSource)
     {
     }
         
     void PackageManagerTileDataSource::PackageManagerListener::onPackagesChanged(PackageChangeType changeType) {
-        {
-            std::lock_guard<std::mutex> lock(_dataSource._mutex);
-            _dataSource._cachedOpenPackageHandlers.clear();
-        }
+        // The index is rebuilt when the next tile is loaded
+        std::atomic_store(&_dataSource._packageIndex, std::shared_ptr<const PackageIndex>());
         _dataSource.notifyTilesChanged(changeType == PACKAGES_DELETED); // we need to remove tiles only if packages were deleted
     }
 
@@ -118,7 +169,7 @@ namespace carto {
         // NOTE: ignore
     }
 
-    const unsigned int PackageManagerTileDataSource::MAX_OPEN_PACKAGES = 4;
+    const int PackageManagerTileDataSource::MAX_PACKAGE_INDEX_ZOOM = 10;
 
 }
 
@@ -13,6 +13,8 @@
 #include "datasources/TileDataSource.h"
 #include "packagemanager/PackageManager.h"
 
+#include <array>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -52,13 +54,32 @@ namespace carto {
             PackageManagerTileDataSource& _dataSource;
         };
 
-        static const unsigned int MAX_OPEN_PACKAGES;
+        struct PackageIndex {
+            struct Node {
+                std::vector<int> packageIndices; // packages with tile masks that contain the node tile
+                std::unique_ptr<std::array<Node, 4> > subNodes;
+            };
+
+            std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > > packageHandlerMap; // package manager snapshot the index was built from
+            std::vector<std::pair<std::shared_ptr<PackageInfo>, std::shared_ptr<MapPackageHandler> > > packages;
+            std::vector<int> unmaskedPackageIndices; // packages without tile masks, candidates for all tiles
+            Node rootNode;
+        };
+
+        std::shared_ptr<const PackageIndex> getPackageIndex(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >& packageHandlerMap) const;
+
+        static std::shared_ptr<BinaryData> LoadPackageTile(const PackageIndex& packageIndex, const MapTile& mapTile);
+        static std::shared_ptr<const PackageIndex> BuildPackageIndex(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >& packageHandlerMap);
+        static void BuildPackageIndexNode(PackageIndex::Node& node, const PackageIndex& packageIndex, const std::vector<int>& packageIndices, const MapTile& tile);
+        static const PackageIndex::Node& FindPackageIndexNode(const PackageIndex& packageIndex, const MapTile& tile);
+
+        static const int MAX_PACKAGE_INDEX_ZOOM;
 
         const std::shared_ptr<PackageManager> _packageManager;
 
-        mutable std::vector<std::pair<std::shared_ptr<PackageInfo>, std::shared_ptr<MapPackageHandler> > > _cachedOpenPackageHandlers;
+        mutable std::shared_ptr<const PackageIndex> _packageIndex; // accessed atomically, null if the index needs to be rebuilt
 
-        mutable std::mutex _mutex;
+        mutable std::mutex _mutex; // used only for building the package index
 
     private:
         std::shared_ptr<PackageManagerListener> _packageManagerListener;
@@ -6,6 +6,8 @@
 #include "utils/Log.h"
 #include "utils/TileUtils.h"
 
+#include <limits>
+
 #include <sqlite3pp.h>
 
 namespace carto {
@@ -13,12 +15,29 @@ namespace carto {
     PersistentCacheTileDataSource::PersistentCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource, const std::string& databasePath) :
         CacheTileDataSource(dataSource),
         _database(),
+        _selectQuery(),
+        _writeDatabase(),
+        _insertCommand(),
+        _updateExpirationCommand(),
+        _deleteCommand(),
+        _touchCommand(),
+        _writeThreadPool(std::make_shared<CancelableThreadPool>()),
+        _writeMutex(),
+        _pendingWrites(),
+        _pendingWriteVersion(0),
+        _pendingTouches(),
+        _writeTaskScheduled(false),
+        _pendingWritesMutex(),
+        _tileInfoLoadStarted(false),
+        _tileInfoLoaded(false),
+        _tileInfoLoadTouchedTileIds(),
         _cacheOnlyMode(false),
         _downloadTasks(),
         _downloadThreadPool(std::make_shared<CancelableThreadPool>()),
         _cache(DEFAULT_CAPACITY),
         _mutex()
     {
+        _writeThreadPool->setPoolSize(1);
         _downloadThreadPool->setPoolSize(1);
         openDatabase(databasePath);
     }
@@ -26,6 +45,7 @@ namespace carto {
     PersistentCacheTileDataSource::~PersistentCacheTileDataSource() {
         stopAllDownloads();
         closeDatabase();
+        _writeThreadPool->deinit();
         _downloadThreadPool->deinit();
     }
     
@@ -69,45 +89,133 @@ namespace carto {
             Log::Error("PersistentCacheTileDataSource::loadTile: Could not connect to the database, loading tile without caching");
         }
 
-        if (_cache.empty()) {
-            loadTileInfo();
+        // Load the tile index in the background, tiles are looked up directly from the database until it is loaded
+        if (_database && !_tileInfoLoadStarted) {
+            _tileInfoLoadStarted = true;
+            auto task = std::make_shared<LoadTileInfoTask>(std::static_pointer_cast<PersistentCacheTileDataSource>(shared_from_this()));
+            _writeThreadPool->execute(task, 0);
+        }
+        if (!_tileInfoLoaded) {
+            _tileInfoLoadTouchedTileIds.push_back(mapTile.getTileId());
         }
         
         std::shared_ptr<TileData> tileData;
 
+        // Expired tiles are kept until the original data source has revalidated them
+        std::shared_ptr<TileData> cachedTileData;
         std::shared_ptr<long long> tileIdPtr;
+        long long staleAge = -1;
         if (_cache.read(mapTile.getTileId(), tileIdPtr)) {
-            tileData = get(mapTile.getTileId());
+            tileData = get(mapTile.getTileId(), true, staleAge);
             if (tileData) {
                 if (tileData->getMaxAge() != 0) {
+                    touch(mapTile.getTileId());
                     return tileData;
                 }
+                if (std::shared_ptr<TileData> staleTileData = useStaleTile(mapTile, tileData, staleAge)) {
+                    touch(mapTile.getTileId());
+                    return staleTileData;
+                }
+                cachedTileData = tileData;
+            } else {
+                _cache.remove(mapTile.getTileId());
+            }
+        } else if (_database && !_tileInfoLoaded) {
+            tileData = get(mapTile.getTileId(), false, staleAge);
+            if (tileData) {
+                std::shared_ptr<TileData> staleTileData;
+                if (tileData->getMaxAge() != 0 || (staleTileData = useStaleTile(mapTile, tileData, staleAge))) {
+                    _cache.put(mapTile.getTileId(), createTileId(mapTile.getTileId()), tileData->getData()->size() + EXTRA_TILE_FOOTPRINT);
+                    touch(mapTile.getTileId());
+                    return staleTileData ? staleTileData : tileData;
+                }
+                cachedTileData = tileData;
             }
-            _cache.remove(mapTile.getTileId());
         }
+        tileData.reset();
         
         if (!_cacheOnlyMode) {
             lock.unlock();
-            tileData = _dataSource->loadTile(mapTile);
+            if (cachedTileData) {
+                tileData = _dataSource->revalidateTile(mapTile, cachedTileData);
+            } else {
+                tileData = _dataSource->loadTile(mapTile);
+            }
             lock.lock();
         }
     
         if (tileData) {
             if (tileData->getMaxAge() != 0 && !tileData->isReplaceWithParent() && tileData->getData()) {
-                long long tileId = mapTile.getTileId();
-                std::size_t tileSize = tileData->getData()->size();
-                _cache.put(mapTile.getTileId(), createTileId(tileId), tileSize + EXTRA_TILE_FOOTPRINT);
-                if (_cache.exists(mapTile.getTileId())) { // make sure the tile was added
-                    store(mapTile.getTileId(), tileData);
-                }
+                updateTile(mapTile.getTileId(), tileData);
+            } else if (cachedTileData) {
+                _cache.remove(mapTile.getTileId());
             }
         } else {
+            if (cachedTileData) {
+                _cache.remove(mapTile.getTileId());
+            }
             Log::Infof("PersistentCacheTileDataSource::loadTile: Failed to load %s", mapTile.toString().c_str());
         }
         
         return tileData;
     }
 
+    bool PersistentCacheTileDataSource::refreshTile(const MapTile& mapTile) {
+        if (isCacheOnlyMode()) {
+            return false;
+        }
+
+        std::shared_ptr<TileData> cachedTileData;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            long long staleAge = -1;
+            cachedTileData = get(mapTile.getTileId(), false, staleAge);
+        }
+
+        std::shared_ptr<TileData> tileData;
+        if (cachedTileData) {
+            tileData = _dataSource->revalidateTile(mapTile, cachedTileData);
+        } else {
+            tileData = _dataSource->loadTile(mapTile);
+        }
+        if (!tileData || tileData->getMaxAge() == 0 || tileData->isReplaceWithParent() || !tileData->getData()) {
+            return false;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (!_database) {
+            return false;
+        }
+        // Unmodified tiles only get a new expiration time, there is no need to reload them
+        return updateTile(mapTile.getTileId(), tileData) && !tileData->isNotModified();
+    }
+
+    bool PersistentCacheTileDataSource::isTileCached(const MapTile& mapTile) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        // Until the tile index is loaded, the cache state is unknown and tiles are loaded one by one. Cache only mode never uses the original data source.
+        if (!_database || !_tileInfoLoaded || _cacheOnlyMode) {
+            return true;
+        }
+        return _cache.exists(mapTile.getTileId());
+    }
+
+    void PersistentCacheTileDataSource::storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData) {
+        if (tileData->getMaxAge() != 0 && !tileData->isReplaceWithParent() && tileData->getData()) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            updateTile(mapTile.getTileId(), tileData);
+        }
+    }
+
+    void PersistentCacheTileDataSource::removeCachedTile(const MapTile& mapTile) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (_cache.exists(mapTile.getTileId())) {
+            _cache.remove(mapTile.getTileId()); // the tile is removed from the database once its id is released
+        } else if (!_tileInfoLoaded) {
+            remove(mapTile.getTileId());
+        }
+    }
+
     bool PersistentCacheTileDataSource::isOpen() const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         return (bool) _database;
@@ -156,7 +264,7 @@ namespace carto {
             try {
                 sqlite3pp::query query1(*_database, "SELECT name FROM sqlite_master WHERE type='table' AND name='persistent_cache'");
                 for (auto it1 = query1.begin(); it1 != query1.end(); ++it1) {
-                    sqlite3pp::query query2(*_database, "SELECT expirationTime FROM persistent_cache");
+                    sqlite3pp::query query2(*_database, "SELECT expirationTime FROM persistent_cache LIMIT 1");
                     for (auto it2 = query2.begin(); it2 != query2.end(); ++it2);
                     query2.finish();
                 }
@@ -174,16 +282,66 @@ namespace carto {
                         tileId INTEGER NOT NULL PRIMARY KEY,
                         compressed BLOB,
                         time INTEGER,
-                        expirationTime INTEGER
+                        expirationTime INTEGER,
+                        etag TEXT,
+                        lastModified TEXT
                     ))SQL");
             command3.execute();
             command3.finish();
+
+            // Index the usage time, so that the tile index can be loaded in usage order without sorting the whole table
+            sqlite3pp::command command4(*_database, "CREATE INDEX IF NOT EXISTS persistent_cache_time ON persistent_cache(time)");
+            command4.execute();
+            command4.finish();
+
+            // Add validator columns to databases created by older versions
+            try {
+                sqlite3pp::query query(*_database, "SELECT etag, lastModified FROM persistent_cache LIMIT 1");
+                for (auto it = query.begin(); it != query.end(); ++it);
+                query.finish();
+            }
+            catch (const std::exception&) {
+                Log::Info("PersistentCacheTileDataSource::openDatabase: Adding tile validator columns");
+                sqlite3pp::command command1(*_database, "ALTER TABLE persistent_cache ADD COLUMN etag TEXT");
+                command1.execute();
+                command1.finish();
+                sqlite3pp::command command2(*_database, "ALTER TABLE persistent_cache ADD COLUMN lastModified TEXT");
+                command2.execute();
+                command2.finish();
+            }
+
+            // Use write-ahead logging, so that the background writer does not block readers
+            sqlite3pp::query query4(*_database, "PRAGMA journal_mode=WAL");
+            for (auto it4 = query4.begin(); it4 != query4.end(); ++it4);
+            query4.finish();
+
+            sqlite3pp::command command5(*_database, "PRAGMA synchronous=NORMAL");
+            command5.execute();
+            command5.finish();
         }
         catch (const std::exception& ex) {
             Log::Errorf("PersistentCacheTileDataSource::openDatabase: Failed to initialize database: %s", ex.what());
             _database.reset();
             return;
         }
+
+        try {
+            _writeDatabase = std::make_unique<sqlite3pp::database>(databasePath.c_str());
+
+            sqlite3pp::command command1(*_writeDatabase, "PRAGMA synchronous=NORMAL");
+            command1.execute();
+            command1.finish();
+
+            sqlite3pp::command command2(*_writeDatabase, "PRAGMA busy_timeout=5000");
+            command2.execute();
+            command2.finish();
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("PersistentCacheTileDataSource::openDatabase: Failed to connect to database: %s", ex.what());
+            _writeDatabase.reset();
+            _database.reset();
+            return;
+        }
     }
 
     void PersistentCacheTileDataSource::closeDatabase() {
@@ -191,7 +349,35 @@ namespace carto {
             return;
         }
 
+        // Commit pending writes before closing the connections
+        _writeThreadPool->cancelAll();
+        flushPendingWrites();
+
+        {
+            std::lock_guard<std::mutex> lock(_writeMutex);
+            try {
+                _insertCommand.reset();
+                _updateExpirationCommand.reset();
+                _deleteCommand.reset();
+                _touchCommand.reset();
+                if (_writeDatabase && _writeDatabase->disconnect() != SQLITE_OK) {
+                    Log::Error("PersistentCacheTileDataSource::closeDatabase: Failed to close database");
+                }
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("PersistentCacheTileDataSource::closeDatabase: Failed to close database: %s", ex.what());
+            }
+            _writeDatabase.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            _pendingWrites.clear();
+            _pendingTouches.clear();
+        }
+
         try {
+            _selectQuery.reset();
             if (_database->disconnect() != SQLITE_OK) {
                 Log::Error("PersistentCacheTileDataSource::closeDatabase: Failed to close database");
             }
@@ -209,55 +395,129 @@ namespace carto {
         struct TileInfo {
             std::uint64_t tileId;
             std::size_t tileSize;
-            std::uint64_t time;
+            long long time;
         };
 
-        if (!_database) {
-            return;
+        // Get tile ids and sizes ordered by the usage time from the database. Use the connection of the writer, so that lookups are not blocked.
+        // The table is read in batches, so that the writer is not blocked for the duration of the whole scan.
+        std::vector<TileInfo> tileInfos;
+        while (true) {
+            std::lock_guard<std::mutex> writeLock(_writeMutex);
+            if (!_writeDatabase) {
+                return;
+            }
+
+            std::size_t count = 0;
+            try {
+                sqlite3pp::query query(*_writeDatabase, "SELECT tileId, LENGTH(compressed), time FROM persistent_cache WHERE time > :time OR (time = :time AND tileId > :tileId) ORDER BY time, tileId LIMIT :count");
+                query.bind(":time", tileInfos.empty() ? std::numeric_limits<long long>::min() : tileInfos.back().time);
+                query.bind(":tileId", tileInfos.empty() ? std::numeric_limits<long long>::min() : static_cast<long long>(tileInfos.back().tileId));
+                query.bind(":count", static_cast<int>(TILE_INFO_LOAD_BATCH_SIZE));
+                for (auto it = query.begin(); it != query.end(); ++it) {
+                    TileInfo tileInfo;
+                    tileInfo.tileId = (*it).get<std::uint64_t>(0);
+                    tileInfo.tileSize = static_cast<std::size_t>((*it).get<std::uint64_t>(1));
+                    tileInfo.time = (*it).get<long long>(2);
+                    tileInfos.push_back(tileInfo);
+                    count++;
+                }
+                query.finish();
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("PersistentCacheTileDataSource::loadTileInfo: Failed to query tile set from the database: %s", ex.what());
+                break;
+            }
+            if (count < TILE_INFO_LOAD_BATCH_SIZE) {
+                break;
+            }
         }
 
-        try {
-            // Get tile ids and sizes ordered by the timestamp from the database
-            std::vector<TileInfo> tileInfos;
-            tileInfos.reserve(_cache.capacity() / (EXTRA_TILE_FOOTPRINT + 1));
-            sqlite3pp::query query(*_database, "SELECT tileId, LENGTH(compressed), time FROM persistent_cache");
-            for (auto it = query.begin(); it != query.end(); ++it) {
-                TileInfo tileInfo;
-                tileInfo.tileId = (*it).get<std::uint64_t>(0);
-                tileInfo.tileSize = static_cast<std::size_t>((*it).get<std::uint64_t>(1));
-                tileInfo.time = (*it).get<std::uint64_t>(2);
-                tileInfos.push_back(tileInfo);
+        // Tiles used since startup are already in the cache and are more recent than any loaded tile. To keep them from being evicted,
+        // only the most recent loaded tiles that fit into the remaining capacity are added, older tiles are removed from the database.
+        std::size_t firstIndex = tileInfos.size();
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            std::size_t availableSize = _cache.capacity() > _cache.size() ? _cache.capacity() - _cache.size() : 0;
+            std::size_t loadedSize = 0;
+            while (firstIndex > 0) {
+                std::size_t tileSize = tileInfos[firstIndex - 1].tileSize + EXTRA_TILE_FOOTPRINT;
+                if (loadedSize + tileSize > availableSize) {
+                    break;
+                }
+                loadedSize += tileSize;
+                firstIndex--;
             }
-            query.finish();
+        }
 
-            // Sort the tiles
-            std::sort(tileInfos.begin(), tileInfos.end(), [](const TileInfo& tileInfo1, const TileInfo& tileInfo2) {
-                return tileInfo1.time < tileInfo2.time;
-            });
+        // Now store the queried items in cache in batches, without letting the cache evict anything.
+        // Tiles already added by lookups or with pending writes are skipped, as their state is more recent.
+        for (std::size_t i = 0; i < tileInfos.size(); i += TILE_INFO_LOAD_BATCH_SIZE) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            if (!_database) {
+                return;
+            }
 
-            // Now store the queried items in cache. This may result in eviction of some of the items.
-            for (const TileInfo& tileInfo : tileInfos) {
-                _cache.put(tileInfo.tileId, createTileId(tileInfo.tileId), tileInfo.tileSize + EXTRA_TILE_FOOTPRINT);
+            for (std::size_t j = i; j < std::min(tileInfos.size(), i + TILE_INFO_LOAD_BATCH_SIZE); j++) {
+                const TileInfo& tileInfo = tileInfos[j];
+                if (_cache.exists(tileInfo.tileId)) {
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> pendingLock(_pendingWritesMutex);
+                    if (_pendingWrites.find(tileInfo.tileId) != _pendingWrites.end()) {
+                        continue;
+                    }
+                }
+                std::size_t tileSize = tileInfo.tileSize + EXTRA_TILE_FOOTPRINT;
+                if (j < firstIndex || _cache.size() + tileSize > _cache.capacity()) {
+                    remove(tileInfo.tileId);
+                    continue;
+                }
+                _cache.put(tileInfo.tileId, createTileId(tileInfo.tileId), tileSize);
             }
         }
-        catch (const std::exception& ex) {
-            Log::Errorf("PersistentCacheTileDataSource::loadTileInfo: Failed to query tile set from the database: %s", ex.what());
+
+        // Mark tiles used during loading as most recently used
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        for (long long tileId : _tileInfoLoadTouchedTileIds) {
+            std::shared_ptr<long long> tileIdPtr;
+            _cache.read(tileId, tileIdPtr);
         }
+        _tileInfoLoadTouchedTileIds.clear();
+        _tileInfoLoaded = true;
     }
     
-    std::shared_ptr<TileData> PersistentCacheTileDataSource::get(long long tileId) {
+    std::shared_ptr<TileData> PersistentCacheTileDataSource::get(long long tileId, bool logMissing, long long& staleAge) {
+        staleAge = -1;
         if (!_database) {
             return std::shared_ptr<TileData>();
         }
+
+        // Check writes that are not yet committed
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            auto it = _pendingWrites.find(tileId);
+            if (it != _pendingWrites.end()) {
+                if (it->second.tileData) {
+                    staleAge = it->second.tileData->getStaleAge();
+                }
+                return it->second.tileData;
+            }
+        }
     
         try {
             // Get the tile from the database
-            sqlite3pp::query query(*_database, "SELECT compressed, expirationTime FROM persistent_cache WHERE tileId=:tileId");
-            query.bind(":tileId", static_cast<std::uint64_t>(tileId));
-            auto qit = query.begin();
-            if (qit == query.end()) {
+            if (!_selectQuery) {
+                _selectQuery = std::make_unique<sqlite3pp::query>(*_database, "SELECT compressed, expirationTime, etag, lastModified FROM persistent_cache WHERE tileId=:tileId");
+            }
+            _selectQuery->bind(":tileId", static_cast<std::uint64_t>(tileId));
+            auto qit = _selectQuery->begin();
+            if (qit == _selectQuery->end()) {
                 // No data exists for this tile in the database
-                Log::Error("PersistentCacheTileDataSource::get: Inconsistency, tile data does not exist in the database");
+                _selectQuery->reset();
+                if (logMissing) {
+                    Log::Error("PersistentCacheTileDataSource::get: Inconsistency, tile data does not exist in the database");
+                }
                 return std::shared_ptr<TileData>();
             }
             
@@ -265,18 +525,24 @@ namespace carto {
             std::size_t dataSize = (*qit).column_bytes(0);
             const unsigned char* dataPtr = static_cast<const unsigned char*>((*qit).get<const void*>(0));
             long long expirationTime = (*qit).get<std::uint64_t>(1);
+            std::string etag = (*qit).column_type(2) != SQLITE_NULL ? (*qit).get<const char*>(2) : "";
+            std::string lastModified = (*qit).column_type(3) != SQLITE_NULL ? (*qit).get<const char*>(3) : "";
             auto data = std::make_shared<BinaryData>(dataPtr, dataSize);
-            query.finish();
+            _selectQuery->reset();
             
             auto tileData = std::make_shared<TileData>(data);
+            tileData->setETag(etag);
+            tileData->setLastModified(lastModified);
             if (expirationTime != 0) {
                 long long maxAge = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::time_point(std::chrono::milliseconds(expirationTime)) - std::chrono::system_clock::now()).count();
                 tileData->setMaxAge(maxAge > 0 ? maxAge : 0);
+                staleAge = maxAge < 0 ? -maxAge : -1;
             }
             return tileData;
         }
         catch (const std::exception& ex) {
             Log::Errorf("PersistentCacheTileDataSource::get: Failed to query tile data from the database: %s", ex.what());
+            _selectQuery.reset();
             return std::shared_ptr<TileData>();
         }
     }
@@ -292,18 +558,50 @@ namespace carto {
             expirationTime = std::chrono::duration_cast<std::chrono::milliseconds>((std::chrono::system_clock::now() + std::chrono::milliseconds(tileData->getMaxAge())).time_since_epoch()).count();
         }
 
-        // Add tile to the database
-        try {
-            sqlite3pp::command command(*_database, "INSERT OR REPLACE INTO persistent_cache(tileId, compressed, time, expirationTime) VALUES (:tileId, :compressed, :time, :expirationTime)");
-            command.bind(":tileId", static_cast<std::uint64_t>(tileId));
-            command.bind(":compressed", tileData->getData()->data(), static_cast<unsigned int>(tileData->getData()->size()));
-            command.bind(":time", static_cast<std::uint64_t>(time));
-            command.bind(":expirationTime", static_cast<std::uint64_t>(expirationTime));
-            command.execute();
-            command.finish();
+        // Add tile to the write queue
+        PendingWrite pendingWrite;
+        pendingWrite.tileData = tileData;
+        pendingWrite.time = time;
+        pendingWrite.expirationTime = expirationTime;
+        pendingWrite.dataUnchanged = tileData->isNotModified();
+        addPendingWrite(tileId, pendingWrite);
+    }
+
+    bool PersistentCacheTileDataSource::updateTile(long long tileId, const std::shared_ptr<TileData>& tileData) {
+        // If the tile was revalidated and is still in the cache, keep the existing cache entry and update only the expiration time
+        if (tileData->isNotModified() && _cache.exists(tileId)) {
+            std::shared_ptr<long long> tileIdPtr;
+            _cache.read(tileId, tileIdPtr);
+        } else {
+            _cache.put(tileId, createTileId(tileId), tileData->getData()->size() + EXTRA_TILE_FOOTPRINT);
+            if (!_cache.exists(tileId)) { // make sure the tile was added
+                return false;
+            }
         }
-        catch (const std::exception& ex) {
-            Log::Errorf("PersistentCacheTileDataSource::store: Failed to store tile data in the database: %s", ex.what());
+        store(tileId, tileData);
+        return true;
+    }
+
+    void PersistentCacheTileDataSource::touch(long long tileId) {
+        if (!_database) {
+            return;
+        }
+
+        // Usage time updates are written together with other changes, this keeps the order of the tile index across sessions
+        long long time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        bool scheduleTask = false;
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            _pendingTouches[tileId] = time;
+            if (!_writeTaskScheduled) {
+                _writeTaskScheduled = true;
+                scheduleTask = true;
+            }
+        }
+
+        if (scheduleTask) {
+            auto task = std::make_shared<WriteTask>(std::static_pointer_cast<PersistentCacheTileDataSource>(shared_from_this()));
+            _writeThreadPool->execute(task, 0);
         }
     }
 
@@ -312,14 +610,124 @@ namespace carto {
             return;
         }
         
+        PendingWrite pendingWrite;
+        pendingWrite.time = 0;
+        pendingWrite.expirationTime = 0;
+        pendingWrite.dataUnchanged = false;
+        addPendingWrite(tileId, pendingWrite);
+    }
+
+    void PersistentCacheTileDataSource::addPendingWrite(long long tileId, const PendingWrite& pendingWrite) {
+        bool scheduleTask = false;
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            PendingWrite& write = _pendingWrites[tileId];
+            write = pendingWrite;
+            write.version = ++_pendingWriteVersion;
+            if (!_writeTaskScheduled) {
+                _writeTaskScheduled = true;
+                scheduleTask = true;
+            }
+        }
+
+        if (scheduleTask) {
+            auto task = std::make_shared<WriteTask>(std::static_pointer_cast<PersistentCacheTileDataSource>(shared_from_this()));
+            _writeThreadPool->execute(task, 0);
+        }
+    }
+
+    void PersistentCacheTileDataSource::flushPendingWrites() {
+        std::lock_guard<std::mutex> writeLock(_writeMutex);
+
+        // Take a snapshot of the queue. Entries are kept in the queue until committed, so that readers can find them.
+        std::vector<std::pair<long long, PendingWrite> > pendingWrites;
+        std::unordered_map<long long, long long> pendingTouches;
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            _writeTaskScheduled = false;
+            pendingWrites.assign(_pendingWrites.begin(), _pendingWrites.end());
+            std::swap(pendingTouches, _pendingTouches);
+        }
+        if ((pendingWrites.empty() && pendingTouches.empty()) || !_writeDatabase) {
+            return;
+        }
+
+        // Write all changes in a single transaction
         try {
-            sqlite3pp::command command(*_database, "DELETE FROM persistent_cache WHERE tileId=:tileId");
-            command.bind(":tileId", static_cast<std::uint64_t>(tileId));
-            command.execute();
-            command.finish();
+            if (!_insertCommand) {
+                _insertCommand = std::make_unique<sqlite3pp::command>(*_writeDatabase, "INSERT OR REPLACE INTO persistent_cache(tileId, compressed, time, expirationTime, etag, lastModified) VALUES (:tileId, :compressed, :time, :expirationTime, :etag, :lastModified)");
+            }
+            if (!_updateExpirationCommand) {
+                _updateExpirationCommand = std::make_unique<sqlite3pp::command>(*_writeDatabase, "UPDATE persistent_cache SET time=:time, expirationTime=:expirationTime, etag=:etag, lastModified=:lastModified WHERE tileId=:tileId");
+            }
+            if (!_deleteCommand) {
+                _deleteCommand = std::make_unique<sqlite3pp::command>(*_writeDatabase, "DELETE FROM persistent_cache WHERE tileId=:tileId");
+            }
+            if (!_touchCommand) {
+                _touchCommand = std::make_unique<sqlite3pp::command>(*_writeDatabase, "UPDATE persistent_cache SET time=:time WHERE tileId=:tileId");
+            }
+
+            sqlite3pp::transaction xct(*_writeDatabase);
+            for (const std::pair<long long, PendingWrite>& pendingWrite : pendingWrites) {
+                long long tileId = pendingWrite.first;
+                const PendingWrite& write = pendingWrite.second;
+                if (write.tileData) {
+                    std::string etag = write.tileData->getETag();
+                    std::string lastModified = write.tileData->getLastModified();
+
+                    // For revalidated tiles, try to update only the expiration time. Insert the tile if it was removed in the meantime.
+                    if (write.dataUnchanged) {
+                        _updateExpirationCommand->bind(":tileId", static_cast<std::uint64_t>(tileId));
+                        _updateExpirationCommand->bind(":time", static_cast<std::uint64_t>(write.time));
+                        _updateExpirationCommand->bind(":expirationTime", static_cast<std::uint64_t>(write.expirationTime));
+                        _updateExpirationCommand->bind(":etag", etag.c_str());
+                        _updateExpirationCommand->bind(":lastModified", lastModified.c_str());
+                        _updateExpirationCommand->execute();
+                        _updateExpirationCommand->reset();
+                        if (_writeDatabase->changes() > 0) {
+                            continue;
+                        }
+                    }
+
+                    _insertCommand->bind(":tileId", static_cast<std::uint64_t>(tileId));
+                    _insertCommand->bind(":compressed", write.tileData->getData()->data(), static_cast<unsigned int>(write.tileData->getData()->size()));
+                    _insertCommand->bind(":time", static_cast<std::uint64_t>(write.time));
+                    _insertCommand->bind(":expirationTime", static_cast<std::uint64_t>(write.expirationTime));
+                    _insertCommand->bind(":etag", etag.c_str());
+                    _insertCommand->bind(":lastModified", lastModified.c_str());
+                    _insertCommand->execute();
+                    _insertCommand->reset();
+                } else {
+                    _deleteCommand->bind(":tileId", static_cast<std::uint64_t>(tileId));
+                    _deleteCommand->execute();
+                    _deleteCommand->reset();
+                }
+            }
+            for (const std::pair<const long long, long long>& pendingTouch : pendingTouches) {
+                _touchCommand->bind(":tileId", static_cast<std::uint64_t>(pendingTouch.first));
+                _touchCommand->bind(":time", static_cast<std::uint64_t>(pendingTouch.second));
+                _touchCommand->execute();
+                _touchCommand->reset();
+            }
+            xct.commit();
         }
         catch (const std::exception& ex) {
-            Log::Errorf("PersistentCacheTileDataSource::remove: Failed to remove tile from the database: %s", ex.what());
+            Log::Errorf("PersistentCacheTileDataSource::flushPendingWrites: Failed to write tiles to the database: %s", ex.what());
+            _insertCommand.reset();
+            _updateExpirationCommand.reset();
+            _deleteCommand.reset();
+            _touchCommand.reset();
+        }
+
+        // Remove written entries from the queue, unless they were updated in the meantime. Failed writes are not retried.
+        {
+            std::lock_guard<std::mutex> lock(_pendingWritesMutex);
+            for (const std::pair<long long, PendingWrite>& pendingWrite : pendingWrites) {
+                auto it = _pendingWrites.find(pendingWrite.first);
+                if (it != _pendingWrites.end() && it->second.version == pendingWrite.second.version) {
+                    _pendingWrites.erase(it);
+                }
+            }
         }
     }
     
@@ -429,8 +837,31 @@ namespace carto {
         }
     }
 
+    PersistentCacheTileDataSource::LoadTileInfoTask::LoadTileInfoTask(const std::shared_ptr<PersistentCacheTileDataSource>& dataSource) :
+        _dataSource(dataSource)
+    {
+    }
+
+    void PersistentCacheTileDataSource::LoadTileInfoTask::run() {
+        if (auto dataSource = _dataSource.lock()) {
+            dataSource->loadTileInfo();
+        }
+    }
+
+    PersistentCacheTileDataSource::WriteTask::WriteTask(const std::shared_ptr<PersistentCacheTileDataSource>& dataSource) :
+        _dataSource(dataSource)
+    {
+    }
+
+    void PersistentCacheTileDataSource::WriteTask::run() {
+        if (auto dataSource = _dataSource.lock()) {
+            dataSource->flushPendingWrites();
+        }
+    }
+
     const unsigned int PersistentCacheTileDataSource::DEFAULT_CAPACITY = 50 * 1024 * 1024;
     const unsigned int PersistentCacheTileDataSource::EXTRA_TILE_FOOTPRINT = 1024;
+    const unsigned int PersistentCacheTileDataSource::TILE_INFO_LOAD_BATCH_SIZE = 1024;
 
 }
 
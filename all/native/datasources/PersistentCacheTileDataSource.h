@@ -18,11 +18,15 @@
 #include <memory>
 #include <string>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include <stdext/timed_lru_cache.h>
 
 namespace sqlite3pp {
     class database;
+    class command;
+    class query;
 }
 
 namespace carto {
@@ -31,10 +35,14 @@ namespace carto {
     /**
      * A tile data source that loads tiles from another tile data source
      * and caches them in an offline sqlite database. Tiles will remain in the database
-     * even after the application is closed.
+     * even after the application is closed. Tiles are written to the database in batches
+     * from a background thread and the database uses write-ahead logging.
      * The database contains table "persistent_cache" with the following fields:
      * "tileId" (tile id), "compressed" (compressed tile image),
-     * "time" (the time the tile was cached in milliseconds from epoch).
+     * "time" (the time the tile was cached or last used in milliseconds from epoch),
+     * "expirationTime" (the expiration time of the tile in milliseconds from epoch, 0 if the tile does not expire),
+     * "etag" and "lastModified" (validators of the tile). Expired tiles are revalidated using the original data source,
+     * if the tile has not changed, only its expiration time is updated.
      * Default cache capacity is 50MB.
      */
     class PersistentCacheTileDataSource : public CacheTileDataSource {
@@ -112,8 +120,43 @@ namespace carto {
             DirectorPtr<TileDownloadListener> _downloadListener;
         };
 
+        class LoadTileInfoTask : public CancelableTask {
+        public:
+            explicit LoadTileInfoTask(const std::shared_ptr<PersistentCacheTileDataSource>& dataSource);
+
+            virtual void run();
+
+        private:
+            std::weak_ptr<PersistentCacheTileDataSource> _dataSource;
+        };
+
+        class WriteTask : public CancelableTask {
+        public:
+            explicit WriteTask(const std::shared_ptr<PersistentCacheTileDataSource>& dataSource);
+
+            virtual void run();
+
+        private:
+            std::weak_ptr<PersistentCacheTileDataSource> _dataSource;
+        };
+
+        struct PendingWrite {
+            std::shared_ptr<TileData> tileData; // null if the tile should be removed
+            long long time;
+            long long expirationTime;
+            bool dataUnchanged; // only the expiration time and validators need to be updated
+            long long version;
+        };
+
         static const unsigned int DEFAULT_CAPACITY;
         static const unsigned int EXTRA_TILE_FOOTPRINT;
+        static const unsigned int TILE_INFO_LOAD_BATCH_SIZE;
+
+        virtual bool refreshTile(const MapTile& mapTile);
+
+        virtual bool isTileCached(const MapTile& mapTile);
+        virtual void storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData);
+        virtual void removeCachedTile(const MapTile& mapTile);
 
         void openDatabase(const std::string& databasePath);
         void closeDatabase();
@@ -121,13 +164,37 @@ namespace carto {
 
         void downloadArea(const MapBounds& mapBounds, int minZoom, int maxZoom, const std::shared_ptr<TileDownloadListener>& listener);
         
-        std::shared_ptr<TileData> get(long long tileId);
+        std::shared_ptr<TileData> get(long long tileId, bool logMissing, long long& staleAge);
         void store(long long tileId, const std::shared_ptr<TileData>& tileData);
+        bool updateTile(long long tileId, const std::shared_ptr<TileData>& tileData);
+        void touch(long long tileId);
         void remove(long long tileId);
 
+        void addPendingWrite(long long tileId, const PendingWrite& pendingWrite);
+        void flushPendingWrites();
+
         std::shared_ptr<long long> createTileId(long long tileId);
         
         std::unique_ptr<sqlite3pp::database> _database;
+        std::unique_ptr<sqlite3pp::query> _selectQuery;
+
+        std::unique_ptr<sqlite3pp::database> _writeDatabase; // separate connection for the background writer, guarded by _writeMutex
+        std::unique_ptr<sqlite3pp::command> _insertCommand;
+        std::unique_ptr<sqlite3pp::command> _updateExpirationCommand;
+        std::unique_ptr<sqlite3pp::command> _deleteCommand;
+        std::unique_ptr<sqlite3pp::command> _touchCommand;
+        std::shared_ptr<CancelableThreadPool> _writeThreadPool;
+        std::mutex _writeMutex;
+
+        std::unordered_map<long long, PendingWrite> _pendingWrites; // writes not yet committed to the database, guarded by _pendingWritesMutex
+        long long _pendingWriteVersion;
+        std::unordered_map<long long, long long> _pendingTouches; // tiles with updated usage time, guarded by _pendingWritesMutex
+        bool _writeTaskScheduled;
+        mutable std::mutex _pendingWritesMutex;
+
+        bool _tileInfoLoadStarted;
+        bool _tileInfoLoaded;
+        std::vector<long long> _tileInfoLoadTouchedTileIds; // tiles used while the tile info was being loaded
         
         bool _cacheOnlyMode;
 
@@ -0,0 +1,436 @@
+#include "ShardedMemoryCacheTileDataSource.h"
+#include "core/BinaryData.h"
+#include "core/MapTile.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <miniz.h>
+
+namespace carto {
+
+    ShardedMemoryCacheTileDataSource::ShardedMemoryCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource) :
+        CacheTileDataSource(dataSource),
+        _shards(),
+        _size(0),
+        _capacity(DEFAULT_CAPACITY),
+        _compressedSize(0),
+        _compressedCapacity(0),
+        _trimShardIndex(0),
+        _hitCount(0),
+        _missCount(0),
+        _compressedHitCount(0),
+        _evictionCount(0),
+        _memoryGovernorHandle(),
+        _compressedMemoryGovernorHandle()
+    {
+        for (Shard& shard : _shards) {
+            shard.size = 0;
+            shard.compressedSize = 0;
+        }
+
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("ShardedMemoryCacheTileDataSource", MemoryTrimLevel::MEMORY_TRIM_LEVEL_MODERATE, DEFAULT_CAPACITY,
+            [this](std::size_t capacityInBytes) {
+                applyCapacity(capacityInBytes);
+            },
+            [this]() {
+                clear();
+            }
+        );
+
+        // The compressed tier is cheap to refill from the original data source, so it is trimmed first
+        _compressedMemoryGovernorHandle = MemoryGovernor::RegisterCache("ShardedMemoryCacheTileDataSource compressed tier", MemoryTrimLevel::MEMORY_TRIM_LEVEL_LOW, 0,
+            [this](std::size_t capacityInBytes) {
+                applyCompressedCapacity(capacityInBytes);
+            },
+            [this]() {
+                clearCompressedTiles();
+            }
+        );
+    }
+
+    ShardedMemoryCacheTileDataSource::~ShardedMemoryCacheTileDataSource() {
+        MemoryGovernor::UnregisterCache(_compressedMemoryGovernorHandle);
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
+    }
+
+    std::shared_ptr<TileData> ShardedMemoryCacheTileDataSource::loadTile(const MapTile& mapTile) {
+        long long tileId = mapTile.getTileId();
+        Shard& shard = getShard(tileId);
+
+        std::shared_ptr<TileData> tileData;
+        if (readTile(shard, mapTile, tileData)) {
+            _hitCount++;
+            _memoryGovernorHandle->addHit();
+            return tileData;
+        }
+        if (readCompressedTile(shard, mapTile, tileData)) {
+            _hitCount++;
+            _compressedHitCount++;
+            _memoryGovernorHandle->addHit();
+            _compressedMemoryGovernorHandle->addHit();
+            storeTile(shard, tileId, tileData);
+            return tileData;
+        }
+        _missCount++;
+        _memoryGovernorHandle->addMiss();
+        _compressedMemoryGovernorHandle->addMiss();
+
+        tileData = _dataSource->loadTile(mapTile);
+
+        if (tileData) {
+            if (tileData->getMaxAge() != 0 && tileData->getData() && !tileData->isReplaceWithParent()) {
+                storeTile(shard, tileId, tileData);
+            }
+        } else {
+            Log::Infof("ShardedMemoryCacheTileDataSource::loadTile: Failed to load %s.", mapTile.toString().c_str());
+        }
+
+        return tileData;
+    }
+
+    void ShardedMemoryCacheTileDataSource::clear() {
+        for (Shard& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.entries.clear();
+            shard.entryMap.clear();
+            _size -= shard.size;
+            shard.size = 0;
+            shard.compressedEntries.clear();
+            shard.compressedEntryMap.clear();
+            _compressedSize -= shard.compressedSize;
+            shard.compressedSize = 0;
+        }
+    }
+
+    std::size_t ShardedMemoryCacheTileDataSource::getCapacity() const {
+        return _memoryGovernorHandle->getCapacity();
+    }
+
+    void ShardedMemoryCacheTileDataSource::setCapacity(std::size_t capacityInBytes) {
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
+    }
+
+    std::size_t ShardedMemoryCacheTileDataSource::getCompressedCapacity() const {
+        return _compressedMemoryGovernorHandle->getCapacity();
+    }
+
+    void ShardedMemoryCacheTileDataSource::setCompressedCapacity(std::size_t capacityInBytes) {
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _compressedMemoryGovernorHandle->setCapacity(capacityInBytes);
+    }
+
+    bool ShardedMemoryCacheTileDataSource::refreshTile(const MapTile& mapTile) {
+        std::shared_ptr<TileData> tileData = _dataSource->loadTile(mapTile);
+        if (!tileData || tileData->getMaxAge() == 0 || !tileData->getData() || tileData->isReplaceWithParent()) {
+            return false;
+        }
+
+        long long tileId = mapTile.getTileId();
+        storeTile(getShard(tileId), tileId, tileData);
+        return true;
+    }
+
+    bool ShardedMemoryCacheTileDataSource::isTileCached(const MapTile& mapTile) {
+        long long tileId = mapTile.getTileId();
+        Shard& shard = getShard(tileId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.entryMap.find(tileId) != shard.entryMap.end() || shard.compressedEntryMap.find(tileId) != shard.compressedEntryMap.end();
+    }
+
+    void ShardedMemoryCacheTileDataSource::storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData) {
+        _missCount++;
+        _memoryGovernorHandle->addMiss();
+        _compressedMemoryGovernorHandle->addMiss();
+        if (tileData->getMaxAge() != 0 && tileData->getData() && !tileData->isReplaceWithParent()) {
+            long long tileId = mapTile.getTileId();
+            storeTile(getShard(tileId), tileId, tileData);
+        }
+    }
+
+    void ShardedMemoryCacheTileDataSource::removeCachedTile(const MapTile& mapTile) {
+        long long tileId = mapTile.getTileId();
+        Shard& shard = getShard(tileId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entryMap.find(tileId);
+        if (it != shard.entryMap.end()) {
+            std::size_t tileSize = GetTileSize(it->second->second);
+            shard.size -= tileSize;
+            _size -= tileSize;
+            shard.entries.erase(it->second);
+            shard.entryMap.erase(it);
+        }
+        auto compressedIt = shard.compressedEntryMap.find(tileId);
+        if (compressedIt != shard.compressedEntryMap.end()) {
+            std::size_t tileSize = GetCompressedTileSize(*compressedIt->second);
+            shard.compressedSize -= tileSize;
+            _compressedSize -= tileSize;
+            shard.compressedEntries.erase(compressedIt->second);
+            shard.compressedEntryMap.erase(compressedIt);
+        }
+    }
+
+    long long ShardedMemoryCacheTileDataSource::getHitCount() const {
+        return _hitCount.load();
+    }
+
+    long long ShardedMemoryCacheTileDataSource::getMissCount() const {
+        return _missCount.load();
+    }
+
+    long long ShardedMemoryCacheTileDataSource::getCompressedHitCount() const {
+        return _compressedHitCount.load();
+    }
+
+    long long ShardedMemoryCacheTileDataSource::getEvictionCount() const {
+        return _evictionCount.load();
+    }
+
+    ShardedMemoryCacheTileDataSource::Shard& ShardedMemoryCacheTileDataSource::getShard(long long tileId) {
+        // Tile ids of neighbouring tiles are consecutive, so mix the bits before selecting the shard
+        unsigned long long hash = static_cast<unsigned long long>(tileId) * 0x9E3779B97F4A7C15ULL;
+        return _shards[static_cast<std::size_t>(hash >> 32) % SHARD_COUNT];
+    }
+
+    void ShardedMemoryCacheTileDataSource::applyCapacity(std::size_t capacityInBytes) {
+        _capacity.store(capacityInBytes);
+        trimTiles(-1);
+    }
+
+    void ShardedMemoryCacheTileDataSource::applyCompressedCapacity(std::size_t capacityInBytes) {
+        _compressedCapacity.store(capacityInBytes);
+        trimCompressedTiles(-1);
+    }
+
+    void ShardedMemoryCacheTileDataSource::clearCompressedTiles() {
+        for (Shard& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.compressedEntries.clear();
+            shard.compressedEntryMap.clear();
+            _compressedSize -= shard.compressedSize;
+            shard.compressedSize = 0;
+        }
+    }
+
+    bool ShardedMemoryCacheTileDataSource::readTile(Shard& shard, const MapTile& mapTile, std::shared_ptr<TileData>& tileData) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.entryMap.find(mapTile.getTileId());
+        if (it == shard.entryMap.end()) {
+            return false;
+        }
+        std::shared_ptr<TileData> cachedTileData = it->second->second;
+        if (cachedTileData->getMaxAge() == 0) {
+            cachedTileData = useStaleTile(mapTile, cachedTileData, cachedTileData->getStaleAge());
+            if (!cachedTileData) {
+                shard.size -= GetTileSize(it->second->second);
+                _size -= GetTileSize(it->second->second);
+                shard.entries.erase(it->second);
+                shard.entryMap.erase(it);
+                return false;
+            }
+        }
+
+        // Mark the tile as most recently used
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        tileData = cachedTileData;
+        return true;
+    }
+
+    bool ShardedMemoryCacheTileDataSource::readCompressedTile(Shard& shard, const MapTile& mapTile, std::shared_ptr<TileData>& tileData) {
+        // Take the entry out of the compressed tier, it will be moved to the main cache after decompression
+        std::list<Shard::CompressedEntry> entries;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto it = shard.compressedEntryMap.find(mapTile.getTileId());
+            if (it == shard.compressedEntryMap.end()) {
+                return false;
+            }
+            shard.compressedSize -= GetCompressedTileSize(*it->second);
+            _compressedSize -= GetCompressedTileSize(*it->second);
+            entries.splice(entries.begin(), shard.compressedEntries, it->second);
+            shard.compressedEntryMap.erase(it);
+        }
+        const Shard::CompressedEntry& entry = entries.front();
+
+        // Expired tiles can only be used as stale tiles within the grace period
+        long long maxAge = -1;
+        long long staleAge = -1;
+        if (entry.expirationTime) {
+            maxAge = std::chrono::duration_cast<std::chrono::milliseconds>(*entry.expirationTime - std::chrono::steady_clock::now()).count();
+            if (maxAge <= 0) {
+                staleAge = -maxAge;
+                maxAge = 0;
+                if (staleAge > getStaleTileGracePeriod()) {
+                    return false;
+                }
+            }
+        }
+
+        std::vector<unsigned char> data(entry.dataSize);
+        mz_ulong dataSize = static_cast<mz_ulong>(data.size());
+        if (mz_uncompress(data.data(), &dataSize, entry.compressedData.data(), static_cast<mz_ulong>(entry.compressedData.size())) != MZ_OK || dataSize != data.size()) {
+            Log::Error("ShardedMemoryCacheTileDataSource::readCompressedTile: Failed to decompress tile");
+            return false;
+        }
+
+        tileData = std::make_shared<TileData>(std::make_shared<BinaryData>(std::move(data)));
+        tileData->setMaxAge(maxAge);
+        tileData->setReplaceWithParent(entry.replaceWithParent);
+        tileData->setETag(entry.etag);
+        tileData->setLastModified(entry.lastModified);
+        if (maxAge == 0) {
+            tileData = useStaleTile(mapTile, tileData, staleAge);
+            return (bool) tileData;
+        }
+        return true;
+    }
+
+    void ShardedMemoryCacheTileDataSource::storeTile(Shard& shard, long long tileId, const std::shared_ptr<TileData>& tileData) {
+        std::size_t tileSize = GetTileSize(tileData);
+        if (tileSize > _capacity.load()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto it = shard.entryMap.find(tileId);
+            if (it != shard.entryMap.end()) {
+                shard.size -= GetTileSize(it->second->second);
+                _size -= GetTileSize(it->second->second);
+                shard.entries.erase(it->second);
+                shard.entryMap.erase(it);
+            }
+            auto compressedIt = shard.compressedEntryMap.find(tileId);
+            if (compressedIt != shard.compressedEntryMap.end()) {
+                shard.compressedSize -= GetCompressedTileSize(*compressedIt->second);
+                _compressedSize -= GetCompressedTileSize(*compressedIt->second);
+                shard.compressedEntries.erase(compressedIt->second);
+                shard.compressedEntryMap.erase(compressedIt);
+            }
+
+            shard.entries.emplace_front(tileId, tileData);
+            shard.entryMap[tileId] = shard.entries.begin();
+            shard.size += tileSize;
+            _size += tileSize;
+        }
+
+        trimTiles(tileId);
+    }
+
+    void ShardedMemoryCacheTileDataSource::storeCompressedTiles(Shard& shard, const std::vector<Shard::Entry>& entries) {
+        for (const Shard::Entry& entry : entries) {
+            const std::shared_ptr<TileData>& tileData = entry.second;
+            long long maxAge = tileData->getMaxAge();
+            long long staleAge = tileData->getStaleAge();
+            if (_compressedCapacity.load() == 0 || (maxAge == 0 && staleAge > getStaleTileGracePeriod())) {
+                _evictionCount++;
+                continue;
+            }
+
+            // Compress using fast compression level, keep the tile only if it actually gets smaller
+            const std::shared_ptr<BinaryData>& data = tileData->getData();
+            std::vector<unsigned char> compressedData(mz_compressBound(static_cast<mz_ulong>(data->size())));
+            mz_ulong compressedSize = static_cast<mz_ulong>(compressedData.size());
+            if (mz_compress2(compressedData.data(), &compressedSize, data->data(), static_cast<mz_ulong>(data->size()), MZ_BEST_SPEED) != MZ_OK || compressedSize >= data->size()) {
+                _evictionCount++;
+                continue;
+            }
+            compressedData.resize(compressedSize);
+            compressedData.shrink_to_fit();
+
+            // Keep the expiration time (also for stale tiles), the validators and the parent replacement flag of the tile
+            std::list<Shard::CompressedEntry> compressedEntries;
+            compressedEntries.push_back(Shard::CompressedEntry { entry.first, std::move(compressedData), data->size(), std::shared_ptr<std::chrono::steady_clock::time_point>(), tileData->isReplaceWithParent(), tileData->getETag(), tileData->getLastModified() });
+            if (maxAge > 0) {
+                compressedEntries.front().expirationTime = std::make_shared<std::chrono::steady_clock::time_point>(std::chrono::steady_clock::now() + std::chrono::milliseconds(maxAge));
+            } else if (maxAge == 0) {
+                compressedEntries.front().expirationTime = std::make_shared<std::chrono::steady_clock::time_point>(std::chrono::steady_clock::now() - std::chrono::milliseconds(std::max(staleAge, 0LL)));
+            }
+            std::size_t tileSize = GetCompressedTileSize(compressedEntries.front());
+
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+
+                // The tile may have been stored again while it was compressed
+                if (tileSize > _compressedCapacity.load() || shard.entryMap.find(entry.first) != shard.entryMap.end() || shard.compressedEntryMap.find(entry.first) != shard.compressedEntryMap.end()) {
+                    _evictionCount++;
+                    continue;
+                }
+
+                shard.compressedEntries.splice(shard.compressedEntries.begin(), compressedEntries);
+                shard.compressedEntryMap[entry.first] = shard.compressedEntries.begin();
+                shard.compressedSize += tileSize;
+                _compressedSize += tileSize;
+            }
+
+            trimCompressedTiles(entry.first);
+        }
+    }
+
+    void ShardedMemoryCacheTileDataSource::trimTiles(long long keepTileId) {
+        // The capacity is shared by all shards, so a shard can use more than its share while the total size fits.
+        // Remove least recently used tiles from the shards in turns until the total size fits the capacity.
+        // Only a single shard is locked at a time, evicted tiles are compressed without holding the lock.
+        bool evicted = true;
+        while (evicted && _size.load() > _capacity.load()) {
+            evicted = false;
+            unsigned int startIndex = _trimShardIndex++;
+            for (unsigned int i = 0; i < SHARD_COUNT && _size.load() > _capacity.load(); i++) {
+                Shard& shard = _shards[(startIndex + i) % SHARD_COUNT];
+                std::vector<Shard::Entry> evictedEntries;
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    if (shard.entries.empty() || shard.entries.back().first == keepTileId) {
+                        continue;
+                    }
+                    Shard::Entry& entry = shard.entries.back();
+                    shard.size -= GetTileSize(entry.second);
+                    _size -= GetTileSize(entry.second);
+                    shard.entryMap.erase(entry.first);
+                    evictedEntries.push_back(std::move(entry));
+                    shard.entries.pop_back();
+                }
+                storeCompressedTiles(shard, evictedEntries);
+                evicted = true;
+            }
+        }
+    }
+
+    void ShardedMemoryCacheTileDataSource::trimCompressedTiles(long long keepTileId) {
+        bool evicted = true;
+        while (evicted && _compressedSize.load() > _compressedCapacity.load()) {
+            evicted = false;
+            unsigned int startIndex = _trimShardIndex++;
+            for (unsigned int i = 0; i < SHARD_COUNT && _compressedSize.load() > _compressedCapacity.load(); i++) {
+                Shard& shard = _shards[(startIndex + i) % SHARD_COUNT];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (shard.compressedEntries.empty() || shard.compressedEntries.back().tileId == keepTileId) {
+                    continue;
+                }
+                const Shard::CompressedEntry& entry = shard.compressedEntries.back();
+                shard.compressedSize -= GetCompressedTileSize(entry);
+                _compressedSize -= GetCompressedTileSize(entry);
+                shard.compressedEntryMap.erase(entry.tileId);
+                shard.compressedEntries.pop_back();
+                _evictionCount++;
+                evicted = true;
+            }
+        }
+    }
+
+    std::size_t ShardedMemoryCacheTileDataSource::GetTileSize(const std::shared_ptr<TileData>& tileData) {
+        return tileData->getData()->size() + 16;
+    }
+
+    std::size_t ShardedMemoryCacheTileDataSource::GetCompressedTileSize(const Shard::CompressedEntry& entry) {
+        return entry.compressedData.size() + entry.etag.size() + entry.lastModified.size() + 32;
+    }
+
+    const unsigned int ShardedMemoryCacheTileDataSource::DEFAULT_CAPACITY = 6 * 1024 * 1024;
+
+}
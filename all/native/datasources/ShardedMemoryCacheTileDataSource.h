@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_SHARDEDMEMORYCACHETILEDATASOURCE_H_
+#define _CARTO_SHARDEDMEMORYCACHETILEDATASOURCE_H_
+
+#include "datasources/CacheTileDataSource.h"
+#include "utils/MemoryGovernor.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace carto {
+
+    /**
+     * A tile data source that loads tiles from another tile data source
+     * and caches them in memory. Unlike MemoryCacheTileDataSource, the cache is split
+     * into multiple independently locked LRU shards based on the tile id, so that concurrent
+     * tile requests from multiple threads do not block each other. The capacity is shared by all shards.
+     * Optionally tiles evicted from the cache can be kept in a secondary compressed tier,
+     * they are decompressed and moved back to the main cache when requested again.
+     * This cache is not persistent, tiles will be cleared once the application closes.
+     * Default cache capacity is 6MB, the compressed tier is disabled by default.
+     */
+    class ShardedMemoryCacheTileDataSource : public CacheTileDataSource {
+    public:
+        /**
+         * Constructs a ShardedMemoryCacheTileDataSource object from tile data source.
+         * @param dataSource The datasource to be cached.
+         */
+        explicit ShardedMemoryCacheTileDataSource(const std::shared_ptr<TileDataSource>& dataSource);
+        virtual ~ShardedMemoryCacheTileDataSource();
+
+        virtual std::shared_ptr<TileData> loadTile(const MapTile& mapTile);
+
+        virtual void clear();
+
+        virtual std::size_t getCapacity() const;
+
+        virtual void setCapacity(std::size_t capacityInBytes);
+
+        /**
+         * Returns the capacity of the compressed tier.
+         * @return The capacity of the compressed tier in bytes.
+         */
+        std::size_t getCompressedCapacity() const;
+        /**
+         * Sets the capacity of the compressed tier. Tiles evicted from the main cache are compressed
+         * and kept in this tier until its capacity is exceeded. The capacity is in addition to the main cache capacity.
+         * The actual capacity may be lower if the global memory budget is exceeded.
+         * @param capacityInBytes The new capacity of the compressed tier in bytes. 0 disables the compressed tier.
+         */
+        void setCompressedCapacity(std::size_t capacityInBytes);
+
+        /**
+         * Returns the number of tile requests served from the cache.
+         * @return The number of cache hits.
+         */
+        long long getHitCount() const;
+        /**
+         * Returns the number of tile requests that had to be loaded from the original data source.
+         * @return The number of cache misses.
+         */
+        long long getMissCount() const;
+        /**
+         * Returns the number of tile requests served from the compressed tier. These are included in the hit count.
+         * @return The number of compressed tier hits.
+         */
+        long long getCompressedHitCount() const;
+        /**
+         * Returns the number of tiles removed from the cache due to the capacity limits.
+         * Tiles moved from the main cache to the compressed tier are not counted.
+         * @return The number of evicted tiles.
+         */
+        long long getEvictionCount() const;
+
+    protected:
+        static const unsigned int DEFAULT_CAPACITY;
+
+        virtual bool refreshTile(const MapTile& mapTile);
+
+        virtual bool isTileCached(const MapTile& mapTile);
+        virtual void storeLoadedTile(const MapTile& mapTile, const std::shared_ptr<TileData>& tileData);
+        virtual void removeCachedTile(const MapTile& mapTile);
+
+    private:
+        struct Shard {
+            typedef std::pair<long long, std::shared_ptr<TileData> > Entry;
+
+            struct CompressedEntry {
+                long long tileId;
+                std::vector<unsigned char> compressedData;
+                std::size_t dataSize;
+                std::shared_ptr<std::chrono::steady_clock::time_point> expirationTime;
+                bool replaceWithParent;
+                std::string etag;
+                std::string lastModified;
+            };
+
+            std::list<Entry> entries; // ordered from most recently used to least recently used
+            std::unordered_map<long long, std::list<Entry>::iterator> entryMap;
+            std::size_t size;
+
+            std::list<CompressedEntry> compressedEntries; // ordered from most recently used to least recently used
+            std::unordered_map<long long, std::list<CompressedEntry>::iterator> compressedEntryMap;
+            std::size_t compressedSize;
+
+            std::mutex mutex;
+        };
+
+        enum { SHARD_COUNT = 16 };
+
+        Shard& getShard(long long tileId);
+
+        void applyCapacity(std::size_t capacityInBytes);
+        void applyCompressedCapacity(std::size_t capacityInBytes);
+        void clearCompressedTiles();
+
+        bool readTile(Shard& shard, const MapTile& mapTile, std::shared_ptr<TileData>& tileData);
+        bool readCompressedTile(Shard& shard, const MapTile& mapTile, std::shared_ptr<TileData>& tileData);
+        void storeTile(Shard& shard, long long tileId, const std::shared_ptr<TileData>& tileData);
+        void storeCompressedTiles(Shard& shard, const std::vector<Shard::Entry>& entries);
+
+        void trimTiles(long long keepTileId);
+        void trimCompressedTiles(long long keepTileId);
+
+        static std::size_t GetTileSize(const std::shared_ptr<TileData>& tileData);
+        static std::size_t GetCompressedTileSize(const Shard::CompressedEntry& entry);
+
+        std::array<Shard, SHARD_COUNT> _shards;
+        std::atomic<std::size_t> _size; // total size of all shards
+        std::atomic<std::size_t> _capacity;
+        std::atomic<std::size_t> _compressedSize; // total compressed size of all shards
+        std::atomic<std::size_t> _compressedCapacity;
+        std::atomic<unsigned int> _trimShardIndex; // shard to start trimming from, rotated to spread the evictions
+        std::atomic<long long> _hitCount;
+        std::atomic<long long> _missCount;
+        std::atomic<long long> _compressedHitCount;
+        std::atomic<long long> _evictionCount;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
+        std::shared_ptr<MemoryGovernor::CacheHandle> _compressedMemoryGovernorHandle;
+    };
+
+}
+
+#endif
@@ -29,6 +29,23 @@ namespace carto {
         return _projection;
     }
     
+    bool TileDataSource::isBatchLoadingSupported() const {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<TileData> > TileDataSource::loadTiles(const std::vector<MapTile>& tiles) {
+        std::vector<std::shared_ptr<TileData> > tileDatas;
+        tileDatas.reserve(tiles.size());
+        for (const MapTile& tile : tiles) {
+            tileDatas.push_back(loadTile(tile));
+        }
+        return tileDatas;
+    }
+
+    std::shared_ptr<TileData> TileDataSource::revalidateTile(const MapTile& tile, const std::shared_ptr<TileData>& cachedTileData) {
+        return loadTile(tile);
+    }
+
     void TileDataSource::notifyTilesChanged(bool removeTiles) {
         std::vector<std::shared_ptr<OnChangeListener> > onChangeListeners;
         {
@@ -39,6 +56,17 @@ namespace carto {
             listener->onTilesChanged(removeTiles);
         }
     }
+
+    void TileDataSource::notifyTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        std::vector<std::shared_ptr<OnChangeListener> > onChangeListeners;
+        {
+            std::lock_guard<std::mutex> lock(_onChangeListenersMutex);
+            onChangeListeners = _onChangeListeners;
+        }
+        for (const std::shared_ptr<OnChangeListener>& listener : onChangeListeners) {
+            listener->onTilesChanged(removeTiles, bounds);
+        }
+    }
         
     void TileDataSource::registerOnChangeListener(const std::shared_ptr<OnChangeListener>& listener) {
         std::lock_guard<std::mutex> lock(_onChangeListenersMutex);
@@ -38,6 +38,13 @@ namespace carto {
              * @param removeTiles The remove tiles flag.
              */
             virtual void onTilesChanged(bool removeTiles) = 0;
+            /**
+             * Listener method that gets called when tiles within the specified bounds have changes and need to be updated.
+             * The default implementation updates all tiles.
+             * @param removeTiles The remove tiles flag.
+             * @param bounds The bounds of the changed area in the coordinate system of the data source projection.
+             */
+            virtual void onTilesChanged(bool removeTiles, const MapBounds& bounds) { onTilesChanged(removeTiles); }
         };
         
         virtual ~TileDataSource();
@@ -73,6 +80,33 @@ namespace carto {
          * @return The tile data. If the tile is not available, null may be returned.
          */
         virtual std::shared_ptr<TileData> loadTile(const MapTile& tile) = 0;
+        /**
+         * Returns true if the data source can load multiple tiles with loadTiles more efficiently than one by one.
+         * Tile layers group tile requests into batches only for such data sources, other data sources are queried in parallel.
+         * The default implementation returns false.
+         * @return True if batch loading is supported.
+         */
+        virtual bool isBatchLoadingSupported() const;
+        /**
+         * Loads the specified tiles as a single batch.
+         * The default implementation loads the tiles one by one using loadTile. Data sources
+         * that can load multiple tiles more efficiently should override this method and isBatchLoadingSupported.
+         * Note: the tile coordinate system used here is vertically flipped relative to layer tile coordinate system.
+         * @param tiles The tiles to load.
+         * @return The tile data for each tile, in the same order as the tiles. If a tile is not available, the corresponding element may be null.
+         */
+        virtual std::vector<std::shared_ptr<TileData> > loadTiles(const std::vector<MapTile>& tiles);
+        /**
+         * Reloads the specified tile that is already cached, but has expired.
+         * Data sources that support conditional requests can use the validators of the cached tile data
+         * and return tile data with 'not modified' flag set and the cached data if the tile has not changed.
+         * The default implementation simply loads the tile using loadTile.
+         * Note: the tile coordinate system used here is vertically flipped relative to layer tile coordinate system.
+         * @param tile The tile to reload.
+         * @param cachedTileData The cached tile data.
+         * @return The tile data. If the tile is not available, null may be returned.
+         */
+        virtual std::shared_ptr<TileData> revalidateTile(const MapTile& tile, const std::shared_ptr<TileData>& cachedTileData);
     
         /**
          * Notifies listeners that the tiles have changed. Action taken depends on the implementation of the
@@ -81,6 +115,13 @@ namespace carto {
          * @param removeTiles The remove tiles flag.
          */
         virtual void notifyTilesChanged(bool removeTiles);
+        /**
+         * Notifies listeners that the tiles within the specified bounds have changed. Only the tiles intersecting the bounds
+         * need to be reloaded, other cached tiles stay valid.
+         * @param removeTiles The remove tiles flag.
+         * @param bounds The bounds of the changed area in the coordinate system of the data source projection.
+         */
+        virtual void notifyTilesChanged(bool removeTiles, const MapBounds& bounds);
     
         /**
          * Registers listener for data source change events.
@@ -31,6 +31,10 @@ namespace carto {
         return _projection;
     }
 
+    std::shared_ptr<VectorData> VectorDataSource::streamElements(const std::shared_ptr<CullState>& cullState, const PartialElementsHandler& handler) {
+        return loadElements(cullState);
+    }
+
     void VectorDataSource::notifyElementsChanged() {
         std::shared_ptr<std::vector<std::shared_ptr<OnChangeListener> > > onChangeListeners;
         {
@@ -10,6 +10,7 @@
 #include "core/MapBounds.h"
 #include "datasources/components/VectorData.h"
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -28,6 +29,8 @@ namespace carto {
      */
     class VectorDataSource : public std::enable_shared_from_this<VectorDataSource> {
     public:
+        typedef std::function<bool(const std::vector<std::shared_ptr<VectorElement> >&)> PartialElementsHandler;
+
         /**
          * Interface for monitoring data source change events.
          */
@@ -87,6 +90,14 @@ namespace carto {
          * @return The vector of loaded vector elements. If no elements are available, null may be returned.
          */
         virtual std::shared_ptr<VectorData> loadElements(const std::shared_ptr<CullState>& cullState) = 0;
+        /**
+         * Loads all the elements within the defined envelope, reporting partial results while loading.
+         * The default implementation simply calls loadElements.
+         * @param cullState State for describing view parameters and conservative view envelope.
+         * @param handler The handler that receives chunks of newly created elements. If it returns false, loading is aborted.
+         * @return The vector of all loaded vector elements (including the reported ones). If no elements are available or loading was aborted, null may be returned.
+         */
+        virtual std::shared_ptr<VectorData> streamElements(const std::shared_ptr<CullState>& cullState, const PartialElementsHandler& handler);
         
         /**
          * Notifies listeners that all vector elements have changed. This method refreshes all the existing 
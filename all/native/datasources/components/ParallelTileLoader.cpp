@@ -0,0 +1,162 @@
+#include "ParallelTileLoader.h"
+#include "components/CancelableThreadPool.h"
+#include "datasources/TileDataSource.h"
+#include "datasources/components/TileData.h"
+#include "utils/Log.h"
+
+#include <chrono>
+
+namespace carto {
+
+    ParallelTileLoader::ParallelTileLoader(int dataSourceCount) :
+        _dataSourceCount(dataSourceCount),
+        _statistics(std::make_shared<std::vector<Statistics> >(dataSourceCount)),
+        _concurrent(false),
+        _loadThreadPool(),
+        _mutex()
+    {
+    }
+
+    ParallelTileLoader::~ParallelTileLoader() {
+        if (_loadThreadPool) {
+            _loadThreadPool->cancelAll();
+            _loadThreadPool->deinit();
+        }
+    }
+
+    bool ParallelTileLoader::isConcurrent() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _concurrent;
+    }
+
+    void ParallelTileLoader::setConcurrent(bool concurrent) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _concurrent = concurrent;
+        // The pool is kept when concurrent mode is disabled, so that loads in progress can finish
+        if (concurrent && !_loadThreadPool) {
+            _loadThreadPool = std::make_shared<CancelableThreadPool>();
+            _loadThreadPool->setPoolSize(_dataSourceCount * LOAD_THREADS_PER_DATASOURCE);
+        }
+    }
+
+    double ParallelTileLoader::getLoadLatency(int index) const {
+        if (index < 0 || index >= _dataSourceCount) {
+            return 0.0;
+        }
+        const Statistics& statistics = (*_statistics)[index];
+        long long count = statistics.loadCount.load();
+        return count > 0 ? statistics.loadTime.load() / (count * 1000.0) : 0.0;
+    }
+
+    std::vector<std::shared_ptr<TileData> > ParallelTileLoader::loadTile(const std::vector<std::shared_ptr<TileDataSource> >& dataSources, const MapTile& mapTile, const AcceptFunc& acceptFunc) {
+        std::shared_ptr<CancelableThreadPool> threadPool;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_concurrent) {
+                threadPool = _loadThreadPool;
+            }
+        }
+
+        if (!threadPool) {
+            std::vector<std::shared_ptr<TileData> > results(dataSources.size());
+            for (std::size_t i = 0; i < dataSources.size(); i++) {
+                if (dataSources[i]) {
+                    results[i] = LoadTile(dataSources[i], mapTile, (*_statistics)[i]);
+                    if (results[i] && acceptFunc(results[i])) {
+                        break;
+                    }
+                }
+            }
+            return results;
+        }
+
+        // Start loads from all data sources, wait until a result is accepted or all loads are finished
+        auto state = std::make_shared<LoadState>(dataSources.size());
+        std::vector<std::shared_ptr<LoadTask> > tasks;
+        for (std::size_t i = 0; i < dataSources.size(); i++) {
+            if (dataSources[i]) {
+                tasks.push_back(std::make_shared<LoadTask>(dataSources[i], mapTile, static_cast<int>(i), acceptFunc, state, _statistics));
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->pendingCount++;
+            }
+        }
+        for (const std::shared_ptr<LoadTask>& task : tasks) {
+            threadPool->execute(task);
+        }
+
+        std::vector<std::shared_ptr<TileData> > results;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&state]() { return state->accepted || state->pendingCount == 0; });
+            results = state->results;
+        }
+
+        // Loads that have not started yet are not needed any more, results of loads in progress are ignored
+        for (const std::shared_ptr<LoadTask>& task : tasks) {
+            task->cancel();
+        }
+        return results;
+    }
+
+    ParallelTileLoader::LoadTask::LoadTask(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& mapTile, int index, const AcceptFunc& acceptFunc, const std::shared_ptr<LoadState>& state, const std::shared_ptr<std::vector<Statistics> >& statistics) :
+        CancelableTask(),
+        _dataSource(dataSource),
+        _mapTile(mapTile),
+        _index(index),
+        _acceptFunc(acceptFunc),
+        _state(state),
+        _statistics(statistics),
+        _finished(false)
+    {
+    }
+
+    void ParallelTileLoader::LoadTask::cancel() {
+        CancelableTask::cancel();
+        finish(std::shared_ptr<TileData>());
+    }
+
+    void ParallelTileLoader::LoadTask::run() {
+        if (isCanceled()) {
+            return;
+        }
+
+        std::shared_ptr<TileData> tileData;
+        try {
+            tileData = LoadTile(_dataSource, _mapTile, (*_statistics)[_index]);
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("ParallelTileLoader::LoadTask: Exception while loading tile: %s", ex.what());
+        }
+        finish(tileData);
+    }
+
+    void ParallelTileLoader::LoadTask::finish(const std::shared_ptr<TileData>& tileData) {
+        if (_finished.exchange(true)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            _state->pendingCount--;
+            if (_state->accepted) {
+                return;
+            }
+            if (tileData) {
+                _state->results[_index] = tileData;
+                _state->accepted = _acceptFunc(tileData);
+            }
+        }
+        _state->condition.notify_all();
+    }
+
+    std::shared_ptr<TileData> ParallelTileLoader::LoadTile(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& mapTile, Statistics& statistics) {
+        auto loadStartTime = std::chrono::steady_clock::now();
+        std::shared_ptr<TileData> tileData = dataSource->loadTile(mapTile);
+        auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStartTime);
+        statistics.loadTime += loadTime.count();
+        statistics.loadCount++;
+        return tileData;
+    }
+
+    const int ParallelTileLoader::LOAD_THREADS_PER_DATASOURCE = 4;
+
+}
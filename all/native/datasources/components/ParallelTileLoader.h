@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_PARALLELTILELOADER_H_
+#define _CARTO_PARALLELTILELOADER_H_
+
+#include "core/MapTile.h"
+#include "components/CancelableTask.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace carto {
+    class CancelableThreadPool;
+    class TileData;
+    class TileDataSource;
+
+    /**
+     * An internal helper for combined data sources that loads a tile from a fixed list of child data sources,
+     * either one after another or concurrently. Also keeps per-child latency statistics.
+     */
+    class ParallelTileLoader {
+    public:
+        typedef std::function<bool(const std::shared_ptr<TileData>&)> AcceptFunc;
+
+        explicit ParallelTileLoader(int dataSourceCount);
+        virtual ~ParallelTileLoader();
+
+        bool isConcurrent() const;
+        void setConcurrent(bool concurrent);
+
+        /**
+         * Returns the average load latency of the specified child data source.
+         * @param index The index of the child data source.
+         * @return The average load latency in milliseconds.
+         */
+        double getLoadLatency(int index) const;
+
+        /**
+         * Loads the tile from the child data sources. Null data sources are skipped.
+         * Loading stops once the accept function returns true for a loaded tile. In concurrent mode queued loads
+         * are canceled at this point and results of loads that are still in progress are discarded.
+         * @param dataSources The child data sources, in preference order.
+         * @param mapTile The tile to load.
+         * @param acceptFunc The function that decides whether the loaded tile can be used as the final result.
+         * @return The loaded tiles for each child data source. Skipped, failed and discarded loads are null.
+         */
+        std::vector<std::shared_ptr<TileData> > loadTile(const std::vector<std::shared_ptr<TileDataSource> >& dataSources, const MapTile& mapTile, const AcceptFunc& acceptFunc);
+
+    private:
+        struct Statistics {
+            std::atomic<long long> loadTime; // total time in microseconds
+            std::atomic<long long> loadCount;
+
+            Statistics() : loadTime(0), loadCount(0) { }
+        };
+
+        struct LoadState {
+            std::vector<std::shared_ptr<TileData> > results;
+            int pendingCount;
+            bool accepted;
+            std::condition_variable condition;
+            std::mutex mutex;
+
+            explicit LoadState(std::size_t count) : results(count), pendingCount(0), accepted(false), condition(), mutex() { }
+        };
+
+        class LoadTask : public CancelableTask {
+        public:
+            LoadTask(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& mapTile, int index, const AcceptFunc& acceptFunc, const std::shared_ptr<LoadState>& state, const std::shared_ptr<std::vector<Statistics> >& statistics);
+
+            virtual void cancel();
+            virtual void run();
+
+        private:
+            void finish(const std::shared_ptr<TileData>& tileData);
+
+            std::shared_ptr<TileDataSource> _dataSource;
+            MapTile _mapTile;
+            int _index;
+            AcceptFunc _acceptFunc;
+            std::shared_ptr<LoadState> _state;
+            std::shared_ptr<std::vector<Statistics> > _statistics;
+            std::atomic<bool> _finished;
+        };
+
+        static std::shared_ptr<TileData> LoadTile(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& mapTile, Statistics& statistics);
+
+        static const int LOAD_THREADS_PER_DATASOURCE;
+
+        const int _dataSourceCount;
+        std::shared_ptr<std::vector<Statistics> > _statistics;
+        bool _concurrent;
+        std::shared_ptr<CancelableThreadPool> _loadThreadPool; // created when concurrent mode is first enabled
+        mutable std::mutex _mutex;
+    };
+
+}
+
+#endif
@@ -4,7 +4,7 @@
 namespace carto {
     
     TileData::TileData(const std::shared_ptr<BinaryData>& data) :
-        _data(data), _expirationTime(), _replaceWithParent(false), _mutex()
+        _data(data), _expirationTime(), _replaceWithParent(false), _etag(), _lastModified(), _notModified(false), _mutex()
     {
     }
 
@@ -32,6 +32,17 @@ namespace carto {
         }
     }
     
+    long long TileData::getStaleAge() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_expirationTime) {
+            return -1;
+        } else {
+            long long staleAge = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - *_expirationTime).count();
+            return staleAge >= 0 ? staleAge : -1;
+        }
+    }
+    
     bool TileData::isReplaceWithParent() const {
         std::lock_guard<std::mutex> lock(_mutex);
         return _replaceWithParent;
@@ -42,6 +53,36 @@ namespace carto {
         _replaceWithParent = flag;
     }
     
+    std::string TileData::getETag() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _etag;
+    }
+
+    void TileData::setETag(const std::string& etag) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _etag = etag;
+    }
+
+    std::string TileData::getLastModified() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _lastModified;
+    }
+
+    void TileData::setLastModified(const std::string& lastModified) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _lastModified = lastModified;
+    }
+
+    bool TileData::isNotModified() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _notModified;
+    }
+
+    void TileData::setNotModified(bool flag) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _notModified = flag;
+    }
+    
     const std::shared_ptr<BinaryData>& TileData::getData() const {
         return _data;
     }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace carto {
@@ -37,6 +38,11 @@ namespace carto {
          * @param maxAge Tile data maximum age in milliseconds, or -1 if the data does not expire.
          */
         void setMaxAge(long long maxAge);
+        /**
+         * Returns the time elapsed since the tile data expired.
+         * @return Time elapsed since the expiration in milliseconds, or -1 if the data has not expired or does not expire.
+         */
+        long long getStaleAge() const;
         
         /**
          * Returns true if the tile should be replaced with parent tile.
@@ -48,6 +54,39 @@ namespace carto {
          * @param flag True when the tile should be replaced with the parent, false otherwise.
          */
         void setReplaceWithParent(bool flag);
+
+        /**
+         * Returns the entity tag of the tile data, as returned by the server in ETag header.
+         * @return The entity tag of the tile data, or empty string if not known.
+         */
+        std::string getETag() const;
+        /**
+         * Sets the entity tag of the tile data.
+         * @param etag The entity tag of the tile data.
+         */
+        void setETag(const std::string& etag);
+        /**
+         * Returns the last modification time of the tile data, as returned by the server in Last-Modified header.
+         * @return The last modification time of the tile data in HTTP date format, or empty string if not known.
+         */
+        std::string getLastModified() const;
+        /**
+         * Sets the last modification time of the tile data.
+         * @param lastModified The last modification time of the tile data in HTTP date format.
+         */
+        void setLastModified(const std::string& lastModified);
+
+        /**
+         * Returns true if the tile data was revalidated and is not modified compared to the cached version.
+         * In that case the data is the same as the cached data and only the expiration time needs to be updated.
+         * @return True if the tile data was not modified, false otherwise.
+         */
+        bool isNotModified() const;
+        /**
+         * Sets the not modified flag of the tile data.
+         * @param flag True if the tile data is not modified compared to the cached version, false otherwise.
+         */
+        void setNotModified(bool flag);
         
         /**
          * Returns tile data as binary data.
@@ -59,6 +98,9 @@ namespace carto {
         const std::shared_ptr<BinaryData> _data;
         std::shared_ptr<std::chrono::steady_clock::time_point> _expirationTime;
         bool _replaceWithParent;
+        std::string _etag;
+        std::string _lastModified;
+        bool _notModified;
         mutable std::mutex _mutex;
     };
 
@@ -122,11 +122,12 @@ namespace carto {
 
     void EditableVectorLayer::setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
         const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+        const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
         const std::weak_ptr<Options>& options,
         const std::weak_ptr<MapRenderer>& mapRenderer,
         const std::weak_ptr<TouchHandler>& touchHandler)
     {
-        VectorLayer::setComponents(envelopeThreadPool, tileThreadPool, options, mapRenderer, touchHandler);
+        VectorLayer::setComponents(envelopeThreadPool, tileThreadPool, tileBuildThreadPool, options, mapRenderer, touchHandler);
         _overlayRenderer->setComponents(options, mapRenderer);
 
         // Register/unregister touch handler listener
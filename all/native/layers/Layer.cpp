@@ -153,6 +153,7 @@ namespace carto {
     Layer::Layer() :
         _envelopeThreadPool(),
         _tileThreadPool(),
+        _tileBuildThreadPool(),
         _mutex(),
         _updatePriority(0),
         _cullDelay(DEFAULT_CULL_DELAY),
@@ -169,6 +170,7 @@ namespace carto {
     
     void Layer::setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                               const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                              const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                               const std::weak_ptr<Options>& options,
                               const std::weak_ptr<MapRenderer>& mapRenderer,
                               const std::weak_ptr<TouchHandler>& touchHandler)
@@ -184,6 +186,7 @@ namespace carto {
         // access to these threadpools is thread safe
         _envelopeThreadPool = envelopeThreadPool;
         _tileThreadPool = tileThreadPool;
+        _tileBuildThreadPool = tileBuildThreadPool;
         _mapRenderer = mapRenderer;
         _touchHandler = touchHandler;
         _options = options;
@@ -73,16 +73,29 @@ namespace carto {
         _nmlModelLODTreeEventListener(),
         _nmlModelLODTreeRenderer(std::make_shared<NMLModelLODTreeRenderer>()),
         _glResourceManager(),
-        _projectionSurface()
+        _projectionSurface(),
+        _memoryGovernorHandle()
     {
         if (!dataSource) {
             throw NullArgumentException("Null dataSource");
         }
 
         _fetchThreadPool->setPoolSize(1);
+
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("NMLModelLODTreeLayer", MemoryTrimLevel::MEMORY_TRIM_LEVEL_CRITICAL, DEFAULT_MAX_MEMORY_SIZE,
+            [this](std::size_t capacityInBytes) {
+                _maxMemorySize.store(capacityInBytes);
+                refresh();
+            },
+            [this]() {
+                clearCaches();
+            }
+        );
     }
     
     NMLModelLODTreeLayer::~NMLModelLODTreeLayer() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
+
         _fetchThreadPool->cancelAll();
         _fetchThreadPool->deinit();
     }
@@ -92,12 +105,12 @@ namespace carto {
     }
 
     std::size_t NMLModelLODTreeLayer::getMaxMemorySize() const {
-        return _maxMemorySize.load();
+        return _memoryGovernorHandle->getCapacity();
     }
 
     void NMLModelLODTreeLayer::setMaxMemorySize(std::size_t size) {
-        _maxMemorySize.store(size);
-        refresh();
+        // Actual limit is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(size);
     }
 
     float NMLModelLODTreeLayer::getLODResolutionFactor() const {
@@ -179,11 +192,12 @@ namespace carto {
 
     void NMLModelLODTreeLayer::setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                                     const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                                    const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                                     const std::weak_ptr<Options>& options,
                                     const std::weak_ptr<MapRenderer>& mapRenderer,
                                     const std::weak_ptr<TouchHandler>& touchHandler)
     {
-        Layer::setComponents(envelopeThreadPool, tileThreadPool, options, mapRenderer, touchHandler);
+        Layer::setComponents(envelopeThreadPool, tileThreadPool, tileBuildThreadPool, options, mapRenderer, touchHandler);
         _nmlModelLODTreeRenderer->setComponents(options, mapRenderer);
 
         // To reduce memory usage, release all the caches now
@@ -415,7 +429,7 @@ namespace carto {
         // Create new queue by taking root nodes from initial queue until size limits are exceeded
         std::size_t totalSize = 0;
         std::priority_queue<SizeNodePair> queue;
-        std::size_t maxMemorySize = getMaxMemorySize();
+        std::size_t maxMemorySize = _maxMemorySize.load();
         while (!initialQueue.empty()) {
             SizeNodePair sizeNodePair = initialQueue.top();
             initialQueue.pop();
@@ -15,6 +15,7 @@
 #include "datasources/NMLModelLODTreeDataSource.h"
 #include "graphics/ViewState.h"
 #include "layers/Layer.h"
+#include "utils/MemoryGovernor.h"
 
 #include <atomic>
 #include <string>
@@ -110,6 +111,7 @@ namespace carto {
     
         virtual void setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                                    const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                                   const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                                    const std::weak_ptr<Options>& options,
                                    const std::weak_ptr<MapRenderer>& mapRenderer,
                                    const std::weak_ptr<TouchHandler>& touchHandler);
@@ -218,7 +220,7 @@ namespace carto {
         static const unsigned int DEFAULT_MESH_CACHE_SIZE;
         static const unsigned int DEFAULT_TEXTURE_CACHE_SIZE;
     
-        std::atomic<std::size_t> _maxMemorySize;
+        std::atomic<std::size_t> _maxMemorySize; // the limit applied by the memory governor
         std::atomic<float> _LODResolutionFactor;
     
         MapTileList _mapTileList;
@@ -246,6 +248,8 @@ namespace carto {
 
         std::weak_ptr<GLResourceManager> _glResourceManager;
         std::weak_ptr<ProjectionSurface> _projectionSurface;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
     };
     
 }
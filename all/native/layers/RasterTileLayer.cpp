@@ -81,22 +81,34 @@ namespace carto {
         _visibleTileIds(),
         _tempDrawDatas(),
         _visibleCache(128 * 1024 * 1024), // limit should be never reached during normal use cases
-        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE)
+        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _memoryGovernorHandle()
     {
         setCullDelay(DEFAULT_CULL_DELAY);
+
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("RasterTileLayer", MemoryTrimLevel::MEMORY_TRIM_LEVEL_LOW, DEFAULT_PRELOADING_CACHE_SIZE,
+            [this](std::size_t capacityInBytes) {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _preloadingCache.resize(capacityInBytes);
+            },
+            [this]() {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _preloadingCache.clear();
+            }
+        );
     }
     
     RasterTileLayer::~RasterTileLayer() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
     }
     
     std::size_t RasterTileLayer::getTextureCacheCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _preloadingCache.capacity();
+        return _memoryGovernorHandle->getCapacity();
     }
     
     void RasterTileLayer::setTextureCacheCapacity(std::size_t capacityInBytes) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _preloadingCache.resize(capacityInBytes);
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
     }
     
     RasterTileFilterMode::RasterTileFilterMode RasterTileLayer::getTileFilterMode() const {
@@ -159,26 +171,20 @@ namespace carto {
             } else {
                 _preloadingCache.get(tileId);
             }
+            _memoryGovernorHandle->addHit();
             return true;
         }
         if (_visibleCache.exists(tileId) && _visibleCache.valid(tileId)) {
             _visibleCache.get(tileId); // just mark usage, do not move to preloading, it will be moved at later stage
             return true;
         }
+        _memoryGovernorHandle->addMiss();
         return false;
     }
     
-    void RasterTileLayer::fetchTile(long long tileId, const MapTile& tile, bool preloadingTile, int priorityDelta) {
-        std::shared_ptr<CancelableThreadPool> tileThreadPool;
-        {
-            std::lock_guard<std::recursive_mutex> lock(_mutex);
-            tileThreadPool = _tileThreadPool;
-        }
-        if (tileThreadPool) {
-            auto task = std::make_shared<FetchTask>(std::static_pointer_cast<RasterTileLayer>(shared_from_this()), tileId, tile, preloadingTile);
-            _fetchingTileTasks.insert(tileId, task);
-            tileThreadPool->execute(task, getUpdatePriority() + priorityDelta);
-        }
+    void RasterTileLayer::fetchTile(long long tileId, const MapTile& tile, bool preloadingTile, int priority, const std::shared_ptr<FetchTileBatch>& tileBatch) {
+        auto task = std::make_shared<FetchTask>(std::static_pointer_cast<RasterTileLayer>(shared_from_this()), tileId, tile, preloadingTile, tileBatch);
+        executeFetchTask(task, priority);
     }
     
     void RasterTileLayer::clearTiles(bool preloadingTiles) {
@@ -199,6 +205,18 @@ namespace carto {
         }
     }
 
+    void RasterTileLayer::invalidateTiles(bool preloadingTiles, const MapBounds& bounds) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        cache::timed_lru_cache<long long, TileInfo>& tileCache = (preloadingTiles ? _preloadingCache : _visibleCache);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (long long tileId : tileCache.keys()) {
+            TileInfo tileInfo;
+            if (tileCache.peek(tileId, tileInfo) && tileBoundsIntersect(tileInfo.getTileBounds(), bounds)) {
+                tileCache.invalidate(tileId, now);
+            }
+        }
+    }
+
     vt::RasterFilterMode RasterTileLayer::getRasterFilterMode() const {
         switch (getTileFilterMode()) {
         case RasterTileFilterMode::RASTER_TILE_FILTER_MODE_NEAREST:
@@ -429,77 +447,55 @@ namespace carto {
         return subBitmap->getResizedBitmap(bitmap->getWidth(), bitmap->getHeight());
     }
 
-    RasterTileLayer::FetchTask::FetchTask(const std::shared_ptr<RasterTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile) :
-        FetchTaskBase(layer, tileId, tile, preloadingTile)
+    RasterTileLayer::FetchTask::FetchTask(const std::shared_ptr<RasterTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch) :
+        FetchTaskBase(layer, tileId, tile, preloadingTile, tileBatch)
     {
     }
     
-    bool RasterTileLayer::FetchTask::loadTile(const std::shared_ptr<TileLayer>& tileLayer) {
+    bool RasterTileLayer::FetchTask::buildTile(const std::shared_ptr<TileLayer>& tileLayer, const MapTile& dataSourceTile, const std::shared_ptr<TileData>& tileData) {
         auto layer = std::static_pointer_cast<RasterTileLayer>(tileLayer);
-    
-        bool refresh = false;
-        for (const MapTile& dataSourceTile : _dataSourceTiles) {
-            if (isCanceled()) {
-                break;
-            }
 
-            std::shared_ptr<TileData> tileData = layer->_dataSource->loadTile(dataSourceTile);
-            if (!tileData) {
-                break;
-            }
-            if (tileData->isReplaceWithParent()) {
-                continue;
-            }
-
-            if (isCanceled()) {
-                break;
-            }
-
-            vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
-            vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
-            std::shared_ptr<Bitmap> bitmap;
-            if (std::shared_ptr<BinaryData> data = tileData->getData()) {
-                bitmap = Bitmap::CreateFromCompressed(data);
-                if (!bitmap && !data->empty()) {
-                    Log::Error("RasterTileLayer::FetchTask: Failed to decode tile");
-                }
+        vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
+        vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
+        std::shared_ptr<Bitmap> bitmap;
+        if (std::shared_ptr<BinaryData> data = tileData->getData()) {
+            bitmap = Bitmap::CreateFromCompressed(data);
+            if (!bitmap && !data->empty()) {
+                Log::Error("RasterTileLayer::FetchTask: Failed to decode tile");
             }
+        }
 
-            // Build vector tile from the bitmap
-            std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
-            std::shared_ptr<vt::Tile> tile;
-            if (bitmap) {
-                tile = layer->createVectorTile(_tile, dataSourceTile, bitmap, tileTransformer);
-            }
+        // Build vector tile from the bitmap
+        std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
+        std::shared_ptr<vt::Tile> tile;
+        if (bitmap) {
+            tile = layer->createVectorTile(_tile, dataSourceTile, bitmap, tileTransformer);
+        }
 
-            // Construct tile info and cache it.
-            TileInfo tileInfo(layer->calculateMapTileBounds(_tile.getFlipped()), tile);
-            {
-                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
-
-                // Store the tile object, unless invalidated or tile transformer has changed.
-                if (!isInvalidated()) {
-                    if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
-                        if (isPreloadingTile()) {
-                            layer->_preloadingCache.put(_tileId, tileInfo, tileInfo.getSize());
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_preloadingCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
-                        } else {
-                            layer->_visibleCache.put(_tileId, tileInfo, tileInfo.getSize());
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_visibleCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
+        // Construct tile info and cache it.
+        TileInfo tileInfo(layer->calculateMapTileBounds(_tile.getFlipped()), tile);
+        {
+            std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+
+            // Store the tile object, unless invalidated or tile transformer has changed.
+            if (!isInvalidated()) {
+                if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
+                    if (isPreloadingTile()) {
+                        layer->_preloadingCache.put(_tileId, tileInfo, tileInfo.getSize());
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_preloadingCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
+                        }
+                    } else {
+                        layer->_visibleCache.put(_tileId, tileInfo, tileInfo.getSize());
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_visibleCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
                         }
                     }
                 }
             }
-
-            refresh = true; // NOTE: need to refresh even when invalidated
-            break;
         }
-        
-        return refresh;
+
+        return true; // NOTE: need to refresh even when invalidated
     }
     
     std::size_t RasterTileLayer::TileInfo::getSize() const {
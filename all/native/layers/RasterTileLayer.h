@@ -12,6 +12,7 @@
 #include "components/DirectorPtr.h"
 #include "components/Task.h"
 #include "layers/TileLayer.h"
+#include "utils/MemoryGovernor.h"
 
 #include <atomic>
 #include <memory>
@@ -115,9 +116,10 @@ namespace carto {
         virtual bool tileExists(long long tileId, bool preloadingCache) const;
         virtual bool tileValid(long long tileId, bool preloadingCache) const;
         virtual bool prefetchTile(long long tileId, bool preloadingTile);
-        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priorityDelta);
+        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priority, const std::shared_ptr<FetchTileBatch>& tileBatch);
         virtual void clearTiles(bool preloadingTiles);
         virtual void invalidateTiles(bool preloadingTiles);
+        virtual void invalidateTiles(bool preloadingTiles, const MapBounds& bounds);
 
         virtual vt::RasterFilterMode getRasterFilterMode() const;
 
@@ -146,10 +148,10 @@ namespace carto {
     private:    
         class FetchTask : public TileLayer::FetchTaskBase {
         public:
-            FetchTask(const std::shared_ptr<RasterTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile);
+            FetchTask(const std::shared_ptr<RasterTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch);
     
         protected:
-            bool loadTile(const std::shared_ptr<TileLayer>& tileLayer);
+            virtual bool buildTile(const std::shared_ptr<TileLayer>& tileLayer, const MapTile& dataSourceTile, const std::shared_ptr<TileData>& tileData);
         };
     
         class TileInfo {
@@ -182,6 +184,8 @@ namespace carto {
         
         cache::timed_lru_cache<long long, TileInfo> _visibleCache;
         cache::timed_lru_cache<long long, TileInfo> _preloadingCache;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
     };
     
 }
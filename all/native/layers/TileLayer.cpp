@@ -2,6 +2,7 @@
 #include "core/BinaryData.h"
 #include "components/Exceptions.h"
 #include "components/CancelableTask.h"
+#include "components/CancelableThreadPool.h"
 #include "datasources/components/TileData.h"
 #include "layers/TileLoadListener.h"
 #include "layers/UTFGridEventListener.h"
@@ -21,6 +22,10 @@
 
 #include <vt/TileTransformer.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace carto {
 
     TileLayer::~TileLayer() {
@@ -157,6 +162,16 @@ namespace carto {
         _utfGridEventListener.set(utfGridEventListener);
     }
     
+    double TileLayer::getTileLoadLatency() const {
+        long long count = _tileLoadCount.load();
+        return count > 0 ? _tileLoadTime.load() / (count * 1000.0) : 0.0;
+    }
+
+    double TileLayer::getTileBuildLatency() const {
+        long long count = _tileBuildCount.load();
+        return count > 0 ? _tileBuildTime.load() / (count * 1000.0) : 0.0;
+    }
+
     bool TileLayer::isUpdateInProgress() const {
         return !_fetchingTileTasks.getAll().empty();
     }
@@ -173,6 +188,14 @@ namespace carto {
             Log::Error("TileLayer::DataSourceListener: Lost connection to layer");
         }
     }
+
+    void TileLayer::DataSourceListener::onTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        if (std::shared_ptr<TileLayer> layer = _layer.lock()) {
+            layer->updateTiles(removeTiles, bounds);
+        } else {
+            Log::Error("TileLayer::DataSourceListener: Lost connection to layer");
+        }
+    }
         
     TileLayer::TileLayer(const std::shared_ptr<TileDataSource>& dataSource) :
         Layer(),
@@ -182,6 +205,10 @@ namespace carto {
         _fetchingTileTasks(),
         _calculatingTiles(false),
         _refreshedTiles(false),
+        _tileLoadTime(0),
+        _tileLoadCount(0),
+        _tileBuildTime(0),
+        _tileBuildCount(0),
         _utfGridDataSource(),
         _tileLoadListener(),
         _utfGridEventListener(),
@@ -213,11 +240,12 @@ namespace carto {
     
     void TileLayer::setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                                   const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                                  const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                                   const std::weak_ptr<Options>& options,
                                   const std::weak_ptr<MapRenderer>& mapRenderer,
                                   const std::weak_ptr<TouchHandler>& touchHandler)
     {
-        Layer::setComponents(envelopeThreadPool, tileThreadPool, options, mapRenderer, touchHandler);
+        Layer::setComponents(envelopeThreadPool, tileThreadPool, tileBuildThreadPool, options, mapRenderer, touchHandler);
         _tileRenderer->setComponents(options, mapRenderer);
 
         // To reduce memory usage, release all the caches now
@@ -292,7 +320,7 @@ namespace carto {
             if (childTileCount.second > 1) {
                 long long tileId = getTileId(childTileCount.first);
                 if (!prefetchTile(tileId, false)) {
-                    fetchTileList.push_back({ childTileCount.first, false, PARENT_PRIORITY_OFFSET });
+                    fetchTileList.push_back({ childTileCount.first, false, PARENT_PRIORITY_OFFSET, 0 });
                 }
             }
         }
@@ -309,8 +337,12 @@ namespace carto {
             return (childTileCountMap[fetchTile1.tile.getParent()] > 1) < (childTileCountMap[fetchTile2.tile.getParent()] > 1);
         });
 
-        // Fetch the tiles
+        // Fetch the tiles. If the data source supports batch loading, consecutive tiles with same priority are grouped into batches, so that they are loaded together.
+        bool batchLoading = _dataSource->isBatchLoadingSupported();
         std::unordered_set<long long> fetchedTiles;
+        std::shared_ptr<FetchTileBatch> tileBatch;
+        FetchTileInfo tileBatchInfo = { MapTile(), false, 0, 0 };
+        int tileBatchSize = 0;
         for (const FetchTileInfo& fetchTileInfo : fetchTileList) {
             long long tileId = getTileId(fetchTileInfo.tile);
             if (fetchedTiles.find(tileId) != fetchedTiles.end()) {
@@ -318,11 +350,13 @@ namespace carto {
             }
             fetchedTiles.insert(tileId);
 
-            // If there is an existing task for this tile, keep it. Otherwise fetch it.
+            // If there is an existing task for this tile, keep it and update its priority. Otherwise fetch it.
+            int priority = calculateFetchPriority(fetchTileInfo);
             bool found = false;
             for (std::shared_ptr<FetchTaskBase> task : _fetchingTileTasks.get(tileId)) {
                 if (!task->isCanceled()) {
                     if (task->isPreloadingTile() == fetchTileInfo.preloading) {
+                        updateFetchPriority(task, priority);
                         found = true;
                         break;
                     }
@@ -330,7 +364,13 @@ namespace carto {
                 }
             }
             if (!found) {
-                fetchTile(getTileId(fetchTileInfo.tile), fetchTileInfo.tile, fetchTileInfo.preloading, fetchTileInfo.priorityDelta);
+                if (batchLoading && (!tileBatch || tileBatchSize >= MAX_FETCH_BATCH_SIZE || tileBatchInfo.priorityDelta != fetchTileInfo.priorityDelta || tileBatchInfo.preloading != fetchTileInfo.preloading)) {
+                    tileBatch = std::make_shared<FetchTileBatch>();
+                    tileBatchInfo = fetchTileInfo;
+                    tileBatchSize = 0;
+                }
+                fetchTile(tileId, fetchTileInfo.tile, fetchTileInfo.preloading, priority, tileBatch);
+                tileBatchSize++;
             }
         }
 
@@ -373,6 +413,33 @@ namespace carto {
         refresh();
     }
 
+    void TileLayer::updateTiles(bool removeTiles, const MapBounds& bounds) {
+        if (removeTiles) {
+            updateTiles(removeTiles);
+            return;
+        }
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+            // Reset cullstate, data extent may have changed
+            _tileCullState.reset();
+
+            // Invalidate tasks of the changed tiles only
+            for (const std::shared_ptr<FetchTaskBase>& task : _fetchingTileTasks.getAll()) {
+                if (tileBoundsIntersect(calculateMapTileBounds(task->getMapTile().getFlipped()), bounds)) {
+                    task->invalidate();
+                    task->cancel();
+                }
+            }
+
+            // Invalidate changed tiles, other tiles stay valid
+            invalidateTiles(false, bounds);
+            invalidateTiles(true, bounds);
+        }
+        refresh();
+    }
+
     void TileLayer::updateTileLoadListener() {
         bool calculatingTiles = _calculatingTiles;
     
@@ -585,7 +652,9 @@ namespace carto {
     }
     
     void TileLayer::buildFetchTiles(const std::vector<MapTile>& visTiles, bool preloadingTiles, std::vector<FetchTileInfo>& fetchTileList) {
-        for (const MapTile& visTile : visTiles) {
+        for (std::size_t i = 0; i < visTiles.size(); i++) {
+            const MapTile& visTile = visTiles[i];
+            int rank = static_cast<int>(i);
             int tileMask = (1 << visTile.getZoom()) - 1;
             MapTile tile(visTile.getX() & tileMask, visTile.getY() & tileMask, visTile.getZoom(), visTile.getFrameNr());
             long long tileId = getTileId(tile);
@@ -596,7 +665,7 @@ namespace carto {
 
                 // Re-fetch invalid tile
                 if (!tileValid(tileId, preloadingTiles) && !tileValid(tileId, !preloadingTiles)) {
-                    fetchTileList.push_back({ tile, preloadingTiles, (preloadingTiles ? PRELOADING_PRIORITY_OFFSET : 0) });
+                    fetchTileList.push_back({ tile, preloadingTiles, (preloadingTiles ? PRELOADING_PRIORITY_OFFSET : 0), rank });
                 }
                 continue;
             }
@@ -642,11 +711,37 @@ namespace carto {
     
             // Prefetch, add the tile to the fetch list
             if (!prefetchTile(tileId, preloadingTiles)) {
-                fetchTileList.push_back({ tile, preloadingTiles, (preloadingTiles ? PRELOADING_PRIORITY_OFFSET : 0) });
+                fetchTileList.push_back({ tile, preloadingTiles, (preloadingTiles ? PRELOADING_PRIORITY_OFFSET : 0), rank });
             }
         }
     }
     
+    int TileLayer::calculateFetchPriority(const FetchTileInfo& fetchTileInfo) const {
+        // Tiles are already sorted by substitution level and distance from the camera, so closer tiles get higher priority within the same priority level
+        // The priority level is clamped, so that the combined priority can not overflow
+        int rank = std::min(fetchTileInfo.rank, MAX_FETCH_PRIORITY_RANK - 1);
+        long long level = static_cast<long long>(getUpdatePriority()) + fetchTileInfo.priorityDelta;
+        level = std::max(std::min(level, static_cast<long long>(std::numeric_limits<int>::max() / MAX_FETCH_PRIORITY_RANK - 1)), static_cast<long long>(std::numeric_limits<int>::min() / MAX_FETCH_PRIORITY_RANK + 1));
+        return static_cast<int>(level) * MAX_FETCH_PRIORITY_RANK + (MAX_FETCH_PRIORITY_RANK - 1 - rank);
+    }
+
+    void TileLayer::updateFetchPriority(const std::shared_ptr<FetchTaskBase>& task, int priority) {
+        if (task->getPriority() == priority) {
+            return;
+        }
+
+        std::shared_ptr<CancelableThreadPool> tileThreadPool;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            tileThreadPool = _tileThreadPool;
+        }
+        if (tileThreadPool) {
+            // Running tasks are not affected, but their build stage will use the updated priority
+            tileThreadPool->reprioritize(task, priority);
+            task->setPriority(priority);
+        }
+    }
+
     bool TileLayer::findParentTile(const MapTile& visTile, const MapTile& tile, int depth, bool preloadingCache, bool preloadingTile) {
         if (tile.getZoom() <= 0 || depth <= 0) {
             return false;
@@ -691,6 +786,21 @@ namespace carto {
         return MapBounds(MapPos(std::min(tilePos0.getX(), tilePos1.getX()), std::min(-tilePos0.getY(), -tilePos1.getY())), MapPos(std::max(tilePos0.getX(), tilePos1.getX()), std::max(-tilePos0.getY(), -tilePos1.getY())));
     }
 
+    bool TileLayer::tileBoundsIntersect(const MapBounds& tileBounds, const MapBounds& bounds) const {
+        // Tiles of other frames are shifted by the width of the world, move the bounds back to the first frame
+        MapBounds projBounds = _dataSource->getProjection()->getBounds();
+        double worldWidth = projBounds.getDelta().getX();
+        double offsetX = 0;
+        if (worldWidth > 0) {
+            offsetX = std::floor((tileBounds.getCenter().getX() - projBounds.getMin().getX()) / worldWidth) * worldWidth;
+        }
+
+        // Expand the bounds by the tile buffer, features just outside of the tile may still be drawn in it
+        MapVec buffer = tileBounds.getDelta() * CHANGED_TILE_BUFFER;
+        MapBounds bufferedBounds(MapPos(tileBounds.getMin().getX() - offsetX - buffer.getX(), tileBounds.getMin().getY() - buffer.getY()), MapPos(tileBounds.getMax().getX() - offsetX + buffer.getX(), tileBounds.getMax().getY() + buffer.getY()));
+        return bufferedBounds.intersects(bounds);
+    }
+
     std::shared_ptr<vt::TileTransformer> TileLayer::getTileTransformer() const {
         return _tileRenderer->getTileTransformer();
     }
@@ -708,13 +818,96 @@ namespace carto {
         _tileRenderer->setTileTransformer(tileTransformer);
     }
 
-    TileLayer::FetchTaskBase::FetchTaskBase(const std::shared_ptr<TileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile) :
+    void TileLayer::executeFetchTask(const std::shared_ptr<FetchTaskBase>& task, int priority) {
+        std::shared_ptr<CancelableThreadPool> tileThreadPool;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            tileThreadPool = _tileThreadPool;
+        }
+        if (tileThreadPool) {
+            task->setPriority(priority);
+            _fetchingTileTasks.insert(task->getTileId(), task);
+            tileThreadPool->execute(task, priority);
+        }
+    }
+
+    TileLayer::FetchTileBatch::FetchTileBatch() :
+        _pendingTiles(),
+        _loadingTiles(),
+        _loadedTiles(),
+        _condition(),
+        _mutex()
+    {
+    }
+
+    void TileLayer::FetchTileBatch::addTile(const MapTile& tile) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pendingTiles.push_back(tile);
+    }
+
+    void TileLayer::FetchTileBatch::removeTile(const MapTile& tile) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pendingTiles.erase(std::remove(_pendingTiles.begin(), _pendingTiles.end(), tile), _pendingTiles.end());
+        _loadedTiles.erase(tile);
+    }
+
+    bool TileLayer::FetchTileBatch::loadTile(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& tile, std::shared_ptr<TileData>& tileData) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        // If the tile is pending, load all pending tiles of the batch with a single request. Loading is done without holding the lock.
+        if (std::find(_pendingTiles.begin(), _pendingTiles.end(), tile) != _pendingTiles.end()) {
+            std::vector<MapTile> tiles;
+            std::swap(tiles, _pendingTiles);
+            _loadingTiles.insert(_loadingTiles.end(), tiles.begin(), tiles.end());
+            lock.unlock();
+
+            std::vector<std::shared_ptr<TileData> > tileDatas;
+            try {
+                tileDatas = dataSource->loadTiles(tiles);
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("TileLayer::FetchTileBatch: Exception while loading tiles: %s", ex.what());
+            }
+
+            lock.lock();
+            for (std::size_t i = 0; i < tiles.size(); i++) {
+                if (i < tileDatas.size()) {
+                    _loadedTiles[tiles[i]] = tileDatas[i];
+                }
+                _loadingTiles.erase(std::find(_loadingTiles.begin(), _loadingTiles.end(), tiles[i]));
+            }
+            _condition.notify_all();
+        }
+
+        // If the tile is being loaded by another task, wait for it
+        while (std::find(_loadingTiles.begin(), _loadingTiles.end(), tile) != _loadingTiles.end()) {
+            _condition.wait(lock);
+        }
+
+        // Each result is consumed only once, to release the memory as soon as possible. Missing results are loaded separately by the caller.
+        auto it = _loadedTiles.find(tile);
+        if (it == _loadedTiles.end()) {
+            return false;
+        }
+        tileData = it->second;
+        _loadedTiles.erase(it);
+        return true;
+    }
+
+    TileLayer::FetchTaskBase::FetchTaskBase(const std::shared_ptr<TileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch) :
         _layer(layer),
         _tileId(tileId),
         _tile(tile),
         _preloadingTile(preloadingTile),
         _dataSourceTiles(),
+        _tileBatch(),
+        _loadedTile(),
+        _loadedTileData(),
+        _loadQueueTime(std::chrono::steady_clock::now()),
+        _buildQueueTime(),
         _started(false),
+        _priority(0),
+        _finished(false),
         _invalidated(false)
     {
         for (MapTile dataSourceTile = tile; true; ) {
@@ -727,6 +920,12 @@ namespace carto {
             }
             dataSourceTile = dataSourceTile.getParent();
         }
+
+        // Only the first datasource tile is loaded as part of the batch, parent tiles are loaded separately if needed
+        if (tileBatch && !_dataSourceTiles.empty()) {
+            _tileBatch = tileBatch;
+            _tileBatch->addTile(_dataSourceTiles.front());
+        }
     }
 
     long long TileLayer::FetchTaskBase::getTileId() const {
@@ -741,6 +940,14 @@ namespace carto {
         return _preloadingTile;
     }
     
+    int TileLayer::FetchTaskBase::getPriority() const {
+        return _priority.load();
+    }
+
+    void TileLayer::FetchTaskBase::setPriority(int priority) {
+        _priority.store(priority);
+    }
+
     bool TileLayer::FetchTaskBase::isInvalidated() const {
         return _invalidated.load();
     }
@@ -766,6 +973,9 @@ namespace carto {
         }
 
         if (cancel) {
+            if (_tileBatch) {
+                _tileBatch->removeTile(_dataSourceTiles.front());
+            }
             layer->_fetchingTileTasks.remove(_tileId, std::static_pointer_cast<FetchTaskBase>(shared_from_this()));
         }
     }
@@ -785,27 +995,73 @@ namespace carto {
             _started = true;
         }
 
-        bool refresh = false;
+        // Load the tile data in the tile thread pool, decoding and building is done in the build thread pool
+        bool loaded = false;
         try {
-            refresh = loadTile(layer) && !_preloadingTile;
-            if (refresh) {
+            loaded = loadTileData(layer);
+            if (loaded && !_preloadingTile) {
                 loadUTFGridTile(layer);
             }
         }
         catch (const std::exception& ex) {
             Log::Errorf("TileLayer::FetchTaskBase: Exception while loading tile: %s", ex.what());
         }
+
+        auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _loadQueueTime);
+        layer->_tileLoadTime += loadTime.count();
+        layer->_tileLoadCount++;
+
+        if (!loaded || isCanceled()) {
+            finishTile(layer, false);
+            return;
+        }
+
+        std::shared_ptr<CancelableThreadPool> tileBuildThreadPool;
+        {
+            std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+            tileBuildThreadPool = layer->_tileBuildThreadPool;
+        }
+        if (!tileBuildThreadPool) {
+            finishTile(layer, false);
+            return;
+        }
+
+        _buildQueueTime = std::chrono::steady_clock::now();
+        auto task = std::make_shared<BuildTask>(std::static_pointer_cast<FetchTaskBase>(shared_from_this()));
+        tileBuildThreadPool->execute(task, _priority.load());
+    }
     
-        layer->_fetchingTileTasks.remove(_tileId, std::static_pointer_cast<FetchTaskBase>(shared_from_this()));
+    std::shared_ptr<TileData> TileLayer::FetchTaskBase::loadDataSourceTile(const std::shared_ptr<TileLayer>& layer, const MapTile& dataSourceTile) {
+        std::shared_ptr<TileData> tileData;
+        if (_tileBatch) {
+            if (_tileBatch->loadTile(layer->_dataSource.get(), dataSourceTile, tileData)) {
+                return tileData;
+            }
+        }
+        return layer->_dataSource->loadTile(dataSourceTile);
+    }
 
-        if (refresh) {
-            if (auto mapRenderer = layer->getMapRenderer()) {
-                mapRenderer->layerChanged(layer->shared_from_this(), false);
-                mapRenderer->requestRedraw();
+    bool TileLayer::FetchTaskBase::loadTileData(const std::shared_ptr<TileLayer>& layer) {
+        for (const MapTile& dataSourceTile : _dataSourceTiles) {
+            if (isCanceled()) {
+                break;
             }
+
+            std::shared_ptr<TileData> tileData = loadDataSourceTile(layer, dataSourceTile);
+            if (!tileData) {
+                break;
+            }
+            if (tileData->isReplaceWithParent()) {
+                continue;
+            }
+
+            _loadedTile = dataSourceTile;
+            _loadedTileData = tileData;
+            return true;
         }
+        return false;
     }
-    
+
     bool TileLayer::FetchTaskBase::loadUTFGridTile(const std::shared_ptr<TileLayer>& tileLayer) {
         DirectorPtr<TileDataSource> dataSource = tileLayer->_utfGridDataSource;
 
@@ -849,14 +1105,79 @@ namespace carto {
         return refresh;
     }
 
+    void TileLayer::FetchTaskBase::buildTileData(const std::shared_ptr<TileLayer>& layer) {
+        bool refresh = false;
+        if (!isCanceled()) {
+            try {
+                refresh = buildTile(layer, _loadedTile, _loadedTileData) && !_preloadingTile;
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("TileLayer::FetchTaskBase: Exception while building tile: %s", ex.what());
+            }
+
+            auto buildTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _buildQueueTime);
+            layer->_tileBuildTime += buildTime.count();
+            layer->_tileBuildCount++;
+        }
+        _loadedTileData.reset();
+
+        finishTile(layer, refresh);
+    }
+
+    void TileLayer::FetchTaskBase::finishTile(const std::shared_ptr<TileLayer>& layer, bool refresh) {
+        if (_finished.exchange(true)) {
+            return;
+        }
+
+        layer->_fetchingTileTasks.remove(_tileId, std::static_pointer_cast<FetchTaskBase>(shared_from_this()));
+
+        if (refresh) {
+            if (auto mapRenderer = layer->getMapRenderer()) {
+                mapRenderer->layerChanged(layer->shared_from_this(), false);
+                mapRenderer->requestRedraw();
+            }
+        }
+    }
+
+    TileLayer::FetchTaskBase::BuildTask::BuildTask(const std::shared_ptr<FetchTaskBase>& fetchTask) :
+        _fetchTask(fetchTask)
+    {
+    }
+
+    void TileLayer::FetchTaskBase::BuildTask::cancel() {
+        CancelableTask::cancel();
+
+        if (std::shared_ptr<TileLayer> layer = _fetchTask->_layer.lock()) {
+            _fetchTask->finishTile(layer, false);
+        }
+    }
+
+    void TileLayer::FetchTaskBase::BuildTask::run() {
+        std::shared_ptr<TileLayer> layer = _fetchTask->_layer.lock();
+        if (!layer) {
+            Log::Info("TileLayer::FetchTaskBase::BuildTask: Lost connection to layer");
+            return;
+        }
+
+        if (isCanceled()) {
+            return;
+        }
+
+        _fetchTask->buildTileData(layer);
+    }
+
     const float TileLayer::DISCRETE_ZOOM_LEVEL_BIAS = 0.001f;
 
     const int TileLayer::MAX_PARENT_SEARCH_DEPTH = 6;
     const int TileLayer::MAX_CHILD_SEARCH_DEPTH = 3;
 
+    const int TileLayer::MAX_FETCH_BATCH_SIZE = 16;
+
+    const int TileLayer::MAX_FETCH_PRIORITY_RANK = 1024;
     const int TileLayer::PARENT_PRIORITY_OFFSET = 1;
     const int TileLayer::PRELOADING_PRIORITY_OFFSET = -2;
     const double TileLayer::PRELOADING_TILE_SCALE = 1.5;
     const float TileLayer::SUBDIVISION_THRESHOLD = Const::WORLD_SIZE;
+    const double TileLayer::CHANGED_TILE_BUFFER = 0.125;
     
 }
@@ -16,11 +16,14 @@
 #include "layers/Layer.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <unordered_map>
 
 namespace carto {
     class CancelableTask;
+    class CancelableThreadPool;
     class CullState;
     class GLResourceManager;
     class ProjectionSurface;
@@ -217,6 +220,19 @@ namespace carto {
          * @param utfGridEventListener The UTF grid event listener.
          */
         void setUTFGridEventListener(const std::shared_ptr<UTFGridEventListener>& utfGridEventListener);
+
+        /**
+         * Returns the average latency of the tile loading stage. This includes the time spent waiting
+         * in the tile loading queue and loading the tile data from the data source.
+         * @return The average latency of the tile loading stage in milliseconds.
+         */
+        double getTileLoadLatency() const;
+        /**
+         * Returns the average latency of the tile building stage. This includes the time spent waiting
+         * in the tile building queue, decoding the tile data and building the tile.
+         * @return The average latency of the tile building stage in milliseconds.
+         */
+        double getTileBuildLatency() const;
     
         virtual bool isUpdateInProgress() const;
         
@@ -226,19 +242,40 @@ namespace carto {
             explicit DataSourceListener(const std::shared_ptr<TileLayer>& layer);
             
             virtual void onTilesChanged(bool removeTiles);
+            virtual void onTilesChanged(bool removeTiles, const MapBounds& bounds);
             
         private:
             std::weak_ptr<TileLayer> _layer;
         };
         
+        class FetchTileBatch {
+        public:
+            FetchTileBatch();
+
+            void addTile(const MapTile& tile);
+            void removeTile(const MapTile& tile);
+
+            bool loadTile(const std::shared_ptr<TileDataSource>& dataSource, const MapTile& tile, std::shared_ptr<TileData>& tileData);
+
+        private:
+            std::vector<MapTile> _pendingTiles;
+            std::vector<MapTile> _loadingTiles;
+            std::unordered_map<MapTile, std::shared_ptr<TileData> > _loadedTiles;
+            std::condition_variable _condition;
+            mutable std::mutex _mutex;
+        };
+
         class FetchTaskBase : public CancelableTask {
         public:
-            FetchTaskBase(const std::shared_ptr<TileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile);
+            FetchTaskBase(const std::shared_ptr<TileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch);
             
             long long getTileId() const;
             MapTile getMapTile() const;
             bool isPreloadingTile() const;
 
+            int getPriority() const;
+            void setPriority(int priority);
+
             bool isInvalidated() const;
             void invalidate();
 
@@ -246,18 +283,42 @@ namespace carto {
             virtual void run();
             
         protected:
-            virtual bool loadTile(const std::shared_ptr<TileLayer>& layer) = 0;
+            virtual bool buildTile(const std::shared_ptr<TileLayer>& layer, const MapTile& dataSourceTile, const std::shared_ptr<TileData>& tileData) = 0;
+
+            std::shared_ptr<TileData> loadDataSourceTile(const std::shared_ptr<TileLayer>& layer, const MapTile& dataSourceTile);
             
             std::weak_ptr<TileLayer> _layer;
             long long _tileId;
             MapTile _tile; // original tile
             bool _preloadingTile;
             std::vector<MapTile> _dataSourceTiles; // tiles in valid datasource range, ordered to top
+            std::shared_ptr<FetchTileBatch> _tileBatch;
 
         private:
+            class BuildTask : public CancelableTask {
+            public:
+                explicit BuildTask(const std::shared_ptr<FetchTaskBase>& fetchTask);
+
+                virtual void cancel();
+                virtual void run();
+
+            private:
+                std::shared_ptr<FetchTaskBase> _fetchTask;
+            };
+
+            bool loadTileData(const std::shared_ptr<TileLayer>& layer);
             bool loadUTFGridTile(const std::shared_ptr<TileLayer>& layer);
+            void buildTileData(const std::shared_ptr<TileLayer>& layer);
+            void finishTile(const std::shared_ptr<TileLayer>& layer, bool refresh);
+
+            MapTile _loadedTile; // datasource tile of the loaded data
+            std::shared_ptr<TileData> _loadedTileData;
+            std::chrono::steady_clock::time_point _loadQueueTime;
+            std::chrono::steady_clock::time_point _buildQueueTime;
 
             bool _started;
+            std::atomic<int> _priority;
+            std::atomic<bool> _finished;
             std::atomic<bool> _invalidated;
         };
         
@@ -337,6 +398,7 @@ namespace carto {
 
         virtual void setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                                    const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                                   const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                                    const std::weak_ptr<Options>& options,
                                    const std::weak_ptr<MapRenderer>& mapRenderer,
                                    const std::weak_ptr<TouchHandler>& touchHandler);
@@ -344,6 +406,7 @@ namespace carto {
         virtual void loadData(const std::shared_ptr<CullState>& cullState);
 
         virtual void updateTiles(bool removeTiles);
+        virtual void updateTiles(bool removeTiles, const MapBounds& bounds);
 
         virtual void updateTileLoadListener();
 
@@ -351,9 +414,10 @@ namespace carto {
         virtual bool tileExists(long long tileId, bool preloadingCache) const = 0;
         virtual bool tileValid(long long tileId, bool preloadingCache) const = 0;
         virtual bool prefetchTile(long long tileId, bool preloadingTile) = 0;
-        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priorityDelta) = 0;
+        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priority, const std::shared_ptr<FetchTileBatch>& tileBatch) = 0;
         virtual void clearTiles(bool preloadingTiles) = 0;
         virtual void invalidateTiles(bool preloadingTiles) = 0;
+        virtual void invalidateTiles(bool preloadingTiles, const MapBounds& bounds) = 0;
 
         virtual void calculateDrawData(const MapTile& visTile, const MapTile& closestTile, bool preloadingTile) = 0;
         virtual void refreshDrawData(const std::shared_ptr<CullState>& cullState, bool tilesChanged) = 0;
@@ -366,10 +430,13 @@ namespace carto {
         virtual bool processClick(const ClickInfo& clickInfo, const RayIntersectedElement& intersectedElement, const ViewState& viewState) const;
 
         MapBounds calculateInternalTileBounds(const MapTile& mapTile) const;
+        bool tileBoundsIntersect(const MapBounds& tileBounds, const MapBounds& bounds) const;
 
         std::shared_ptr<vt::TileTransformer> getTileTransformer() const;
         void resetTileTransformer();
 
+        void executeFetchTask(const std::shared_ptr<FetchTaskBase>& task, int priority);
+
         const DirectorPtr<TileDataSource> _dataSource;
         std::shared_ptr<DataSourceListener> _dataSourceListener;
 
@@ -382,6 +449,7 @@ namespace carto {
             MapTile tile;
             bool preloading;
             int priorityDelta;
+            int rank; // index of the tile in the sorted tile list
         };
 
         void calculateVisibleTiles(const std::shared_ptr<CullState>& cullState);
@@ -390,6 +458,9 @@ namespace carto {
         void sortTiles(std::vector<MapTile>& tiles, const ViewState& viewState, bool preloadingTiles);
         void buildFetchTiles(const std::vector<MapTile>& visTiles, bool preloadingTiles, std::vector<FetchTileInfo>& fetchTileList);
 
+        int calculateFetchPriority(const FetchTileInfo& fetchTileInfo) const;
+        void updateFetchPriority(const std::shared_ptr<FetchTaskBase>& task, int priority);
+
         bool findParentTile(const MapTile& visTile, const MapTile& tile, int depth, bool preloadingCache, bool preloadingTile);
         int findChildTiles(const MapTile& visTile, const MapTile& tile, int depth, bool preloadingCache, bool preloadingTile);
 
@@ -398,13 +469,22 @@ namespace carto {
         static const int MAX_PARENT_SEARCH_DEPTH;
         static const int MAX_CHILD_SEARCH_DEPTH;
 
+        static const int MAX_FETCH_BATCH_SIZE;
+
+        static const int MAX_FETCH_PRIORITY_RANK;
         static const int PARENT_PRIORITY_OFFSET;
         static const int PRELOADING_PRIORITY_OFFSET;
         static const double PRELOADING_TILE_SCALE;
         static const float SUBDIVISION_THRESHOLD;
+        static const double CHANGED_TILE_BUFFER;
         
         std::atomic<bool> _calculatingTiles;
         std::atomic<bool> _refreshedTiles;
+
+        std::atomic<long long> _tileLoadTime; // total time of the loading stage in microseconds
+        std::atomic<long long> _tileLoadCount;
+        std::atomic<long long> _tileBuildTime; // total time of the building stage in microseconds
+        std::atomic<long long> _tileBuildCount;
         
         ThreadSafeDirectorPtr<TileDataSource> _utfGridDataSource;
         
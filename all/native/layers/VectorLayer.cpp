@@ -89,11 +89,12 @@ namespace carto {
     
     void VectorLayer::setComponents(const std::shared_ptr<CancelableThreadPool>& envelopeThreadPool,
                                     const std::shared_ptr<CancelableThreadPool>& tileThreadPool,
+                                    const std::shared_ptr<CancelableThreadPool>& tileBuildThreadPool,
                                     const std::weak_ptr<Options>& options,
                                     const std::weak_ptr<MapRenderer>& mapRenderer,
                                     const std::weak_ptr<TouchHandler>& touchHandler)
     {
-        Layer::setComponents(envelopeThreadPool, tileThreadPool, options, mapRenderer, touchHandler);
+        Layer::setComponents(envelopeThreadPool, tileThreadPool, tileBuildThreadPool, options, mapRenderer, touchHandler);
         _billboardRenderer->setComponents(std::static_pointer_cast<VectorLayer>(shared_from_this()), options, mapRenderer);
         _geometryCollectionRenderer->setComponents(options, mapRenderer);
         _lineRenderer->setComponents(options, mapRenderer);
@@ -566,13 +567,35 @@ namespace carto {
     }
     
     bool VectorLayer::FetchTask::loadElements(const std::shared_ptr<VectorLayer>& layer, const std::shared_ptr<CullState>& cullState) {
-        std::shared_ptr<VectorData> vectorData = layer->_dataSource->loadElements(cullState);
+        const ViewState& viewState = cullState->getViewState();
+
+        // Partial results are added to the existing renderer elements, the final result replaces them
+        std::shared_ptr<VectorData> vectorData = layer->_dataSource->streamElements(cullState, [this, &layer, &viewState](const std::vector<std::shared_ptr<VectorElement> >& elements) {
+            bool billboardsChanged = false;
+            {
+                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+                if (isCanceled()) {
+                    return false;
+                }
+                for (const std::shared_ptr<VectorElement>& element : elements) {
+                    if (layer->syncRendererElement(element, viewState, false)) {
+                        billboardsChanged = true;
+                    }
+                }
+            }
+
+            if (auto mapRenderer = layer->getMapRenderer()) {
+                if (billboardsChanged) {
+                    mapRenderer->billboardsChanged();
+                }
+                mapRenderer->requestRedraw();
+            }
+            return true;
+        });
         if (!vectorData) {
             return false;
         }
 
-        const ViewState& viewState = cullState->getViewState();
-
         std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
         for (const std::shared_ptr<VectorElement>& element : vectorData->getElements()) {
             layer->addRendererElement(element, viewState);
@@ -7,6 +7,7 @@
 #include "graphics/utils/SkyBitmapGenerator.h"
 #include "datasources/TileDataSource.h"
 #include "layers/VectorTileEventListener.h"
+#include "layers/components/DecodedTileCache.h"
 #include "projections/Projection.h"
 #include "projections/ProjectionSurface.h"
 #include "renderers/MapRenderer.h"
@@ -68,7 +69,8 @@ namespace carto {
         _visibleTileIds(),
         _tempDrawDatas(),
         _visibleCache(DEFAULT_VISIBLE_CACHE_SIZE),
-        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE)
+        _preloadingCache(DEFAULT_PRELOADING_CACHE_SIZE),
+        _memoryGovernorHandle()
     {
         if (!decoder) {
             throw NullArgumentException("Null decoder");
@@ -91,9 +93,21 @@ namespace carto {
         if (auto clickHandlerLayerFilter = readDecoderParameter<std::string>(decoder, "_clickhandlerlayerfilter")) {
             setClickHandlerLayerFilter(*clickHandlerLayerFilter);
         }
+
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("VectorTileLayer", MemoryTrimLevel::MEMORY_TRIM_LEVEL_LOW, DEFAULT_PRELOADING_CACHE_SIZE,
+            [this](std::size_t capacityInBytes) {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _preloadingCache.resize(capacityInBytes);
+            },
+            [this]() {
+                std::lock_guard<std::recursive_mutex> lock(_mutex);
+                _preloadingCache.clear();
+            }
+        );
     }
     
     VectorTileLayer::~VectorTileLayer() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
     }
     
     std::shared_ptr<VectorTileDecoder> VectorTileLayer::getTileDecoder() const {
@@ -101,13 +115,12 @@ namespace carto {
     }
     
     std::size_t VectorTileLayer::getTileCacheCapacity() const {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        return _preloadingCache.capacity();
+        return _memoryGovernorHandle->getCapacity();
     }
     
     void VectorTileLayer::setTileCacheCapacity(std::size_t capacityInBytes) {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        _preloadingCache.resize(capacityInBytes);
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
     }
     
     VectorTileRenderOrder::VectorTileRenderOrder VectorTileLayer::getLabelRenderOrder() const {
@@ -242,26 +255,34 @@ namespace carto {
             } else {
                 _preloadingCache.get(tileId);
             }
+            _memoryGovernorHandle->addHit();
             return true;
         }
         if (_visibleCache.exists(tileId) && _visibleCache.valid(tileId)) {
             _visibleCache.get(tileId); // do not move to preloading, it will be moved at later stage
             return true;
         }
+
+        // Check if the tile is already decoded by another layer with the same data source and style. Original data is required if interactivity is enabled.
+        DecodedTileCache::Tile sharedTile;
+        if (DecodedTileCache::GetInstance().get(getDataSource(), _tileDecoder->getStyleHash(), getTileTransformer(), tileId, sharedTile)) {
+            if (sharedTile.tileData || !_vectorTileEventListener.get()) {
+                TileInfo tileInfo(sharedTile.tileBounds, sharedTile.tileData, sharedTile.tileMap);
+                cache::timed_lru_cache<long long, TileInfo>& tileCache = (preloadingTile ? _preloadingCache : _visibleCache);
+                tileCache.put(tileId, tileInfo, tileInfo.getSize());
+                if (sharedTile.maxAge >= 0) {
+                    tileCache.invalidate(tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(sharedTile.maxAge));
+                }
+                return true;
+            }
+        }
+        _memoryGovernorHandle->addMiss();
         return false;
     }
     
-    void VectorTileLayer::fetchTile(long long tileId, const MapTile& tile, bool preloadingTile, int priorityDelta) {
-        std::shared_ptr<CancelableThreadPool> tileThreadPool;
-        {
-            std::lock_guard<std::recursive_mutex> lock(_mutex);
-            tileThreadPool = _tileThreadPool;
-        }
-        if (tileThreadPool) {
-            auto task = std::make_shared<FetchTask>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()), tileId, MapTile(tile.getX(), tile.getY(), tile.getZoom(), 0), preloadingTile);
-            _fetchingTileTasks.insert(tileId, task);
-            tileThreadPool->execute(task, getUpdatePriority() + priorityDelta);
-        }
+    void VectorTileLayer::fetchTile(long long tileId, const MapTile& tile, bool preloadingTile, int priority, const std::shared_ptr<FetchTileBatch>& tileBatch) {
+        auto task = std::make_shared<FetchTask>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()), tileId, MapTile(tile.getX(), tile.getY(), tile.getZoom(), 0), preloadingTile, tileBatch);
+        executeFetchTask(task, priority);
     }
 
     void VectorTileLayer::clearTiles(bool preloadingTiles) {
@@ -282,6 +303,18 @@ namespace carto {
         }
     }
 
+    void VectorTileLayer::invalidateTiles(bool preloadingTiles, const MapBounds& bounds) {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        cache::timed_lru_cache<long long, TileInfo>& tileCache = (preloadingTiles ? _preloadingCache : _visibleCache);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (long long tileId : tileCache.keys()) {
+            TileInfo tileInfo;
+            if (tileCache.peek(tileId, tileInfo) && tileBoundsIntersect(tileInfo.getTileBounds(), bounds)) {
+                tileCache.invalidate(tileId, now);
+            }
+        }
+    }
+
     std::shared_ptr<VectorTileDecoder::TileMap> VectorTileLayer::getTileMap(long long tileId) const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
         TileInfo tileInfo;
@@ -545,6 +578,9 @@ namespace carto {
     void VectorTileLayer::registerDataSourceListener() {
         _tileDecoderListener = std::make_shared<TileDecoderListener>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()));
         _tileDecoder->registerOnChangeListener(_tileDecoderListener);
+
+        // The shared cache must drop changed tiles before the layer reloads them, so it is registered first
+        DecodedTileCache::GetInstance().registerDataSource(getDataSource());
     
         _dataSourceListener = std::make_shared<DataSourceListener>(std::static_pointer_cast<VectorTileLayer>(shared_from_this()));
         _dataSource->registerOnChangeListener(_dataSourceListener);
@@ -587,79 +623,67 @@ namespace carto {
         }
     }
     
-    VectorTileLayer::FetchTask::FetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile) :
-        FetchTaskBase(layer, tileId, tile, preloadingTile)
+    VectorTileLayer::FetchTask::FetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch) :
+        FetchTaskBase(layer, tileId, tile, preloadingTile, tileBatch),
+        _sharedCacheGeneration(DecodedTileCache::GetInstance().getGeneration())
     {
     }
     
-    bool VectorTileLayer::FetchTask::loadTile(const std::shared_ptr<TileLayer>& tileLayer) {
+    bool VectorTileLayer::FetchTask::buildTile(const std::shared_ptr<TileLayer>& tileLayer, const MapTile& dataSourceTile, const std::shared_ptr<TileData>& tileData) {
         auto layer = std::static_pointer_cast<VectorTileLayer>(tileLayer);
-        
-        bool refresh = false;
-        for (const MapTile& dataSourceTile : _dataSourceTiles) {
-            if (isCanceled()) {
-                break;
-            }
 
-            std::shared_ptr<TileData> tileData = layer->_dataSource->loadTile(dataSourceTile);
-            if (!tileData) {
-                break;
-            }
-            if (tileData->isReplaceWithParent()) {
-                continue;
-            }
-
-            if (isCanceled()) {
-                break;
-            }
-
-            // Decode vector tile.
-            vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
-            vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
-            std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
-            std::shared_ptr<VectorTileDecoder::TileMap> tileMap;
-            if (std::shared_ptr<BinaryData> data = tileData->getData()) {
-                tileMap = layer->_tileDecoder->decodeTile(vtDataSourceTile, vtTile, tileTransformer, data);
-                if (!tileMap && !data->empty()) {
-                    Log::Error("VectorTileLayer::FetchTask: Failed to decode tile");
-                }
+        // Decode vector tile.
+        vt::TileId vtTile(_tile.getZoom(), _tile.getX(), _tile.getY());
+        vt::TileId vtDataSourceTile(dataSourceTile.getZoom(), dataSourceTile.getX(), dataSourceTile.getY());
+        std::shared_ptr<vt::TileTransformer> tileTransformer = layer->getTileTransformer();
+        std::size_t styleHash = layer->_tileDecoder->getStyleHash();
+        std::shared_ptr<VectorTileDecoder::TileMap> tileMap;
+        if (std::shared_ptr<BinaryData> data = tileData->getData()) {
+            tileMap = layer->_tileDecoder->decodeTile(vtDataSourceTile, vtTile, tileTransformer, data);
+            if (!tileMap && !data->empty()) {
+                Log::Error("VectorTileLayer::FetchTask: Failed to decode tile");
             }
+        }
 
-            // Construct tile info - keep original data if interactivity is required
-            VectorTileLayer::TileInfo tileInfo(layer->calculateMapTileBounds(dataSourceTile.getFlipped()), layer->_vectorTileEventListener.get() ? tileData->getData() : std::shared_ptr<BinaryData>(), tileMap);
-            {
-                std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
-
-                // Store the decoded tile in cache, unless invalidated.
-                if (!isInvalidated()) {
-                    if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
-                        if (isPreloadingTile()) {
-                            layer->_preloadingCache.put(_tileId, tileInfo, tileInfo.getSize());
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_preloadingCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
-                        } else {
-                            layer->_visibleCache.put(_tileId, tileInfo, tileInfo.getSize());
-                            if (tileData->getMaxAge() >= 0) {
-                                layer->_visibleCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
-                            }
+        // Construct tile info - keep original data if interactivity is required
+        VectorTileLayer::TileInfo tileInfo(layer->calculateMapTileBounds(dataSourceTile.getFlipped()), layer->_vectorTileEventListener.get() ? tileData->getData() : std::shared_ptr<BinaryData>(), tileMap);
+        bool sharedTile = false;
+        {
+            std::lock_guard<std::recursive_mutex> lock(layer->_mutex);
+
+            // Store the decoded tile in cache, unless invalidated.
+            if (!isInvalidated()) {
+                if (layer->getTileTransformer() == tileTransformer) { // extra check that the tile is created with correct transformer. Otherwise simply drop it.
+                    if (isPreloadingTile()) {
+                        layer->_preloadingCache.put(_tileId, tileInfo, tileInfo.getSize());
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_preloadingCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
+                        }
+                    } else {
+                        layer->_visibleCache.put(_tileId, tileInfo, tileInfo.getSize());
+                        if (tileData->getMaxAge() >= 0) {
+                            layer->_visibleCache.invalidate(_tileId, std::chrono::steady_clock::now() + std::chrono::milliseconds(tileData->getMaxAge()));
                         }
                     }
+                    sharedTile = (tileMap ? true : false);
                 }
             }
-            
-            // Debug tile performance issues
-            if (Log::IsShowDebug()) {
-                if (tileInfo.getMaxDrawCallCount() >= 20) {
-                    Log::Debugf("VectorTileLayer::FetchTask: Tile requires %d draw calls", tileInfo.getMaxDrawCallCount());
-                }
-            }
-                
-            refresh = true; // NOTE: need to refresh even when invalidated
-            break;
+        }
+
+        // Share the decoded tile with other layers using the same data source and style
+        if (sharedTile) {
+            DecodedTileCache::Tile tile { tileInfo.getTileBounds(), tileInfo.getTileData(), tileMap, tileData->getMaxAge() };
+            DecodedTileCache::GetInstance().put(layer->getDataSource(), styleHash, tileTransformer, _tileId, _sharedCacheGeneration, tile, tileInfo.getSize());
         }
         
-        return refresh;
+        // Debug tile performance issues
+        if (Log::IsShowDebug()) {
+            if (tileInfo.getMaxDrawCallCount() >= 20) {
+                Log::Debugf("VectorTileLayer::FetchTask: Tile requires %d draw calls", tileInfo.getMaxDrawCallCount());
+            }
+        }
+
+        return true; // NOTE: need to refresh even when invalidated
     }
 
     int VectorTileLayer::TileInfo::getMaxDrawCallCount() const {
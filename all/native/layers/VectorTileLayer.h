@@ -13,6 +13,7 @@
 #include "components/DirectorPtr.h"
 #include "components/Task.h"
 #include "layers/TileLayer.h"
+#include "utils/MemoryGovernor.h"
 #include "vectortiles/VectorTileDecoder.h"
 
 #include <atomic>
@@ -187,9 +188,10 @@ namespace carto {
         virtual bool tileExists(long long tileId, bool preloadingCache) const;
         virtual bool tileValid(long long tileId, bool preloadingCache) const;
         virtual bool prefetchTile(long long tileId, bool preloadingTile);
-        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priorityDelta);
+        virtual void fetchTile(long long tileId, const MapTile& mapTile, bool preloadingTile, int priority, const std::shared_ptr<FetchTileBatch>& tileBatch);
         virtual void clearTiles(bool preloadingTiles);
         virtual void invalidateTiles(bool preloadingTiles);
+        virtual void invalidateTiles(bool preloadingTiles, const MapBounds& bounds);
 
         virtual std::shared_ptr<VectorTileDecoder::TileMap> getTileMap(long long tileId) const;
         virtual std::shared_ptr<vt::Tile> getPoleTile(int y) const;
@@ -233,10 +235,13 @@ namespace carto {
     
         class FetchTask : public TileLayer::FetchTaskBase {
         public:
-            FetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile);
+            FetchTask(const std::shared_ptr<VectorTileLayer>& layer, long long tileId, const MapTile& tile, bool preloadingTile, const std::shared_ptr<FetchTileBatch>& tileBatch);
             
         protected:
-            virtual bool loadTile(const std::shared_ptr<TileLayer>& tileLayer);
+            virtual bool buildTile(const std::shared_ptr<TileLayer>& tileLayer, const MapTile& dataSourceTile, const std::shared_ptr<TileData>& tileData);
+
+        private:
+            long long _sharedCacheGeneration;
         };
         
         class TileInfo {
@@ -294,6 +299,8 @@ namespace carto {
 
         cache::timed_lru_cache<long long, TileInfo> _visibleCache;
         cache::timed_lru_cache<long long, TileInfo> _preloadingCache;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
     };
     
 }
@@ -0,0 +1,203 @@
+#include "DecodedTileCache.h"
+#include "core/BinaryData.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <typeinfo>
+
+#include <vt/TileTransformer.h>
+
+namespace carto {
+
+    DecodedTileCache::~DecodedTileCache() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
+    }
+
+    std::size_t DecodedTileCache::getCapacity() const {
+        return _memoryGovernorHandle->getCapacity();
+    }
+
+    void DecodedTileCache::setCapacity(std::size_t capacityInBytes) {
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
+    }
+
+    long long DecodedTileCache::getGeneration() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _generation;
+    }
+
+    void DecodedTileCache::registerDataSource(const std::shared_ptr<TileDataSource>& dataSource) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        addDataSource(dataSource);
+    }
+
+    bool DecodedTileCache::get(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId, Tile& tile) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _entryMap.find(CreateKey(dataSource, styleHash, tileTransformer, tileId));
+        if (it == _entryMap.end()) {
+            _memoryGovernorHandle->addMiss();
+            return false;
+        }
+
+        // Drop the entry if it belongs to a released data source that had the same address, or if the tile has expired
+        Entry& entry = *it->second;
+        long long maxAge = -1;
+        if (entry.expirationTime) {
+            maxAge = std::max(0LL, static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(*entry.expirationTime - std::chrono::steady_clock::now()).count()));
+        }
+        if (entry.dataSource.expired() || maxAge == 0) {
+            removeEntry(it->second);
+            _memoryGovernorHandle->addMiss();
+            return false;
+        }
+
+        // Mark the tile as most recently used
+        _entries.splice(_entries.begin(), _entries, it->second);
+        tile = entry.tile;
+        tile.maxAge = maxAge;
+        _memoryGovernorHandle->addHit();
+        return true;
+    }
+
+    void DecodedTileCache::put(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId, long long generation, const Tile& tile, std::size_t tileSize) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // The data source may have changed while the tile was loaded and decoded
+        if (generation != _generation || tileSize > _capacity) {
+            return;
+        }
+
+        // Make sure the tiles are dropped when the data source changes, even if no layer is listening to it
+        addDataSource(dataSource);
+
+        Key key = CreateKey(dataSource, styleHash, tileTransformer, tileId);
+        auto it = _entryMap.find(key);
+        if (it != _entryMap.end()) {
+            removeEntry(it->second);
+        }
+
+        Entry entry { key, dataSource, tile, std::shared_ptr<std::chrono::steady_clock::time_point>(), tileSize };
+        if (tile.maxAge >= 0) {
+            entry.expirationTime = std::make_shared<std::chrono::steady_clock::time_point>(std::chrono::steady_clock::now() + std::chrono::milliseconds(tile.maxAge));
+        }
+        _entries.push_front(std::move(entry));
+        _entryMap[key] = _entries.begin();
+        _size += tileSize;
+
+        while (_size > _capacity && !_entries.empty()) {
+            removeEntry(std::prev(_entries.end()));
+        }
+    }
+
+    DecodedTileCache& DecodedTileCache::GetInstance() {
+        static DecodedTileCache instance;
+        return instance;
+    }
+
+    std::size_t DecodedTileCache::KeyHash::operator() (const Key& key) const {
+        std::size_t hash = std::hash<const void*>()(key.dataSource);
+        hash = hash * 31 + key.styleHash;
+        hash = hash * 31 + key.tileTransformerType;
+        hash = hash * 31 + std::hash<long long>()(key.tileId);
+        return hash;
+    }
+
+    DecodedTileCache::DecodedTileCache() :
+        _entries(),
+        _entryMap(),
+        _dataSourceInfoMap(),
+        _size(0),
+        _capacity(DEFAULT_CAPACITY),
+        _generation(0),
+        _mutex(),
+        _memoryGovernorHandle()
+    {
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("DecodedTileCache", MemoryTrimLevel::MEMORY_TRIM_LEVEL_LOW, DEFAULT_CAPACITY,
+            [this](std::size_t capacityInBytes) {
+                applyCapacity(capacityInBytes);
+            },
+            [this]() {
+                trim();
+            }
+        );
+    }
+
+    void DecodedTileCache::applyCapacity(std::size_t capacityInBytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _capacity = capacityInBytes;
+        while (_size > _capacity && !_entries.empty()) {
+            removeEntry(std::prev(_entries.end()));
+        }
+    }
+
+    void DecodedTileCache::trim() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+        _entryMap.clear();
+        _size = 0;
+    }
+
+    void DecodedTileCache::addDataSource(const std::shared_ptr<TileDataSource>& dataSource) {
+        auto it = _dataSourceInfoMap.find(dataSource.get());
+        if (it != _dataSourceInfoMap.end() && !it->second.dataSource.expired()) {
+            return;
+        }
+
+        // Forget released data sources, their listeners were released with them
+        for (auto it2 = _dataSourceInfoMap.begin(); it2 != _dataSourceInfoMap.end(); ) {
+            if (it2->second.dataSource.expired()) {
+                it2 = _dataSourceInfoMap.erase(it2);
+            } else {
+                it2++;
+            }
+        }
+
+        DataSourceInfo& dataSourceInfo = _dataSourceInfoMap[dataSource.get()];
+        dataSourceInfo.dataSource = dataSource;
+        dataSourceInfo.listener = std::make_shared<DataSourceListener>(dataSource.get());
+        dataSource->registerOnChangeListener(dataSourceInfo.listener);
+    }
+
+    void DecodedTileCache::invalidate(const TileDataSource* dataSource) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _generation++;
+        for (auto it = _entries.begin(); it != _entries.end(); ) {
+            auto nextIt = std::next(it);
+            if (it->key.dataSource == dataSource) {
+                removeEntry(it);
+            }
+            it = nextIt;
+        }
+    }
+
+    DecodedTileCache::Key DecodedTileCache::CreateKey(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId) {
+        // Each layer has its own transformer instance, but transformers of the same type are created with identical parameters
+        std::size_t tileTransformerType = (tileTransformer ? typeid(*tileTransformer).hash_code() : 0);
+        return Key { dataSource.get(), styleHash, tileTransformerType, tileId };
+    }
+
+    void DecodedTileCache::removeEntry(std::list<Entry>::iterator it) {
+        _size -= it->size;
+        _entryMap.erase(it->key);
+        _entries.erase(it);
+    }
+
+    DecodedTileCache::DataSourceListener::DataSourceListener(const TileDataSource* dataSource) :
+        _dataSource(dataSource)
+    {
+    }
+
+    void DecodedTileCache::DataSourceListener::onTilesChanged(bool removeTiles) {
+        DecodedTileCache::GetInstance().invalidate(_dataSource);
+    }
+
+    void DecodedTileCache::DataSourceListener::onTilesChanged(bool removeTiles, const MapBounds& bounds) {
+        DecodedTileCache::GetInstance().invalidate(_dataSource);
+    }
+
+    const unsigned int DecodedTileCache::DEFAULT_CAPACITY = 32 * 1024 * 1024;
+
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_DECODEDTILECACHE_H_
+#define _CARTO_DECODEDTILECACHE_H_
+
+#include "core/MapBounds.h"
+#include "datasources/TileDataSource.h"
+#include "utils/MemoryGovernor.h"
+#include "vectortiles/VectorTileDecoder.h"
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace carto {
+    namespace vt {
+        class TileTransformer;
+    }
+
+    class BinaryData;
+
+    /**
+     * An internal process-wide cache of decoded vector tiles. Layers using the same data source,
+     * decoder style and tile transformer type share the decoded tiles instead of decoding them again.
+     * Decoder styles are compared by their content hash, so tiles are shared also between separately created decoders.
+     * Tiles are reference counted, so tiles used by layers stay alive even when removed from the cache.
+     * The cache listens to data source changes itself and drops the tiles of changed data sources.
+     */
+    class DecodedTileCache {
+    public:
+        struct Tile {
+            MapBounds tileBounds;
+            std::shared_ptr<BinaryData> tileData; // may be null if the original data was not kept
+            std::shared_ptr<VectorTileDecoder::TileMap> tileMap;
+            long long maxAge; // in milliseconds, -1 if the tile does not expire
+        };
+
+        virtual ~DecodedTileCache();
+
+        std::size_t getCapacity() const;
+        void setCapacity(std::size_t capacityInBytes);
+
+        /**
+         * Returns the current generation of the cache. Generation changes when any data source is invalidated,
+         * tiles decoded from data loaded before the change are rejected by put.
+         * @return The current generation of the cache.
+         */
+        long long getGeneration() const;
+
+        /**
+         * Starts tracking changes of the specified data source. Layers should register their data source before
+         * registering their own data source listeners, so that the shared tiles are dropped before the layers reload them.
+         * @param dataSource The data source to track.
+         */
+        void registerDataSource(const std::shared_ptr<TileDataSource>& dataSource);
+
+        bool get(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId, Tile& tile);
+        void put(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId, long long generation, const Tile& tile, std::size_t tileSize);
+
+        /**
+         * Returns the singleton instance of the class.
+         * @return The singleton instance of the class.
+         */
+        static DecodedTileCache& GetInstance();
+
+    private:
+        class DataSourceListener : public TileDataSource::OnChangeListener {
+        public:
+            explicit DataSourceListener(const TileDataSource* dataSource);
+
+            virtual void onTilesChanged(bool removeTiles);
+            virtual void onTilesChanged(bool removeTiles, const MapBounds& bounds);
+
+        private:
+            const TileDataSource* _dataSource;
+        };
+
+        struct DataSourceInfo {
+            std::weak_ptr<TileDataSource> dataSource;
+            std::shared_ptr<DataSourceListener> listener;
+        };
+
+        struct Key {
+            const TileDataSource* dataSource;
+            std::size_t styleHash;
+            std::size_t tileTransformerType;
+            long long tileId;
+
+            bool operator == (const Key& key) const {
+                return dataSource == key.dataSource && styleHash == key.styleHash && tileTransformerType == key.tileTransformerType && tileId == key.tileId;
+            }
+        };
+
+        struct KeyHash {
+            std::size_t operator() (const Key& key) const;
+        };
+
+        struct Entry {
+            Key key;
+            std::weak_ptr<TileDataSource> dataSource; // used to detect reused addresses of released data sources
+            Tile tile;
+            std::shared_ptr<std::chrono::steady_clock::time_point> expirationTime;
+            std::size_t size;
+        };
+
+        DecodedTileCache();
+
+        void applyCapacity(std::size_t capacityInBytes);
+        void trim();
+
+        void addDataSource(const std::shared_ptr<TileDataSource>& dataSource);
+        void invalidate(const TileDataSource* dataSource);
+
+        static Key CreateKey(const std::shared_ptr<TileDataSource>& dataSource, std::size_t styleHash, const std::shared_ptr<vt::TileTransformer>& tileTransformer, long long tileId);
+
+        void removeEntry(std::list<Entry>::iterator it);
+
+        static const unsigned int DEFAULT_CAPACITY;
+
+        std::list<Entry> _entries; // ordered from most recently used to least recently used
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _entryMap;
+        std::unordered_map<const TileDataSource*, DataSourceInfo> _dataSourceInfoMap;
+        std::size_t _size;
+        std::size_t _capacity;
+        long long _generation;
+        mutable std::mutex _mutex;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
+    };
+
+}
+
+#endif
@@ -28,6 +28,7 @@ namespace carto {
 
     HTTPClient::HTTPClient(bool log) :
         _log(log),
+        _limitHostRequests(false),
         _impl(std::make_unique<CARTO_HTTP_SOCKET_IMPL>(log))
     {
     }
@@ -36,6 +37,10 @@ namespace carto {
         _impl->setTimeout(milliseconds);
     }
 
+    void HTTPClient::setLimitHostRequests(bool limit) {
+        _limitHostRequests = limit;
+    }
+
     int HTTPClient::get(const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData, int* statusCode) const {
         Request request("GET", url);
         request.headers.insert(requestHeaders.begin(), requestHeaders.end());
@@ -54,7 +59,7 @@ namespace carto {
         };
 
         Response response;
-        int code = makeRequest(request, response, handlerFn, 0);
+        int code = makeRequest(request, response, handlerFn, 0, _limitHostRequests);
         responseHeaders.insert(response.headers.begin(), response.headers.end());
         responseData = std::make_shared<BinaryData>(std::move(content));
         if (statusCode) {
@@ -84,7 +89,7 @@ namespace carto {
         };
 
         Response response;
-        int code = makeRequest(request, response, handlerFn, 0);
+        int code = makeRequest(request, response, handlerFn, 0, false);
         responseHeaders.insert(response.headers.begin(), response.headers.end());
         responseData = std::make_shared<BinaryData>(std::move(content));
         return code;
@@ -101,12 +106,12 @@ namespace carto {
         }
 
         Response response;
-        int code = makeRequest(request, response, handlerFn, offset);
+        int code = makeRequest(request, response, handlerFn, offset, false);
         responseHeaders.insert(response.headers.begin(), response.headers.end());
         return code;
     }
 
-    int HTTPClient::makeRequest(Request request, Response& response, HandlerFunc handlerFn, std::uint64_t offset) const {
+    int HTTPClient::makeRequest(Request request, Response& response, HandlerFunc handlerFn, std::uint64_t offset, bool limitHostRequests) const {
         std::uint64_t contentOffset = 0;
         std::uint64_t contentLength = std::numeric_limits<std::uint64_t>::max();
 
@@ -147,8 +152,12 @@ namespace carto {
             return result;
         };
 
-        if (!_impl->makeRequest(request, headersFn, dataFn)) {
-            return -1; // request was cancelled
+        {
+            // Limit the number of concurrent requests per host, so that the platform connection pools can reuse connections
+            HostRequestSlot slot(request.url, limitHostRequests);
+            if (!_impl->makeRequest(request, headersFn, dataFn)) {
+                return -1; // request was cancelled
+            }
         }
 
         if (response.statusCode >= 300 && response.statusCode < 400) {
@@ -161,10 +170,14 @@ namespace carto {
                 Request redirectedRequest(request);
                 redirectedRequest.url = location;
                 response = Response();
-                return makeRequest(redirectedRequest, response, handlerFn, originalOffset);
+                return makeRequest(redirectedRequest, response, handlerFn, originalOffset, limitHostRequests);
             }
         }
 
+        if (response.statusCode == 304) {
+            return response.statusCode; // not modified, response to a conditional request
+        }
+
         if (response.statusCode < 200 || response.statusCode >= 300) {
             if (_log) {
                 Log::Errorf("HTTPClient::makeRequest: Bad status code: %d, URL: %s", response.statusCode, request.url.c_str());
@@ -175,7 +188,52 @@ namespace carto {
         return 0;
     }
 
+    std::string HTTPClient::GetHostKey(const std::string& url) {
+        std::smatch what;
+        if (std::regex_search(url, what, std::regex("^([a-zA-Z][a-zA-Z0-9+.-]*)://([^/?#]*)"))) {
+            return boost::to_lower_copy(what.str(1) + "://" + what.str(2));
+        }
+        return std::string();
+    }
+
     HTTPClient::Impl::~Impl() {
     }
 
+    HTTPClient::HostRequestSlot::HostRequestSlot(const std::string& url, bool limit) :
+        _hostKey(GetHostKey(url)),
+        _limit(limit)
+    {
+        if (!_limit) {
+            return;
+        }
+
+        // The limit is soft: if no slot is released in time, the request is made anyway, so that a stalled host can not block the caller indefinitely
+        std::unique_lock<std::mutex> lock(_HostRequestMutex);
+        _HostRequestCondition.wait_for(lock, std::chrono::milliseconds(MAX_HOST_REQUEST_WAIT_TIME), [this]() {
+            return _HostRequestCounts[_hostKey] < MAX_CONCURRENT_REQUESTS_PER_HOST;
+        });
+        _HostRequestCounts[_hostKey]++;
+    }
+
+    HTTPClient::HostRequestSlot::~HostRequestSlot() {
+        if (!_limit) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_HostRequestMutex);
+            if (--_HostRequestCounts[_hostKey] == 0) {
+                _HostRequestCounts.erase(_hostKey);
+            }
+        }
+        _HostRequestCondition.notify_all();
+    }
+
+    const int HTTPClient::MAX_CONCURRENT_REQUESTS_PER_HOST = 6;
+    const int HTTPClient::MAX_HOST_REQUEST_WAIT_TIME = 5000;
+
+    std::map<std::string, int> HTTPClient::_HostRequestCounts;
+    std::mutex HTTPClient::_HostRequestMutex;
+    std::condition_variable HTTPClient::_HostRequestCondition;
+
 }
@@ -12,6 +12,7 @@
 #include <map>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 
@@ -26,6 +27,9 @@ namespace carto {
 
         void setTimeout(int milliseconds);
 
+        // Enables limiting the number of concurrent get requests per host. Intended for tile requests, streamed responses are never limited.
+        void setLimitHostRequests(bool limit);
+
         int get(const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData, int* statusCode = 0) const;
         int post(const std::string& url, const std::string& contentType, const std::shared_ptr<BinaryData>& requestData, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, std::shared_ptr<BinaryData>& responseData);
         int streamResponse(const std::string& method, const std::string& url, const std::map<std::string, std::string>& requestHeaders, std::map<std::string, std::string>& responseHeaders, HandlerFunc handlerFn, std::uint64_t offset) const;
@@ -79,9 +83,29 @@ namespace carto {
         class IOSImpl;
         class WinSockImpl;
 
-        int makeRequest(Request request, Response& response, HandlerFunc handlerFn, std::uint64_t offset) const;
+        class HostRequestSlot {
+        public:
+            HostRequestSlot(const std::string& url, bool limit);
+            ~HostRequestSlot();
+
+        private:
+            std::string _hostKey;
+            bool _limit;
+        };
+
+        int makeRequest(Request request, Response& response, HandlerFunc handlerFn, std::uint64_t offset, bool limitHostRequests) const;
+
+        static std::string GetHostKey(const std::string& url);
+
+        static const int MAX_CONCURRENT_REQUESTS_PER_HOST;
+        static const int MAX_HOST_REQUEST_WAIT_TIME;
+
+        static std::map<std::string, int> _HostRequestCounts;
+        static std::mutex _HostRequestMutex;
+        static std::condition_variable _HostRequestCondition;
 
         bool _log;
+        bool _limitHostRequests;
         std::unique_ptr<Impl> _impl;
     };
 
@@ -6,6 +6,9 @@
 #include <limits>
 #include <regex>
 
+#include <sys/socket.h>
+#include <sys/time.h>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -13,11 +16,16 @@ namespace carto {
 
     HTTPClient::PionImpl::PionImpl(bool log) :
         _log(log),
+        _timeout(-1),
         _connectionMap(),
         _mutex()
     {
     }
 
+    void HTTPClient::PionImpl::setTimeout(int milliseconds) {
+        _timeout = milliseconds;
+    }
+
     bool HTTPClient::PionImpl::makeRequest(const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const {
         // Parse request URL
         std::string proto, host, path, query;
@@ -28,55 +36,85 @@ namespace carto {
         if (proto == "https") {
             throw NetworkException("HTTPS protocol not supported", request.url);
         }
-        auto connectionKey = std::make_pair(host, port);
-
-        // Try to reuse existing connection from the pool for GET methods
-        bool result = false;
-        while (true) {
-            std::shared_ptr<Connection> connection;
-            {
-                std::lock_guard<std::mutex> lock(_mutex);
-                auto it = _connectionMap.find(connectionKey);
-                if (it != _connectionMap.end()) {
-                    connection = it->second;
-                    _connectionMap.erase(it);
-                }
-            }
-            if (!connection) {
-                break;
+        ConnectionKey connectionKey(host, port);
+
+        // Try to reuse idle connections from the pool first for GET requests. Server may have closed an idle connection
+        // without us noticing, in that case retry with the next connection if no response was received yet.
+        bool reusable = (request.method == "GET");
+        while (std::shared_ptr<Connection> connection = (reusable ? takeIdleConnection(connectionKey) : std::shared_ptr<Connection>())) {
+            bool responseReceived = false;
+            auto trackedHeadersFn = [&headersFn, &responseReceived](int statusCode, const std::map<std::string, std::string>& headers) {
+                responseReceived = true;
+                return headersFn(statusCode, headers);
+            };
+
+            bool result = false;
+            try {
+                result = makeRequest(*connection, request, trackedHeadersFn, dataFn);
             }
-            if (!connection->isValid()) {
+            catch (const NetworkException& ex) {
+                if (responseReceived) {
+                    throw;
+                }
+                if (_log) {
+                    Log::Infof("HTTPClient::PionImpl::makeRequest: Pooled connection failed, retrying: %s", ex.what());
+                }
                 continue;
             }
 
-            result = makeRequest(*connection, request, headersFn, dataFn);
-
             if (result) {
-                std::lock_guard<std::mutex> lock(_mutex);
-                if (request.method == "GET") {
-                    _connectionMap.insert(std::make_pair(connectionKey, connection));
-                }
-                return result;
+                releaseConnection(connectionKey, connection);
             }
+            return result;
         }
 
         // Create new connection
-        auto connection = std::make_shared<Connection>(host, port);
+        auto connection = std::make_shared<Connection>(host, port, _timeout.load());
         if (!connection->isValid()) {
             return false;
         }
 
-        result = makeRequest(*connection, request, headersFn, dataFn);
+        bool result = makeRequest(*connection, request, headersFn, dataFn);
 
-        if (result) {
-            std::lock_guard<std::mutex> lock(_mutex);
-            if (request.method == "GET") {
-                _connectionMap.insert(std::make_pair(connectionKey, connection));
-            }
+        if (result && reusable) {
+            releaseConnection(connectionKey, connection);
         }
         return result;
     }
 
+    std::shared_ptr<HTTPClient::PionImpl::Connection> HTTPClient::PionImpl::takeIdleConnection(const ConnectionKey& connectionKey) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _connectionMap.find(connectionKey); it != _connectionMap.end() && it->first == connectionKey; ) {
+            std::shared_ptr<Connection> connection = it->second;
+            it = _connectionMap.erase(it);
+            if (connection->isValid()) {
+                return connection;
+            }
+        }
+        return std::shared_ptr<Connection>();
+    }
+
+    void HTTPClient::PionImpl::releaseConnection(const ConnectionKey& connectionKey, const std::shared_ptr<Connection>& connection) const {
+        if (!connection->isValid()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Drop connections that have timed out while idle
+        for (auto it = _connectionMap.begin(); it != _connectionMap.end(); ) {
+            if (!it->second->isValid()) {
+                it = _connectionMap.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        if (static_cast<int>(_connectionMap.count(connectionKey)) < MAX_IDLE_CONNECTIONS_PER_HOST) {
+            _connectionMap.insert(std::make_pair(connectionKey, connection));
+        }
+    }
+
     bool HTTPClient::PionImpl::makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const {
         std::string url = request.url;
         std::string proto, host, path, query;
@@ -96,10 +134,13 @@ namespace carto {
         } else {
             pionRequest.set_do_not_send_content_length();
         }
-        pionRequest.add_header("Host", request.url);
+        pionRequest.add_header("Host", port == 80 ? host : host + ":" + boost::lexical_cast<std::string>(port));
         for (auto it = request.headers.begin(); it != request.headers.end(); it++) {
             pionRequest.add_header(it->first, it->second);
         }
+        if (request.headers.find("Connection") == request.headers.end()) {
+            pionRequest.add_header("Connection", "keep-alive");
+        }
         pionRequest.send(*connection.connection, socketError);
         if (socketError) {
             throw NetworkException(socketError.message(), request.url);
@@ -125,6 +166,7 @@ namespace carto {
         // Feed read data to HTTP parser
         pion::http::response pionResponse;
         std::vector<char> bufferData(asio::buffers_begin(buffer.data()), asio::buffers_end(buffer.data()));
+        std::size_t initialContentSize = bufferData.size() - bytesRead; // read_until may also return part of the content
         parser.set_read_buffer(bufferData.data(), bufferData.size());
         parser.parse(pionResponse, parserError);
         buffer.consume(bufferData.size());
@@ -139,34 +181,40 @@ namespace carto {
             cancel = true;
         }
 
-        // Check Keep-Alive directive
+        // Check Keep-Alive directive. Idle connections are never kept longer than MAX_KEEPALIVE_TIMEOUT.
         connection.maxRequests--;
-        it = pionResponse.get_headers().find("Keep-Alive");
+        connection.keepAliveTime = requestTime + std::chrono::seconds(DEFAULT_KEEPALIVE_TIMEOUT); // Apache servers have this limitation typically
+        auto it = pionResponse.get_headers().find("Keep-Alive");
         if (it != pionResponse.get_headers().end()) {
             std::cmatch what;
-            if (std::regex_match(it->second.c_str(), what, std::regex(".*[^a-zA-Z0-9]timeout=([0-9]*).*"))) {
-                long long timeout = boost::lexical_cast<long long>(what[1]);
+            if (std::regex_match(it->second.c_str(), what, std::regex("(.*[^a-zA-Z0-9])?timeout=([0-9]+).*"))) {
+                long long timeout = std::min(boost::lexical_cast<long long>(what[2]), static_cast<long long>(MAX_KEEPALIVE_TIMEOUT));
                 connection.keepAliveTime = requestTime + std::chrono::seconds(timeout);
             }
-            if (std::regex_match(it->second.c_str(), what, std::regex(".*[^a-zA-Z0-9]max=([0-9]*).*"))) {
-                int maxRequests = boost::lexical_cast<int>(what[1]);
+            if (std::regex_match(it->second.c_str(), what, std::regex("(.*[^a-zA-Z0-9])?max=([0-9]+).*"))) {
+                int maxRequests = boost::lexical_cast<int>(what[2]);
                 connection.maxRequests = std::min(connection.maxRequests, maxRequests);
             }
-        } else {
-            connection.keepAliveTime = requestTime + std::chrono::seconds(5); // Apache servers have this limitation typically
+        }
+        it = pionResponse.get_headers().find("Connection");
+        if (it != pionResponse.get_headers().end() && boost::iequals(it->second, "close")) {
+            connection.maxRequests = 0;
         }
 
-        // Read Content-Length
+        // Read Content-Length. Responses to HEAD requests and 1xx, 204 and 304 responses never have a body, even without Content-Length.
         std::uint64_t contentLength = std::numeric_limits<std::uint64_t>::max();
-        auto it = pionResponse.get_headers().find("Content-Length");
-        if (it != pionResponse.get_headers().end()) {
+        int statusCode = pionResponse.get_status_code();
+        it = pionResponse.get_headers().find("Content-Length");
+        if (request.method == "HEAD" || (statusCode >= 100 && statusCode < 200) || statusCode == 204 || statusCode == 304) {
+            contentLength = 0;
+        } else if (it != pionResponse.get_headers().end()) {
             contentLength = boost::lexical_cast<std::uint64_t>(it->second);
         } else {
             connection.maxRequests = 0; // force new connection next time
         }
 
         // Read response
-        for (std::uint64_t offset = 0; offset < contentLength && !cancel; ) {
+        for (std::uint64_t offset = initialContentSize; offset < contentLength && !cancel; ) {
             bytesRead = asio::read(*connection.connection, buffer, asio::transfer_at_least(1), socketError);
             if (socketError) {
                 // If Content-Length was not explicitly defined, break at EOF
@@ -191,7 +239,7 @@ namespace carto {
         return !cancel;
     }
 
-    HTTPClient::PionImpl::Connection::Connection(const std::string& host, std::uint16_t port) :
+    HTTPClient::PionImpl::Connection::Connection(const std::string& host, std::uint16_t port, int timeout) :
         maxRequests(std::numeric_limits<int>::max()), keepAliveTime(), ioService(), connection()
     {
         // Connect to server
@@ -200,6 +248,16 @@ namespace carto {
         asio::error_code socketError = connection->connect(host, port);
         if (socketError) {
             connection.reset();
+            return;
+        }
+
+        // Apply read/write timeouts to the socket, blocking asio operations do not support timeouts otherwise
+        if (timeout > 0) {
+            struct timeval tv;
+            tv.tv_sec = timeout / 1000;
+            tv.tv_usec = (timeout % 1000) * 1000;
+            ::setsockopt(connection->get_socket().native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(connection->get_socket().native_handle(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
         }
     }
 
@@ -214,4 +272,8 @@ namespace carto {
         return maxRequests > 0 && (keepAliveTime == nullTime || keepAliveTime > std::chrono::steady_clock::now());
     }
 
+    const int HTTPClient::PionImpl::DEFAULT_KEEPALIVE_TIMEOUT = 5;
+    const int HTTPClient::PionImpl::MAX_KEEPALIVE_TIMEOUT = 60;
+    const int HTTPClient::PionImpl::MAX_IDLE_CONNECTIONS_PER_HOST = 6;
+
 }
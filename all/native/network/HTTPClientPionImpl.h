@@ -7,6 +7,9 @@
 #ifndef _CARTO_HTTPCLIENTPIONIMPL_H_
 #define _CARTO_HTTPCLIENTPIONIMPL_H_
 
+#include <atomic>
+#include <chrono>
+
 #include <asio.hpp>
 #include <pion/http/parser.hpp>
 #include <pion/http/response.hpp>
@@ -20,6 +23,7 @@ namespace carto {
     public:
         explicit PionImpl(bool log);
 
+        virtual void setTimeout(int milliseconds);
         virtual bool makeRequest(const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const;
 
     private:
@@ -29,15 +33,25 @@ namespace carto {
             asio::io_service ioService;
             std::shared_ptr<pion::tcp::connection> connection;
 
-            Connection(const std::string& host, std::uint16_t port);
+            Connection(const std::string& host, std::uint16_t port, int timeout);
 
             bool isValid() const;
         };
 
+        typedef std::pair<std::string, int> ConnectionKey;
+
+        std::shared_ptr<Connection> takeIdleConnection(const ConnectionKey& connectionKey) const;
+        void releaseConnection(const ConnectionKey& connectionKey, const std::shared_ptr<Connection>& connection) const;
+
         bool makeRequest(Connection& connection, const HTTPClient::Request& request, HeadersFunc headersFn, DataFunc dataFn) const;
 
+        static const int DEFAULT_KEEPALIVE_TIMEOUT; // in seconds
+        static const int MAX_KEEPALIVE_TIMEOUT; // in seconds
+        static const int MAX_IDLE_CONNECTIONS_PER_HOST;
+
         bool _log;
-        mutable std::multimap<std::pair<std::string, int>, std::shared_ptr<Connection> > _connectionMap;
+        std::atomic<int> _timeout;
+        mutable std::multimap<ConnectionKey, std::shared_ptr<Connection> > _connectionMap;
         mutable std::mutex _mutex;
     };
 
@@ -67,6 +67,10 @@ namespace carto {
         _serverPackageCache(),
         _packageHandlerCache(),
         _packageFileMutex(),
+        _packageReaderCount(0),
+        _packageDeleting(false),
+        _packageReaderCondition(),
+        _packageReaderMutex(),
         _mutex()
     {
         if (_packageListURL.empty()) {
@@ -342,27 +346,43 @@ namespace carto {
         // NOTE: should use shared_lock here, but iOS 9 does not support it
         std::unique_lock<std::mutex> packageLock(_packageFileMutex);
 
-        // Find all package handlers
-        std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > packageHandlerMap;
+        // Use the callback
+        callback(*getLocalPackageHandlers());
+    }
+
+    void PackageManager::readLocalPackages(const std::function<void(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >&)>& callback) const {
         {
-            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            std::unique_lock<std::mutex> lock(_packageReaderMutex);
+            _packageReaderCondition.wait(lock, [this]() { return !_packageDeleting; });
+            _packageReaderCount++;
+        }
+
+        // Use the callback without holding the package file lock
+        try {
+            callback(getLocalPackageHandlers());
+        }
+        catch (...) {
+            endReadLocalPackages();
+            throw;
+        }
+        endReadLocalPackages();
+    }
 
+    std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > > PackageManager::getLocalPackageHandlers() const {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        if (!_packageHandlerCache) {
+            // Create handlers for all local packages, the snapshot is reset when local packages are synced
+            auto packageHandlerMap = std::make_shared<std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >();
             for (const std::shared_ptr<PackageInfo>& packageInfo : _localPackages) {
-                auto it = _packageHandlerCache.find(packageInfo);
-                if (it == _packageHandlerCache.end()) {
-                    std::string fileName = createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()));
-                    auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageInfo->getPackageType(), fileName);
-                    if (!handler) {
-                        continue;
-                    }
-                    it = _packageHandlerCache.insert(std::make_pair(packageInfo, handler)).first;
+                std::string fileName = createLocalFilePath(createPackageFileName(packageInfo->getPackageId(), packageInfo->getPackageType(), packageInfo->getVersion()));
+                if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageInfo->getPackageType(), fileName)) {
+                    (*packageHandlerMap)[packageInfo] = handler;
                 }
-                packageHandlerMap[packageInfo] = it->second;
             }
+            _packageHandlerCache = packageHandlerMap;
         }
-
-        // Use the callback
-        callback(packageHandlerMap);
+        return _packageHandlerCache;
     }
     
     std::vector<std::shared_ptr<PackageInfo> > PackageManager::suggestPackages(const MapPos& mapPos, const std::shared_ptr<Projection>& projection) const {
@@ -1149,7 +1169,7 @@ namespace carto {
 
         // Update packages, sync caches
         _localPackages = std::move(packages);
-        _packageHandlerCache.clear();
+        _packageHandlerCache.reset();
     }
 
     void PackageManager::importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName) {
@@ -1198,6 +1218,7 @@ namespace carto {
         // Find package info and if successful, remove the package
         std::string packageFileName;
         PackageType::PackageType packageType = PackageType::PACKAGE_TYPE_MAP;
+        std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > > packageHandlerMap;
         try {
             std::lock_guard<std::recursive_mutex> lock(_mutex);
 
@@ -1220,7 +1241,8 @@ namespace carto {
             command.bind(":id", id);
             command.execute();
 
-            // Sync
+            // Sync, keep the old handlers so that their files can be closed
+            packageHandlerMap = _packageHandlerCache;
             syncLocalPackages();
         }
         catch (const std::exception& ex) {
@@ -1231,11 +1253,37 @@ namespace carto {
         // Notify packages were deleted
         notifyPackagesChanged(OnChangeListener::PACKAGES_DELETED);
 
+        // Wait until readers have finished, new readers see only the synced packages. Close the files of the old handlers.
+        {
+            std::unique_lock<std::mutex> lock(_packageReaderMutex);
+            _packageDeleting = true;
+            _packageReaderCondition.wait(lock, [this]() { return _packageReaderCount == 0; });
+        }
+        if (packageHandlerMap) {
+            for (auto it = packageHandlerMap->begin(); it != packageHandlerMap->end(); it++) {
+                it->second->onClosePackage();
+            }
+        }
+
         // Invoke handler callback, delete file
         if (auto handler = PackageHandlerFactory(_serverEncKey, _localEncKey).createPackageHandler(packageType, packageFileName)) {
             handler->onDeletePackage();
         }
         utf8_filesystem::unlink(packageFileName.c_str());
+
+        {
+            std::lock_guard<std::mutex> lock(_packageReaderMutex);
+            _packageDeleting = false;
+        }
+        _packageReaderCondition.notify_all();
+    }
+
+    void PackageManager::endReadLocalPackages() const {
+        {
+            std::lock_guard<std::mutex> lock(_packageReaderMutex);
+            _packageReaderCount--;
+        }
+        _packageReaderCondition.notify_all();
     }
 
     bool PackageManager::isTaskCancelled(int taskId) const {
@@ -179,6 +179,12 @@ namespace carto {
          * @param callback The callback function.
          */
         void accessLocalPackages(const std::function<void(const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> >&)>& callback) const;
+        /**
+         * Calls specified handler callback with a snapshot of local packages. Unlike accessLocalPackages, callbacks
+         * can run concurrently with each other and with package downloads. Package deletion waits until running callbacks have finished.
+         * @param callback The callback function.
+         */
+        void readLocalPackages(const std::function<void(const std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > >&)>& callback) const;
 
         /**
          * Suggests packages for given map position. Note that in order this to work, local package list must be available first.
@@ -327,6 +333,8 @@ namespace carto {
         bool downloadStyle(int taskId);
         
         void syncLocalPackages();
+        std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > > getLocalPackageHandlers() const;
+        void endReadLocalPackages() const;
         void importLocalPackage(int id, int taskId, const std::string& packageId, PackageType::PackageType packageType, const std::string& packageFileName);
         void deleteLocalPackage(int id);
 
@@ -375,9 +383,14 @@ namespace carto {
         ThreadSafeDirectorPtr<PackageManagerListener> _packageManagerListener;
 
         mutable std::shared_ptr<std::vector<std::shared_ptr<PackageInfo> > > _serverPackageCache;
-        mutable std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > _packageHandlerCache;
+        mutable std::shared_ptr<const std::map<std::shared_ptr<PackageInfo>, std::shared_ptr<PackageHandler> > > _packageHandlerCache; // immutable snapshot, null if it needs to be rebuilt
+
+        mutable std::mutex _packageFileMutex; // guards package file accesses, except readLocalPackages callbacks
 
-        mutable std::mutex _packageFileMutex; // guards all package file accesses
+        mutable int _packageReaderCount; // number of running readLocalPackages callbacks
+        bool _packageDeleting; // true while a package file is being deleted, blocks new readLocalPackages callbacks
+        mutable std::condition_variable _packageReaderCondition;
+        mutable std::mutex _packageReaderMutex;
 
         mutable std::recursive_mutex _mutex; // guards all state
     };
@@ -80,6 +80,10 @@ namespace carto {
     void MapPackageHandler::onDeletePackage() {
     }
 
+    void MapPackageHandler::onClosePackage() {
+        closeDatabase();
+    }
+
     std::shared_ptr<PackageTileMask> MapPackageHandler::calculateTileMask() const {
         std::lock_guard<std::recursive_mutex> lock(_mutex);
 
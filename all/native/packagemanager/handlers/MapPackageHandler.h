@@ -33,6 +33,7 @@ namespace carto {
 
         virtual void onImportPackage();
         virtual void onDeletePackage();
+        virtual void onClosePackage();
 
         virtual std::shared_ptr<PackageTileMask> calculateTileMask() const;
 
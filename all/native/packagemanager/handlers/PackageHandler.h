@@ -22,6 +22,7 @@ namespace carto {
 
         virtual void onImportPackage() = 0;
         virtual void onDeletePackage() = 0;
+        virtual void onClosePackage() { }
 
         virtual std::shared_ptr<PackageTileMask> calculateTileMask() const = 0;
     
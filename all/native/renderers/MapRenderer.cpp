@@ -30,6 +30,7 @@
 #include "renderers/workers/CullWorker.h"
 #include "utils/Const.h"
 #include "utils/Log.h"
+#include "utils/MemoryGovernor.h"
 #include "utils/ThreadUtils.h"
 
 #include <algorithm>
@@ -541,6 +542,9 @@ namespace carto {
         // Create pending resources
         _glResourceManager->processResources();
 
+        // Periodically redistribute the memory budget between the caches
+        MemoryGovernor::RebalanceIfNeeded();
+
         // Check if surface has changed
         if (_surfaceChanged.exchange(false)) {
             int width = 0, height = 0;
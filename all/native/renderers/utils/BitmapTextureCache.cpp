@@ -7,16 +7,16 @@
 namespace carto {
     
     BitmapTextureCache::~BitmapTextureCache() {
+        MemoryGovernor::UnregisterCache(_memoryGovernorHandle);
     }
     
     std::size_t BitmapTextureCache::getCapacity() const {
-        std::lock_guard<std::mutex> lock(_mutex);
-        return _cache.capacity();
+        return _memoryGovernorHandle->getCapacity();
     }
     
     void BitmapTextureCache::setCapacity(std::size_t capacityInBytes) {
-        std::lock_guard<std::mutex> lock(_mutex);
-        _cache.resize(capacityInBytes);
+        // Actual capacity is applied by the memory governor, it may be lower if the global memory budget is exceeded
+        _memoryGovernorHandle->setCapacity(capacityInBytes);
     }
 
     void BitmapTextureCache::clear() {
@@ -25,22 +25,42 @@ namespace carto {
     }
         
     std::shared_ptr<Texture> BitmapTextureCache::get(const std::shared_ptr<Bitmap>& bitmap) const {
+        processPendingChanges();
+
         std::shared_ptr<Texture> texture;
         {
             std::lock_guard<std::mutex> lock(_mutex);
             _cache.read(bitmap, texture);
         }
+        if (texture) {
+            _memoryGovernorHandle->addHit();
+        } else {
+            _memoryGovernorHandle->addMiss();
+        }
         return (texture && texture->isValid() ? texture : std::shared_ptr<Texture>());
     }
     
     BitmapTextureCache::BitmapTextureCache(const std::weak_ptr<GLResourceManager>& manager, std::size_t capacityInBytes) :
         GLResource(manager),
         _cache(capacityInBytes),
-        _mutex()
+        _resizePending(false),
+        _clearPending(false),
+        _mutex(),
+        _memoryGovernorHandle()
     {
+        _memoryGovernorHandle = MemoryGovernor::RegisterCache("BitmapTextureCache", MemoryTrimLevel::MEMORY_TRIM_LEVEL_CRITICAL, capacityInBytes,
+            [this](std::size_t capacityInBytes) {
+                _resizePending.store(true);
+            },
+            [this]() {
+                _clearPending.store(true);
+            }
+        );
     }
     
     std::shared_ptr<Texture> BitmapTextureCache::create(const std::shared_ptr<Bitmap>& bitmap, bool genMipmaps, bool repeat) {
+        processPendingChanges();
+
         std::shared_ptr<Texture> texture;
         if (std::shared_ptr<GLResourceManager> manager = _manager.lock()) {
             texture = manager->create<Texture>(bitmap, genMipmaps, repeat);
@@ -66,4 +86,20 @@ namespace carto {
         _cache.clear();
     }
 
+    void BitmapTextureCache::processPendingChanges() const {
+        // Memory governor callbacks may be called from any thread, so the textures are released here on the render thread.
+        // Released textures are deleted by the resource manager on the next frame anyway, so deferring does not delay freeing GL memory.
+        bool resize = _resizePending.exchange(false);
+        bool clear = _clearPending.exchange(false);
+        if (resize || clear) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (resize && _memoryGovernorHandle) {
+                _cache.resize(_memoryGovernorHandle->getAppliedCapacity());
+            }
+            if (clear) {
+                _cache.clear();
+            }
+        }
+    }
+
 }
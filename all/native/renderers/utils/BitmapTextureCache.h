@@ -8,7 +8,9 @@
 #define _CARTO_BITMAPTEXTURECACHE_H_
 
 #include "renderers/utils/GLResource.h"
+#include "utils/MemoryGovernor.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 
@@ -39,9 +41,15 @@ namespace carto {
         virtual void destroy();
 
     private:
+        void processPendingChanges() const;
+
         mutable cache::timed_lru_cache<std::shared_ptr<Bitmap>, std::shared_ptr<Texture> > _cache;
         
+        mutable std::atomic<bool> _resizePending; // set by the memory governor, applied on the render thread
+        mutable std::atomic<bool> _clearPending; // set by the memory governor, applied on the render thread
         mutable std::mutex _mutex;
+
+        std::shared_ptr<MemoryGovernor::CacheHandle> _memoryGovernorHandle;
     };
         
 }
@@ -20,7 +20,9 @@
 #include "utils/PlatformUtils.h"
 #include "utils/Log.h"
 
+#include <algorithm>
 #include <list>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <sstream>
@@ -43,12 +45,16 @@ namespace carto {
     BaseMapView::BaseMapView() :
         _envelopeThreadPool(std::make_shared<CancelableThreadPool>()),
         _tileThreadPool(std::make_shared<CancelableThreadPool>()),
+        _tileBuildThreadPool(std::make_shared<CancelableThreadPool>()),
         _options(std::make_shared<Options>(_envelopeThreadPool, _tileThreadPool)),
-        _layers(std::make_shared<Layers>(_envelopeThreadPool, _tileThreadPool, _options)),
+        _layers(std::make_shared<Layers>(_envelopeThreadPool, _tileThreadPool, _tileBuildThreadPool, _options)),
         _mapRenderer(std::make_shared<MapRenderer>(_layers, _options)),
         _touchHandler(std::make_shared<TouchHandler>(_mapRenderer, _options)),
         _mutex()
     {
+        // Tile building is CPU bound, so all tile layers share a pool using all available cores regardless of the number of tile loading threads
+        _tileBuildThreadPool->setPoolSize(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+
         _mapRenderer->init();
         _touchHandler->init();
         _layers->setComponents(_mapRenderer, _touchHandler);
@@ -66,6 +72,7 @@ namespace carto {
         // all objects they hold will be released
         _envelopeThreadPool->deinit();
         _tileThreadPool->deinit();
+        _tileBuildThreadPool->deinit();
         _mapRenderer->deinit();
         _touchHandler->deinit();
     }
@@ -283,6 +290,7 @@ namespace carto {
     void BaseMapView::cancelAllTasks() {
         _envelopeThreadPool->cancelAll();
         _tileThreadPool->cancelAll();
+        _tileBuildThreadPool->cancelAll();
     }
     
     void BaseMapView::clearPreloadingCaches() {
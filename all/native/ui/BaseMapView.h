@@ -359,6 +359,7 @@ namespace carto {
     private:
         std::shared_ptr<CancelableThreadPool> _envelopeThreadPool;
         std::shared_ptr<CancelableThreadPool> _tileThreadPool;
+        std::shared_ptr<CancelableThreadPool> _tileBuildThreadPool;
         std::shared_ptr<Options> _options;
         std::shared_ptr<Layers> _layers;
         std::shared_ptr<MapRenderer> _mapRenderer;
@@ -0,0 +1,231 @@
+#include "MemoryGovernor.h"
+#include "utils/Log.h"
+
+#include <algorithm>
+
+namespace carto {
+
+    MemoryGovernor::CacheHandle::CacheHandle(const std::string& name, MemoryTrimLevel::MemoryTrimLevel trimLevel, std::size_t capacity, const std::function<void(std::size_t)>& applyCapacity, const std::function<void()>& trim) :
+        _name(name),
+        _trimLevel(trimLevel),
+        _capacity(capacity),
+        _appliedCapacity(capacity),
+        _hitCount(0),
+        _missCount(0),
+        _lastHitCount(0),
+        _lastMissCount(0),
+        _hitRate(0.5),
+        _registered(true),
+        _applyCapacity(applyCapacity),
+        _trim(trim),
+        _callbackMutex()
+    {
+    }
+
+    const std::string& MemoryGovernor::CacheHandle::getName() const {
+        return _name;
+    }
+
+    MemoryTrimLevel::MemoryTrimLevel MemoryGovernor::CacheHandle::getTrimLevel() const {
+        return _trimLevel;
+    }
+
+    std::size_t MemoryGovernor::CacheHandle::getCapacity() const {
+        return _capacity.load();
+    }
+
+    void MemoryGovernor::CacheHandle::setCapacity(std::size_t capacityInBytes) {
+        _capacity.store(capacityInBytes);
+        MemoryGovernor::Rebalance();
+    }
+
+    std::size_t MemoryGovernor::CacheHandle::getAppliedCapacity() const {
+        return _appliedCapacity.load();
+    }
+
+    void MemoryGovernor::CacheHandle::addHit() {
+        _hitCount++;
+    }
+
+    void MemoryGovernor::CacheHandle::addMiss() {
+        _missCount++;
+    }
+
+    std::size_t MemoryGovernor::GetMemoryBudget() {
+        std::lock_guard<std::recursive_mutex> lock(_Mutex);
+        return _MemoryBudget;
+    }
+
+    void MemoryGovernor::SetMemoryBudget(std::size_t budgetInBytes) {
+        std::vector<std::shared_ptr<CacheHandle> > changedHandles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_Mutex);
+            _MemoryBudget = budgetInBytes;
+            changedHandles = RebalanceCaches();
+        }
+        ApplyCapacities(changedHandles);
+    }
+
+    void MemoryGovernor::TrimMemory(MemoryTrimLevel::MemoryTrimLevel level) {
+        std::vector<std::shared_ptr<CacheHandle> > cacheHandles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_Mutex);
+            cacheHandles = _CacheHandles;
+        }
+
+        // Trim caches in the order of their trim levels, cheapest caches first. The callbacks are called without holding the governor lock.
+        std::stable_sort(cacheHandles.begin(), cacheHandles.end(), [](const std::shared_ptr<CacheHandle>& handle1, const std::shared_ptr<CacheHandle>& handle2) {
+            return handle1->_trimLevel < handle2->_trimLevel;
+        });
+        for (const std::shared_ptr<CacheHandle>& handle : cacheHandles) {
+            if (handle->_trimLevel > level) {
+                break;
+            }
+            std::lock_guard<std::recursive_mutex> callbackLock(handle->_callbackMutex);
+            if (handle->_registered) {
+                Log::Debugf("MemoryGovernor::TrimMemory: Trimming %s", handle->_name.c_str());
+                handle->_trim();
+            }
+        }
+    }
+
+    void MemoryGovernor::Rebalance() {
+        std::vector<std::shared_ptr<CacheHandle> > changedHandles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_Mutex);
+            changedHandles = RebalanceCaches();
+        }
+        ApplyCapacities(changedHandles);
+    }
+
+    void MemoryGovernor::RebalanceIfNeeded() {
+        long long time = GetSteadyTime();
+        long long nextRebalanceTime = _NextRebalanceTime.load();
+        if (time < nextRebalanceTime) {
+            return;
+        }
+        // Only one of the concurrent callers does the rebalancing
+        if (!_NextRebalanceTime.compare_exchange_strong(nextRebalanceTime, time + REBALANCE_INTERVAL)) {
+            return;
+        }
+        Rebalance();
+    }
+
+    std::shared_ptr<MemoryGovernor::CacheHandle> MemoryGovernor::RegisterCache(const std::string& name, MemoryTrimLevel::MemoryTrimLevel trimLevel, std::size_t capacity, const std::function<void(std::size_t)>& applyCapacity, const std::function<void()>& trim) {
+        auto handle = std::make_shared<CacheHandle>(name, trimLevel, capacity, applyCapacity, trim);
+        std::vector<std::shared_ptr<CacheHandle> > changedHandles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_Mutex);
+            _CacheHandles.push_back(handle);
+            changedHandles = RebalanceCaches();
+        }
+        ApplyCapacities(changedHandles);
+        return handle;
+    }
+
+    void MemoryGovernor::UnregisterCache(const std::shared_ptr<CacheHandle>& handle) {
+        std::vector<std::shared_ptr<CacheHandle> > changedHandles;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_Mutex);
+            _CacheHandles.erase(std::remove(_CacheHandles.begin(), _CacheHandles.end(), handle), _CacheHandles.end());
+            changedHandles = RebalanceCaches();
+        }
+        {
+            // Wait for the callbacks in progress to finish, later callbacks are skipped
+            std::lock_guard<std::recursive_mutex> callbackLock(handle->_callbackMutex);
+            handle->_registered = false;
+        }
+        ApplyCapacities(changedHandles);
+    }
+
+    MemoryGovernor::MemoryGovernor() {
+    }
+
+    std::vector<std::shared_ptr<MemoryGovernor::CacheHandle> > MemoryGovernor::RebalanceCaches() {
+        _NextRebalanceTime.store(GetSteadyTime() + REBALANCE_INTERVAL);
+
+        // Update hit rates using the statistics since the last rebalancing. Smooth the rates to avoid oscillation.
+        for (const std::shared_ptr<CacheHandle>& handle : _CacheHandles) {
+            long long hitCount = handle->_hitCount.load();
+            long long missCount = handle->_missCount.load();
+            long long requestCount = (hitCount - handle->_lastHitCount) + (missCount - handle->_lastMissCount);
+            if (requestCount > 0) {
+                double hitRate = static_cast<double>(hitCount - handle->_lastHitCount) / requestCount;
+                handle->_hitRate = (handle->_hitRate + hitRate) * 0.5;
+            }
+            handle->_lastHitCount = hitCount;
+            handle->_lastMissCount = missCount;
+        }
+
+        // Split the budget proportionally to the configured capacities weighted by hit rates.
+        // Caches that would get more than their configured capacity are capped and the rest of the budget is split again.
+        std::vector<std::size_t> capacities(_CacheHandles.size());
+        for (std::size_t i = 0; i < _CacheHandles.size(); i++) {
+            capacities[i] = _CacheHandles[i]->_capacity.load();
+        }
+        if (_MemoryBudget > 0) {
+            std::vector<std::size_t> pendingIndices;
+            for (std::size_t i = 0; i < _CacheHandles.size(); i++) {
+                if (capacities[i] > 0) {
+                    pendingIndices.push_back(i);
+                }
+            }
+
+            double remainingBudget = static_cast<double>(_MemoryBudget);
+            while (!pendingIndices.empty()) {
+                double totalWeight = 0;
+                for (std::size_t i : pendingIndices) {
+                    totalWeight += capacities[i] * (0.5 + _CacheHandles[i]->_hitRate);
+                }
+
+                auto it = std::partition(pendingIndices.begin(), pendingIndices.end(), [&](std::size_t i) {
+                    return remainingBudget * capacities[i] * (0.5 + _CacheHandles[i]->_hitRate) / totalWeight < capacities[i];
+                });
+                if (it == pendingIndices.end()) {
+                    for (std::size_t i : pendingIndices) {
+                        capacities[i] = static_cast<std::size_t>(remainingBudget * capacities[i] * (0.5 + _CacheHandles[i]->_hitRate) / totalWeight);
+                    }
+                    break;
+                }
+                for (auto it2 = it; it2 != pendingIndices.end(); it2++) {
+                    remainingBudget -= capacities[*it2];
+                }
+                pendingIndices.erase(it, pendingIndices.end());
+            }
+        }
+
+        std::vector<std::shared_ptr<CacheHandle> > changedHandles;
+        for (std::size_t i = 0; i < _CacheHandles.size(); i++) {
+            const std::shared_ptr<CacheHandle>& handle = _CacheHandles[i];
+            if (handle->_appliedCapacity.exchange(capacities[i]) != capacities[i]) {
+                changedHandles.push_back(handle);
+            }
+        }
+        return changedHandles;
+    }
+
+    void MemoryGovernor::ApplyCapacities(const std::vector<std::shared_ptr<CacheHandle> >& handles) {
+        for (const std::shared_ptr<CacheHandle>& handle : handles) {
+            // Use the latest applied capacity, as concurrent rebalancing may have changed it after the handle was collected
+            std::lock_guard<std::recursive_mutex> callbackLock(handle->_callbackMutex);
+            if (handle->_registered) {
+                std::size_t capacity = handle->_appliedCapacity.load();
+                Log::Debugf("MemoryGovernor: Setting capacity of %s to %d bytes", handle->_name.c_str(), static_cast<int>(capacity));
+                handle->_applyCapacity(capacity);
+            }
+        }
+    }
+
+    long long MemoryGovernor::GetSteadyTime() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const int MemoryGovernor::REBALANCE_INTERVAL = 5000;
+
+    std::size_t MemoryGovernor::_MemoryBudget = 0;
+    std::vector<std::shared_ptr<MemoryGovernor::CacheHandle> > MemoryGovernor::_CacheHandles;
+    std::atomic<long long> MemoryGovernor::_NextRebalanceTime(0);
+
+    std::recursive_mutex MemoryGovernor::_Mutex;
+
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MEMORYGOVERNOR_H_
+#define _CARTO_MEMORYGOVERNOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace carto {
+
+    namespace MemoryTrimLevel {
+        /**
+         * Memory trim levels, in increasing order of severity.
+         */
+        enum MemoryTrimLevel {
+            /**
+             * Trim caches that can be refilled cheaply, like tile preloading caches and secondary caches.
+             */
+            MEMORY_TRIM_LEVEL_LOW,
+            /**
+             * In addition to the previous level, trim tile data caches.
+             */
+            MEMORY_TRIM_LEVEL_MODERATE,
+            /**
+             * Trim all caches, including texture and model caches.
+             */
+            MEMORY_TRIM_LEVEL_CRITICAL
+        };
+    }
+
+    /**
+     * A central memory governor for the in-memory caches of the SDK.
+     * Tile data source caches, tile layer caches, texture caches and model caches register with the governor.
+     * If a total memory budget is set, the budget is split between the registered caches based on their configured capacities
+     * and observed hit rates, so that caches that are used more efficiently get larger share of the budget.
+     * Caches never get more memory than their configured capacity.
+     */
+    class MemoryGovernor {
+    public:
+        /**
+         * An internal handle of a cache registered with the governor.
+         */
+        class CacheHandle {
+        public:
+            CacheHandle(const std::string& name, MemoryTrimLevel::MemoryTrimLevel trimLevel, std::size_t capacity, const std::function<void(std::size_t)>& applyCapacity, const std::function<void()>& trim);
+
+            const std::string& getName() const;
+            MemoryTrimLevel::MemoryTrimLevel getTrimLevel() const;
+
+            std::size_t getCapacity() const;
+            void setCapacity(std::size_t capacityInBytes);
+
+            std::size_t getAppliedCapacity() const;
+
+            void addHit();
+            void addMiss();
+
+        private:
+            friend class MemoryGovernor;
+
+            const std::string _name;
+            const MemoryTrimLevel::MemoryTrimLevel _trimLevel;
+            std::atomic<std::size_t> _capacity;
+            std::atomic<std::size_t> _appliedCapacity;
+            std::atomic<long long> _hitCount;
+            std::atomic<long long> _missCount;
+            long long _lastHitCount; // guarded by governor mutex
+            long long _lastMissCount; // guarded by governor mutex
+            double _hitRate; // guarded by governor mutex
+            bool _registered; // guarded by _callbackMutex
+            const std::function<void(std::size_t)> _applyCapacity;
+            const std::function<void()> _trim;
+            std::recursive_mutex _callbackMutex; // held while the callbacks are called, callbacks are called without holding the governor mutex
+        };
+
+        /**
+         * Returns the total memory budget for all registered caches.
+         * @return The total memory budget in bytes. 0 if the budget is not set.
+         */
+        static std::size_t GetMemoryBudget();
+        /**
+         * Sets the total memory budget for all registered caches. The budget is split between the caches
+         * immediately and rebalanced periodically based on the cache hit rates.
+         * @param budgetInBytes The total memory budget in bytes. 0 disables the budget, caches then use their configured capacities.
+         */
+        static void SetMemoryBudget(std::size_t budgetInBytes);
+
+        /**
+         * Releases memory used by the registered caches. Caches are trimmed in the order of their priority,
+         * starting from the caches that are cheapest to refill.
+         * This method should be called when the application receives a low memory warning from the OS.
+         * @param level The trim level specifying which caches are trimmed.
+         */
+        static void TrimMemory(MemoryTrimLevel::MemoryTrimLevel level);
+
+        /**
+         * Recalculates the cache capacities based on the current budget and observed hit rates.
+         */
+        static void Rebalance();
+        /**
+         * Recalculates the cache capacities if enough time has passed since the last rebalancing.
+         * This method is lock-free if no rebalancing is needed, so it can be called on every frame.
+         */
+        static void RebalanceIfNeeded();
+
+        /**
+         * Registers a cache with the governor. The cache should be initially created with the configured capacity,
+         * the callback is called only when the governor changes the capacity.
+         * @param name The name of the cache, used for logging.
+         * @param trimLevel The lowest trim level at which the cache is trimmed.
+         * @param capacity The configured capacity of the cache in bytes.
+         * @param applyCapacity The callback used to change the actual capacity of the cache.
+         * @param trim The callback used to release the memory of the cache.
+         * @return The handle of the registered cache.
+         */
+        static std::shared_ptr<CacheHandle> RegisterCache(const std::string& name, MemoryTrimLevel::MemoryTrimLevel trimLevel, std::size_t capacity, const std::function<void(std::size_t)>& applyCapacity, const std::function<void()>& trim);
+        /**
+         * Unregisters a cache from the governor. Callbacks of the cache are not called after this method returns.
+         * @param handle The handle of the cache to unregister.
+         */
+        static void UnregisterCache(const std::shared_ptr<CacheHandle>& handle);
+
+    private:
+        MemoryGovernor();
+
+        static std::vector<std::shared_ptr<CacheHandle> > RebalanceCaches();
+        static void ApplyCapacities(const std::vector<std::shared_ptr<CacheHandle> >& handles);
+
+        static long long GetSteadyTime();
+
+        static const int REBALANCE_INTERVAL; // in milliseconds
+
+        static std::size_t _MemoryBudget;
+        static std::vector<std::shared_ptr<CacheHandle> > _CacheHandles;
+        static std::atomic<long long> _NextRebalanceTime; // in milliseconds of steady clock
+
+        static std::recursive_mutex _Mutex;
+    };
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "MemoryMappedFile.h"
+#include "components/Exceptions.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+namespace carto {
+
+    MemoryMappedFile::MemoryMappedFile(const std::string& path) :
+        _path(path),
+        _data(nullptr),
+        _size(0),
+        _fileHandle(nullptr),
+        _mappingHandle(nullptr)
+    {
+#ifdef _WIN32
+        int wpathLen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+        std::vector<wchar_t> wpath(wpathLen > 0 ? wpathLen : 1, 0);
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), wpathLen);
+
+        HANDLE file = CreateFile2(wpath.data(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw FileException("Failed to open file", path);
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw FileException("Failed to read file size", path);
+        }
+        _fileHandle = file;
+        _size = static_cast<std::size_t>(fileSize.QuadPart);
+        if (_size == 0) {
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingFromApp(file, NULL, PAGE_READONLY, 0, NULL);
+        if (!mapping) {
+            CloseHandle(file);
+            throw FileException("Failed to map file", path);
+        }
+        _mappingHandle = mapping;
+        _data = static_cast<const unsigned char*>(MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0));
+        if (!_data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw FileException("Failed to map file", path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw FileException("Failed to open file", path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw FileException("Failed to read file size", path);
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        if (_size > 0) {
+            void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw FileException("Failed to map file", path);
+            }
+            _data = static_cast<const unsigned char*>(data);
+        }
+        ::close(fd); // the mapping stays valid after the descriptor is closed
+#endif
+    }
+
+    MemoryMappedFile::~MemoryMappedFile() {
+#ifdef _WIN32
+        if (_data) {
+            UnmapViewOfFile(_data);
+        }
+        if (_mappingHandle) {
+            CloseHandle(static_cast<HANDLE>(_mappingHandle));
+        }
+        if (_fileHandle) {
+            CloseHandle(static_cast<HANDLE>(_fileHandle));
+        }
+#else
+        if (_data) {
+            ::munmap(const_cast<unsigned char*>(_data), _size);
+        }
+#endif
+    }
+
+    const std::string& MemoryMappedFile::getPath() const {
+        return _path;
+    }
+
+    std::size_t MemoryMappedFile::size() const {
+        return _size;
+    }
+
+    const unsigned char* MemoryMappedFile::data() const {
+        return _data;
+    }
+
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2016 CartoDB. All rights reserved.
+ * Copying and using this code is allowed only according
+ * to license terms, as given in https://cartodb.com/terms/
+ */
+
+#ifndef _CARTO_MEMORYMAPPEDFILE_H_
+#define _CARTO_MEMORYMAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace carto {
+
+    /**
+     * An internal read-only memory mapping of a whole file.
+     * The mapping is thread safe to read from and stays valid until the object is destroyed.
+     */
+    class MemoryMappedFile {
+    public:
+        /**
+         * Maps the specified file into memory.
+         * @param path The path of the file to map.
+         * @throws FileException If the file could not be opened or mapped.
+         */
+        explicit MemoryMappedFile(const std::string& path);
+        virtual ~MemoryMappedFile();
+
+        const std::string& getPath() const;
+
+        std::size_t size() const;
+        const unsigned char* data() const;
+
+    private:
+        MemoryMappedFile(const MemoryMappedFile&) = delete;
+        MemoryMappedFile& operator = (const MemoryMappedFile&) = delete;
+
+        std::string _path;
+        const unsigned char* _data;
+        std::size_t _size;
+        void* _fileHandle;
+        void* _mappingHandle;
+    };
+
+}
+
+#endif
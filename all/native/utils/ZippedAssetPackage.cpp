@@ -76,6 +76,15 @@ namespace carto {
             return std::shared_ptr<BinaryData>();
         }
     
+        // Stored (uncompressed) assets are returned as views of the archive data, without copying
+        mz_zip_archive_file_stat stat;
+        if (mz_zip_reader_file_stat(zip, it->second, &stat) && stat.m_method == 0 && !(stat.m_bit_flag & 1) && stat.m_comp_size == stat.m_uncomp_size) {
+            std::size_t dataOffset = 0;
+            if (FindLocalFileDataOffset(*_zipData, static_cast<std::size_t>(stat.m_local_header_ofs), dataOffset) && stat.m_uncomp_size <= _zipData->size() - dataOffset) {
+                return std::make_shared<BinaryData>(_zipData, dataOffset, static_cast<std::size_t>(stat.m_uncomp_size));
+            }
+        }
+    
         std::size_t elementSize = 0;
         std::shared_ptr<unsigned char> elementData(static_cast<unsigned char*>(mz_zip_reader_extract_to_heap(zip, it->second, &elementSize, 0)), mz_free);
         if (!elementData) {
@@ -93,8 +102,7 @@ namespace carto {
         _handle = std::make_shared<mz_zip_archive>();
         mz_zip_archive* zip = static_cast<mz_zip_archive*>(_handle.get());
         memset(zip, 0, sizeof(mz_zip_archive));
-        std::shared_ptr<std::vector<unsigned char> > data = _zipData->getDataPtr();
-        if (!mz_zip_reader_init_mem(zip, data->data(), data->size(), 0)) {
+        if (!mz_zip_reader_init_mem(zip, _zipData->data(), _zipData->size(), 0)) {
             throw GenericException("Could not open ZIP archive");
         }
     
@@ -115,5 +123,24 @@ namespace carto {
         }
         _handle.reset();
     }
+
+    bool ZippedAssetPackage::FindLocalFileDataOffset(const BinaryData& zipData, std::size_t headerOffset, std::size_t& dataOffset) {
+        if (headerOffset > zipData.size() || zipData.size() - headerOffset < LOCAL_FILE_HEADER_SIZE) {
+            return false;
+        }
+
+        const unsigned char* header = zipData.data() + headerOffset;
+        unsigned int signature = header[0] | (header[1] << 8) | (header[2] << 16) | (static_cast<unsigned int>(header[3]) << 24);
+        if (signature != LOCAL_FILE_HEADER_SIGNATURE) {
+            return false;
+        }
+        std::size_t fileNameLength = header[26] | (header[27] << 8);
+        std::size_t extraFieldLength = header[28] | (header[29] << 8);
+        dataOffset = headerOffset + LOCAL_FILE_HEADER_SIZE + fileNameLength + extraFieldLength;
+        return dataOffset <= zipData.size();
+    }
+
+    const std::size_t ZippedAssetPackage::LOCAL_FILE_HEADER_SIZE = 30;
+    const unsigned int ZippedAssetPackage::LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50;
     
 }
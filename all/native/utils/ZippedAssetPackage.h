@@ -42,6 +42,11 @@ namespace carto {
         void initialize();
         void deinitialize();
 
+        static bool FindLocalFileDataOffset(const BinaryData& zipData, std::size_t headerOffset, std::size_t& dataOffset);
+
+        static const std::size_t LOCAL_FILE_HEADER_SIZE;
+        static const unsigned int LOCAL_FILE_HEADER_SIGNATURE;
+
         const std::shared_ptr<BinaryData> _zipData;
         const std::shared_ptr<AssetPackage> _baseAssetPackage;
         std::shared_ptr<void> _handle;
@@ -47,7 +47,9 @@ namespace carto {
         _layerIds(layerIds),
         _layerInvisibleSet(),
         _fallbackFonts(),
+        _fallbackFontsHash(0),
         _layerStyleSets(),
+        _layerStyleSetHashes(),
         _layerMaps(),
         _layerSymbolizerContexts(),
         _assetPackageSymbolizerContexts(),
@@ -130,6 +132,7 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             if (fontData) {
                 _fallbackFonts.push_back(fontData);
+                _fallbackFontsHash = CombineHash(_fallbackFontsHash, CalculateDataHash(fontData));
                 _assetPackageSymbolizerContexts.clear();
                 for (auto it = _layerStyleSets.begin(); it != _layerStyleSets.end(); it++) {
                     updateLayerStyleSet(it->first, it->second);
@@ -304,6 +307,19 @@ namespace carto {
         return std::shared_ptr<TileMap>();
     }
 
+    std::size_t CartoVectorTileDecoder::calculateStyleHash() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::size_t hash = _fallbackFontsHash;
+        for (const std::string& layerId : _layerIds) {
+            hash = CombineHash(hash, std::hash<std::string>()(layerId));
+            auto it = _layerStyleSetHashes.find(layerId);
+            hash = CombineHash(hash, it != _layerStyleSetHashes.end() ? it->second : 0);
+            hash = CombineHash(hash, std::hash<bool>()(_layerInvisibleSet.count(layerId) == 0));
+        }
+        return hash;
+    }
+
     void CartoVectorTileDecoder::updateLayerStyleSet(const std::string& layerId, const std::shared_ptr<CartoCSSStyleSet>& styleSet) {
         if (!styleSet) {
             throw NullArgumentException("Null styleset");
@@ -311,6 +327,14 @@ namespace carto {
 
         std::shared_ptr<AssetPackage> assetPackage = styleSet->getAssetPackage();
 
+        std::size_t styleSetHash = 0;
+        auto styleSetIt = _layerStyleSets.find(layerId);
+        if (styleSetIt != _layerStyleSets.end() && styleSetIt->second == styleSet) {
+            styleSetHash = _layerStyleSetHashes[layerId];
+        } else {
+            styleSetHash = CalculateStyleSetHash(styleSet->getCartoCSS(), assetPackage);
+        }
+
         if (_assetPackageSymbolizerContexts.find(assetPackage) == _assetPackageSymbolizerContexts.end() && _assetPackageSymbolizerContexts.size() >= MAX_ASSETPACKAGE_SYMBOLIZER_CONTEXTS) {
             _assetPackageSymbolizerContexts.clear();
         }
@@ -361,6 +385,7 @@ namespace carto {
         }
 
         _layerStyleSets[layerId] = styleSet;
+        _layerStyleSetHashes[layerId] = styleSetHash;
         _layerMaps[layerId] = map;
         _layerSymbolizerContexts[layerId] = symbolizerContext;
     }
@@ -95,6 +95,8 @@ namespace carto {
         virtual std::shared_ptr<TileMap> decodeTile(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<vt::TileTransformer>& tileTransformer, const std::shared_ptr<BinaryData>& tileData) const;
     
     protected:
+        virtual std::size_t calculateStyleHash() const;
+
         void updateLayerStyleSet(const std::string& layerId, const std::shared_ptr<CartoCSSStyleSet>& styleSet);
 
         static const int DEFAULT_TILE_SIZE;
@@ -106,7 +108,9 @@ namespace carto {
         const std::vector<std::string> _layerIds;
         std::set<std::string> _layerInvisibleSet;
         std::vector<std::shared_ptr<BinaryData> > _fallbackFonts;
+        std::size_t _fallbackFontsHash;
         std::map<std::string, std::shared_ptr<CartoCSSStyleSet> > _layerStyleSets;
+        std::map<std::string, std::size_t> _layerStyleSetHashes;
         std::map<std::string, std::shared_ptr<const mvt::Map> > _layerMaps;
         std::map<std::string, std::shared_ptr<const mvt::SymbolizerContext> > _layerSymbolizerContexts;
         std::map<std::shared_ptr<AssetPackage>, std::shared_ptr<const mvt::SymbolizerContext> > _assetPackageSymbolizerContexts;
@@ -50,7 +50,9 @@ namespace carto {
         _layerNameOverride(),
         _parameterValueMap(),
         _fallbackFonts(),
+        _fallbackFontsHash(0),
         _styleSet(),
+        _styleSetHash(0),
         _map(),
         _mapSettings(),
         _symbolizerContext(),
@@ -71,7 +73,9 @@ namespace carto {
         _layerNameOverride(),
         _parameterValueMap(),
         _fallbackFonts(),
+        _fallbackFontsHash(0),
         _styleSet(),
+        _styleSetHash(0),
         _map(),
         _symbolizerContext(),
         _assetPackageSymbolizerContexts()
@@ -285,6 +289,7 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             if (fontData) {
                 _fallbackFonts.push_back(fontData);
+                _fallbackFontsHash = CombineHash(_fallbackFontsHash, CalculateDataHash(fontData));
                 _assetPackageSymbolizerContexts.clear();
                 updateCurrentStyleSet(_styleSet);
             }
@@ -434,14 +439,40 @@ namespace carto {
         return std::shared_ptr<TileMap>();
     }
 
+    std::size_t MBVectorTileDecoder::calculateStyleHash() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::size_t hash = CombineHash(_styleSetHash, _fallbackFontsHash);
+        hash = CombineHash(hash, std::hash<bool>()(_featureIdOverride));
+        hash = CombineHash(hash, std::hash<bool>()(_cartoCSSLayerNamesIgnored));
+        hash = CombineHash(hash, std::hash<std::string>()(_layerNameOverride));
+        for (auto it = _parameterValueMap.begin(); it != _parameterValueMap.end(); it++) {
+            hash = CombineHash(hash, std::hash<std::string>()(it->first));
+            if (auto val = std::get_if<bool>(&it->second)) {
+                hash = CombineHash(hash, std::hash<bool>()(*val));
+            } else if (auto val = std::get_if<long long>(&it->second)) {
+                hash = CombineHash(hash, std::hash<long long>()(*val));
+            } else if (auto val = std::get_if<double>(&it->second)) {
+                hash = CombineHash(hash, std::hash<double>()(*val));
+            } else if (auto val = std::get_if<std::string>(&it->second)) {
+                hash = CombineHash(hash, std::hash<std::string>()(*val));
+            }
+        }
+        return hash;
+    }
+
     void MBVectorTileDecoder::updateCurrentStyleSet(const std::variant<std::shared_ptr<CompiledStyleSet>, std::shared_ptr<CartoCSSStyleSet> >& styleSet) {
         std::string styleAssetName;
         std::shared_ptr<AssetPackage> assetPackage;
         std::shared_ptr<mvt::Map> map;
+        std::size_t styleSetHash = _styleSetHash;
 
         if (auto cartoCSSStyleSet = std::get_if<std::shared_ptr<CartoCSSStyleSet> >(&styleSet)) {
             styleAssetName = "";
             assetPackage = (*cartoCSSStyleSet)->getAssetPackage();
+            if (styleSet != _styleSet) {
+                styleSetHash = CombineHash(CalculateStyleSetHash((*cartoCSSStyleSet)->getCartoCSS(), assetPackage), styleSet.index());
+            }
 
             try {
                 auto assetLoader = std::make_shared<CartoCSSAssetLoader>("", (*cartoCSSStyleSet)->getAssetPackage());
@@ -458,6 +489,9 @@ namespace carto {
                 throw InvalidArgumentException("Could not find any styles in the style set");
             }
             assetPackage = (*compiledStyleSet)->getAssetPackage();
+            if (styleSet != _styleSet) {
+                styleSetHash = CombineHash(CalculateStyleSetHash(styleAssetName, assetPackage), styleSet.index());
+            }
 
             std::shared_ptr<BinaryData> styleData;
             if (assetPackage) {
@@ -567,6 +601,7 @@ namespace carto {
         _map = map;
         _mapSettings = std::make_shared<mvt::Map::Settings>(_map->getSettings());
         _styleSet = styleSet;
+        _styleSetHash = styleSetHash;
         _cachedFeatureDecoder.first.reset();
         _cachedFeatureDecoder.second.reset();
     }
@@ -22,6 +22,7 @@ namespace carto {
     TorqueTileDecoder::TorqueTileDecoder(const std::shared_ptr<CartoCSSStyleSet>& styleSet) :
         _logger(std::make_shared<MVTLogger>("TorqueTileDecoder")),
         _fallbackFonts(),
+        _fallbackFontsHash(0),
         _map(),
         _mapSettings(),
         _symbolizerContext(),
@@ -86,6 +87,7 @@ namespace carto {
             std::lock_guard<std::mutex> lock(_mutex);
             if (fontData) {
                 _fallbackFonts.push_back(fontData);
+                _fallbackFontsHash = CombineHash(_fallbackFontsHash, CalculateDataHash(fontData));
                 updateCurrentStyleSet(_styleSet);
             }
         }
@@ -151,6 +153,13 @@ namespace carto {
         return std::shared_ptr<TileMap>();
     }
 
+    std::size_t TorqueTileDecoder::calculateStyleHash() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Torque styles do not use asset packages
+        return CombineHash(CalculateStyleSetHash(_styleSet->getCartoCSS(), std::shared_ptr<AssetPackage>()), _fallbackFontsHash);
+    }
+
     void TorqueTileDecoder::updateCurrentStyleSet(const std::shared_ptr<CartoCSSStyleSet>& styleSet) {
         std::shared_ptr<mvt::TorqueMap> map;
         std::shared_ptr<mvt::Map::Settings> mapSettings;
@@ -83,6 +83,8 @@ namespace carto {
         virtual std::shared_ptr<TileMap> decodeTile(const vt::TileId& tile, const vt::TileId& targetTile, const std::shared_ptr<vt::TileTransformer>& tileTransformer, const std::shared_ptr<BinaryData>& tileData) const;
 
     protected:
+        virtual std::size_t calculateStyleHash() const;
+
         void updateCurrentStyleSet(const std::shared_ptr<CartoCSSStyleSet>& styleSet);
 
         static const int DEFAULT_TILE_SIZE;
@@ -90,6 +92,7 @@ namespace carto {
 
         const std::shared_ptr<mvt::Logger> _logger;
         std::vector<std::shared_ptr<BinaryData> > _fallbackFonts;
+        std::size_t _fallbackFontsHash;
         std::shared_ptr<const mvt::TorqueMap> _map;
         std::shared_ptr<const mvt::Map::Settings> _mapSettings;
         std::shared_ptr<const mvt::SymbolizerContext> _symbolizerContext;
@@ -1,8 +1,12 @@
 #include "VectorTileDecoder.h"
+#include "core/BinaryData.h"
+#include "utils/AssetPackage.h"
 
 #include <vt/TileId.h>
 
 #include <algorithm>
+#include <functional>
+#include <string_view>
 
 namespace carto {
 
@@ -11,6 +15,8 @@ namespace carto {
     }
 
     void VectorTileDecoder::notifyDecoderChanged() {
+        _styleVersion.store(++_StyleVersionCounter);
+
         std::vector<std::shared_ptr<OnChangeListener> > onChangeListeners;
         {
             std::lock_guard<std::mutex> lock(_onChangeListenersMutex);
@@ -21,6 +27,17 @@ namespace carto {
         }
     }
         
+    std::size_t VectorTileDecoder::getStyleHash() const {
+        // The hash is recalculated only after the decoder has changed
+        long long styleVersion = _styleVersion.load();
+        std::lock_guard<std::mutex> lock(_styleHashMutex);
+        if (_styleHashVersion != styleVersion) {
+            _styleHash = calculateStyleHash();
+            _styleHashVersion = styleVersion;
+        }
+        return _styleHash;
+    }
+        
     void VectorTileDecoder::registerOnChangeListener(const std::shared_ptr<OnChangeListener>& listener) {
         std::lock_guard<std::mutex> lock(_onChangeListenersMutex);
         _onChangeListeners.push_back(listener);
@@ -32,6 +49,10 @@ namespace carto {
     }
     
     VectorTileDecoder::VectorTileDecoder() : 
+        _styleVersion(++_StyleVersionCounter),
+        _styleHashVersion(0),
+        _styleHash(0),
+        _styleHashMutex(),
         _onChangeListeners(),
         _onChangeListenersMutex()
     {
@@ -45,4 +66,35 @@ namespace carto {
         return cglib::translate3_matrix(cglib::vec3<float>(-x, -y, 1)) * cglib::scale3_matrix(cglib::vec3<float>(s, s, 1));
     }
 
+    std::size_t VectorTileDecoder::calculateStyleHash() const {
+        return std::hash<long long>()(_styleVersion.load());
+    }
+
+    std::size_t VectorTileDecoder::CombineHash(std::size_t hash, std::size_t value) {
+        return hash * 31 + value;
+    }
+
+    std::size_t VectorTileDecoder::CalculateDataHash(const std::shared_ptr<BinaryData>& data) {
+        if (!data) {
+            return 0;
+        }
+        return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(data->data()), data->size()));
+    }
+
+    std::size_t VectorTileDecoder::CalculateStyleSetHash(const std::string& style, const std::shared_ptr<AssetPackage>& assetPackage) {
+        // Asset contents are included, as images and fonts referenced by the style may differ between packages with identical styles
+        std::size_t hash = std::hash<std::string>()(style);
+        if (assetPackage) {
+            std::vector<std::string> assetNames = assetPackage->getAssetNames();
+            std::sort(assetNames.begin(), assetNames.end());
+            for (const std::string& assetName : assetNames) {
+                hash = CombineHash(hash, std::hash<std::string>()(assetName));
+                hash = CombineHash(hash, CalculateDataHash(assetPackage->loadAsset(assetName)));
+            }
+        }
+        return hash;
+    }
+
+    std::atomic<long long> VectorTileDecoder::_StyleVersionCounter(0);
+
 }
@@ -9,6 +9,7 @@
 
 #include "graphics/Color.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <mutex>
@@ -27,6 +28,7 @@ namespace carto {
         class TileTransformer;
     }
 
+    class AssetPackage;
     class BinaryData;
     class VectorTileFeature;
     class VectorTileFeatureCollection;
@@ -116,6 +118,13 @@ namespace carto {
          * listeners, but generally all cached tiles will be reloaded. 
          */
         virtual void notifyDecoderChanged();
+
+        /**
+         * Returns the hash of the decoder style and parameters. Decoders with identical styles and parameters have equal hashes,
+         * so tiles decoded by one of them can be used with another. The hash changes each time the decoder is changed.
+         * @return The current style hash of the decoder.
+         */
+        std::size_t getStyleHash() const;
         
         /**
          * Registers listener for decoder change events.
@@ -133,8 +142,26 @@ namespace carto {
         VectorTileDecoder();
 
         static cglib::mat3x3<float> calculateTileTransform(const carto::vt::TileId& tileId, const carto::vt::TileId& targetTileId);
+
+        /**
+         * Calculates the hash of the current decoder style and parameters. The default implementation
+         * returns a hash that is unique to the decoder instance and its current state.
+         * @return The hash of the current decoder style and parameters.
+         */
+        virtual std::size_t calculateStyleHash() const;
+
+        static std::size_t CombineHash(std::size_t hash, std::size_t value);
+        static std::size_t CalculateDataHash(const std::shared_ptr<BinaryData>& data);
+        static std::size_t CalculateStyleSetHash(const std::string& style, const std::shared_ptr<AssetPackage>& assetPackage);
         
     private:
+        static std::atomic<long long> _StyleVersionCounter;
+
+        std::atomic<long long> _styleVersion;
+        mutable long long _styleHashVersion;
+        mutable std::size_t _styleHash;
+        mutable std::mutex _styleHashMutex;
+
         std::vector<std::shared_ptr<OnChangeListener> > _onChangeListeners;
         mutable std::mutex _onChangeListenersMutex;
     };
@@ -21,7 +21,7 @@ namespace carto {
                 return std::shared_ptr<BinaryData>();
             }
 
-            AAsset* assetRaw = AAssetManager_open(_AssetManagerPtr, path.c_str(), AASSET_MODE_UNKNOWN);
+            AAsset* assetRaw = AAssetManager_open(_AssetManagerPtr, path.c_str(), AASSET_MODE_BUFFER);
             if (!assetRaw) {
                 Log::Errorf("AssetManager::LoadAsset: Asset not found: %s", path.c_str());
                 return std::shared_ptr<BinaryData>();
@@ -34,11 +34,14 @@ namespace carto {
             Log::Errorf("AssetManager::LoadAsset: Asset size is <0: %s", path.c_str());
             return std::shared_ptr<BinaryData>();
         }
-        std::vector<unsigned char> data(size);
 
-        AAsset_read(asset.get(), data.data(), size);
-
-        return std::make_shared<BinaryData>(std::move(data));
+        // Refer to the asset buffer directly, the asset stays open while the data is used
+        const void* buffer = AAsset_getBuffer(asset.get());
+        if (!buffer && size > 0) {
+            Log::Errorf("AssetManager::LoadAsset: Failed to read asset: %s", path.c_str());
+            return std::shared_ptr<BinaryData>();
+        }
+        return std::make_shared<BinaryData>(asset, static_cast<const unsigned char*>(buffer), static_cast<std::size_t>(size));
     }
 
     AssetUtils::AssetUtils() {
@@ -1,6 +1,7 @@
 #include "AssetUtils.h"
 #include "core/BinaryData.h"
 #include "utils/Log.h"
+#include "utils/MemoryMappedFile.h"
 
 #import <Foundation/Foundation.h>
 
@@ -13,22 +14,20 @@ namespace carto {
         NSString* extension = [nsPath pathExtension];
         NSString* fullPath = [[NSBundle mainBundle] pathForResource:fileName ofType:extension];
         
-        // Try to open file for reading
-        NSFileHandle* fileHandle = [NSFileHandle fileHandleForReadingAtPath:fullPath];
-        if (!fileHandle) {
+        if (!fullPath) {
             Log::Errorf("AssetUtils::LoadAsset: Asset not found: %s", path.c_str());
             return std::shared_ptr<BinaryData>();
         }
         
-        // Read the file
-        NSData* fileData = [fileHandle readDataToEndOfFile];
-        [fileHandle closeFile];
-        
-        // Copy the data to vector
-        std::vector<unsigned char> data;
-        const unsigned char* bytes = static_cast<const unsigned char*>([fileData bytes]);
-        data.assign(bytes, bytes + [fileData length]);
-        return std::make_shared<BinaryData>(std::move(data));
+        // Map the file instead of reading it, the returned data refers to the mapping
+        try {
+            auto file = std::make_shared<MemoryMappedFile>(std::string([fullPath UTF8String]));
+            return std::make_shared<BinaryData>(file, file->data(), file->size());
+        }
+        catch (const std::exception& ex) {
+            Log::Errorf("AssetUtils::LoadAsset: Failed to map asset %s: %s", path.c_str(), ex.what());
+            return std::shared_ptr<BinaryData>();
+        }
     }
 
     std::string AssetUtils::CalculateResourcePath(const std::string& resourceName) {
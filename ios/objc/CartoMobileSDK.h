@@ -29,11 +29,13 @@
 #import "NTAssetTileDataSource.h"
 #import "NTCombinedTileDataSource.h"
 #import "NTOrderedTileDataSource.h"
+#import "NTCoalescingTileDataSource.h"
 #import "NTMergedMBVTTileDataSource.h"
 #import "NTBitmapOverlayRasterTileDataSource.h"
 #import "NTGeoJSONVectorTileDataSource.h"
 #import "NTHTTPTileDataSource.h"
 #import "NTMemoryCacheTileDataSource.h"
+#import "NTShardedMemoryCacheTileDataSource.h"
 #import "NTCartoOnlineTileDataSource.h"
 #import "NTMapTilerOnlineTileDataSource.h"
 #import "NTLocalVectorDataSource.h"
@@ -124,6 +126,7 @@
 #import "NTTileUtils.h"
 #import "NTLog.h"
 #import "NTLogEventListener.h"
+#import "NTMemoryGovernor.h"
 #import "utils/ExceptionWrapper.h"
 
 #import "NTBalloonPopup.h"
@@ -158,6 +161,7 @@
 
 #ifdef _CARTO_OFFLINE_SUPPORT
 #import "NTMBTilesTileDataSource.h"
+#import "NTPMTilesTileDataSource.h"
 #import "NTPersistentCacheTileDataSource.h"
 #endif
 
@@ -1,6 +1,7 @@
 #include "AssetUtils.h"
 #include "core/BinaryData.h"
 #include "utils/Log.h"
+#include "utils/MemoryMappedFile.h"
 
 #include <utf8.h>
 
@@ -21,17 +22,19 @@ namespace carto {
             fpRaw = _wfopen(wfullPath.c_str(), L"rb");
         }
         if (fpRaw) {
-            std::shared_ptr<FILE> fp(fpRaw, fclose);
-            fseek(fp.get(), 0, SEEK_END);
-            long size = ftell(fp.get());
-            if (size < 0) {
-                Log::Errorf("AssetManager::LoadAsset: Error detecting asset size: %s", path.c_str());
+            fclose(fpRaw);
+
+            // Map the file instead of reading it, the returned data refers to the mapping
+            std::string fullPathUTF8;
+            utf8::utf16to8(wfullPath.begin(), wfullPath.end(), std::back_inserter(fullPathUTF8));
+            try {
+                auto file = std::make_shared<MemoryMappedFile>(fullPathUTF8);
+                return std::make_shared<BinaryData>(file, file->data(), file->size());
+            }
+            catch (const std::exception& ex) {
+                Log::Errorf("AssetUtils::LoadAsset: Failed to map asset %s: %s", path.c_str(), ex.what());
                 return std::shared_ptr<BinaryData>();
             }
-            std::vector<unsigned char> data(size);
-            fseek(fp.get(), 0, SEEK_SET);
-            fread(data.data(), 1, size, fp.get());
-            return std::make_shared<BinaryData>(std::move(data));
         } else {
             Log::Errorf("AssetUtils::LoadAsset: Asset not found: %s", path.c_str());
             return std::shared_ptr<BinaryData>();